@@ -0,0 +1,26 @@
+#!/bin/sh
+# time a transient run with many absdelay instances, report memory use.
+# usage: absdelay.sh [instances] [maxpoints]
+
+n=${1:-10000}
+maxpoints=${2:-0}
+here=$(cd "$(dirname "$0")" && pwd)
+vams=$here/../../vams
+
+awk -v n="$n" -v m="$maxpoints" -v vams="$vams" 'BEGIN {
+  print "attach " vams "/vsine.so"
+  print "verilog"
+  print "vsine #(.ampl(1), .freq(1k)) v1(in, 0);"
+  for (i = 0; i < n; ++i) {
+    printf "va_absdelay #(.delay(%g), .maxpoints(%d)) d%d (o%d, 0, in, 0);\n", 1e-4 * (1 + i % 7), m, i, i
+  }
+  print "tran 10u 20m trace=n > /dev/null"
+  print "status"
+}' > absdelay.gc
+
+echo "$n instances, maxpoints=$maxpoints"
+if [ -x /usr/bin/time ]; then
+  /usr/bin/time -f "%e s, max RSS %M kB" gnucap -b absdelay.gc
+else
+  time gnucap -b absdelay.gc
+fi
@@ -0,0 +1,36 @@
+#!/bin/sh
+# time a transient run with many instances of vams/diode.vams, evaluated
+# one by one, in batches, and in batches on several threads.
+# usage: batch.sh [instances] [threads]
+
+n=${1:-20000}
+t=${2:-4}
+here=$(cd "$(dirname "$0")" && pwd)
+vams=$here/../../vams
+
+run() {
+  awk -v n="$n" -v vams="$vams" -v t="$1" 'BEGIN {
+    print "attach " vams "/vsine.so"
+    print "attach ./diode.so"
+    print "verilog"
+    print "va_eval " t
+    print "vsine #(.ampl(1), .freq(1k)) v1(in, 0);"
+    for (i = 0; i < n; ++i) {
+      printf "resistor #(1k) r%d (in, a%d);\n", i, i
+      printf "diode #(.is(1e-14)) d%d (a%d, 0);\n", i, i
+    }
+    print "print tran v(a0)"
+    print "tran 10u 2m trace=n > /dev/null"
+    print "status"
+  }' > batch.gc
+  time gnucap -b batch.gc > /dev/null
+}
+
+for opt in "" --optimize-batch; do
+  gnucap-mg-vams -I "$vams" $opt --cc "$vams"/diode.vams | \
+    g++ -xc++ `gnucap-conf --cppflags` -O2 -fPIC -shared - -o diode.so || exit 1
+  echo "$n instances ${opt:-unbatched}, 1 thread"
+  run 1
+done
+echo "$n instances --optimize-batch, $t threads"
+run "$t"
@@ -0,0 +1,33 @@
+#!/bin/sh
+# time the instantiation of a flat netlist against a binned paramset library.
+# usage: bins.sh [instances] [l bins] [w bins]
+
+n=${1:-1000000}
+nl=${2:-20}
+nw=${3:-10}
+
+awk -v n="$n" -v nl="$nl" -v nw="$nw" 'BEGIN {
+  print "verilog"
+  for (i = 0; i < nl; ++i) {
+    for (j = 0; j < nw; ++j) {
+      printf "(* desc=\"bin%d.%d\" *) paramset nch resistor;\n", i, j
+      printf "  parameter l from [%g:%g);\n", (i + 1) * 1e-7, (i + 2) * 1e-7
+      printf "  parameter w from [%g:%g);\n", (j + 1) * 1e-6, (j + 2) * 1e-6
+      print " .r = l/w*1k;"
+      print "endparamset"
+    }
+  }
+  for (k = 0; k < n; ++k) {
+    l = (k % nl + 1.5) * 1e-7
+    w = (int(k / nl) % nw + 1.5) * 1e-6
+    printf "nch #(.l(%g), .w(%g)) r%d (1, 0);\n", l, w, k
+  }
+  print "vsource #(1.) v(1, 0);"
+  print "spice"
+  print ".op"
+  print ".status notime"
+  print ".end"
+}' > bins.gc
+
+echo "$n instances, $((nl * nw)) bins"
+time gnucap -b bins.gc > /dev/null
@@ -0,0 +1,45 @@
+#!/bin/sh
+# time the generator on synthetic modules of growing size.
+# usage: deps.sh [largest statement count] [probes per statement]
+
+max=${1:-4000}
+k=${2:-8}
+here=$(cd "$(dirname "$0")" && pwd)
+vams=$here/../../vams
+
+n=250
+while [ "$n" -le "$max" ]; do
+  awk -v n="$n" -v k="$k" 'BEGIN {
+    m = n / 2 # nodes
+    print "`include \"disciplines.vams\""
+    print "module deps(p, n);"
+    print "\tinout p, n;"
+    printf "\telectrical p, n"
+    for (j = 0; j < m; ++j) {
+      printf ", x%d", j
+    }
+    print ";"
+    print "\treal t;"
+    print "\tanalog begin"
+    print "\t\tt = 0.;"
+    for (i = 0; i < n; ++i) {
+      printf "\t\tt = t"
+      for (j = 0; j < k; ++j) {
+	printf " + V(x%d) * V(x%d)", (i + j) % m, (i + 3 * j + 1) % m
+      }
+      print ";"
+      printf "\t\tI(x%d) <+ t * 1e-3 + V(x%d);\n", i % m, i % m
+    }
+    print "\t\tI(p, n) <+ t;"
+    print "\tend"
+    print "endmodule"
+  }' > deps.va
+  printf "%6d statements: " "$n"
+  if [ -x /usr/bin/time ]; then
+    /usr/bin/time -f "%e s" gnucap-mg-vams -I "$vams" --cc deps.va 2>&1 > /dev/null
+  else
+    echo
+    time gnucap-mg-vams -I "$vams" --cc deps.va > /dev/null
+  fi
+  n=$((n * 2))
+done
@@ -0,0 +1,54 @@
+#!/bin/sh
+# element count, memory and load time of a four terminal model with ten
+# branches, with and without --optimize-fuse.
+# usage: fuse.sh [instances]
+
+n=${1:-20000}
+
+cat > fuse4.va <<'EOV'
+`include "disciplines.vams"
+module fuse4(d, g, s, b);
+electrical d, g, s, b;
+analog begin
+  I(d, s) <+ 1m * tanh(V(g, s)) * V(d, s);
+  I(g, s) <+ 1p * V(g, s);
+  I(g, d) <+ 1p * V(g, d);
+  I(g, b) <+ 1p * V(g, b);
+  I(d, b) <+ 1f * (exp(V(b, d) / 25m) - 1);
+  I(s, b) <+ 1f * (exp(V(b, s) / 25m) - 1);
+  I(d) <+ 1n * V(d);
+  I(s) <+ 1n * V(s);
+  I(g) <+ 1n * V(g);
+  I(b) <+ 1n * V(b);
+end
+endmodule
+EOV
+
+here=$(cd "$(dirname "$0")" && pwd)
+vams=$here/../../vams
+for opt in "" --optimize-fuse; do
+  gnucap-mg-vams -I "$vams" $opt --cc fuse4.va > fuse4.cc || exit 1
+  g++ `gnucap-conf --cppflags` -O2 -fPIC -shared fuse4.cc -o fuse4.so || exit 1
+
+  awk -v n="$n" -v vams="$vams" 'BEGIN {
+    print "attach " vams "/vsine.so"
+    print "attach ./fuse4.so"
+    print "verilog"
+    print "vsine #(.ampl(1), .freq(1k)) v1(in, 0);"
+    print "vsource #(.dc(1)) v2(dd, 0);"
+    for (i = 0; i < n; ++i) {
+      printf "fuse4 m%d(d%d, in, 0, 0);\n", i, i
+      printf "resistor #(1k) r%d (dd, d%d);\n", i, i
+    }
+    print "tran 10u 1m trace=n > /dev/null"
+    print "status"
+  }' > fuse.gc
+
+  echo "$n instances ${opt:-expanded}," \
+    "$(grep -c '// elt$' fuse4.cc) element(s) per instance"
+  if [ -x /usr/bin/time ]; then
+    /usr/bin/time -f "%e s, max RSS %M kB" gnucap -b fuse.gc | grep -i "load\|nodes\|tran"
+  else
+    time gnucap -b fuse.gc | grep -i "load\|nodes\|tran"
+  fi
+done
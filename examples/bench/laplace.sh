@@ -0,0 +1,38 @@
+#!/bin/sh
+# time a transient run with many high order va_laplace_nd instances,
+# subcircuit vs. state space.
+# usage: laplace.sh [instances] [order]
+
+n=${1:-1000}
+order=${2:-20}
+here=$(cd "$(dirname "$0")" && pwd)
+vams=$here/../../vams
+
+for ss in 0 1; do
+  awk -v n="$n" -v k="$order" -v ss="$ss" -v vams="$vams" 'BEGIN {
+    print "attach " vams "/vsine.so"
+    print "verilog"
+    print "va_laplace_order " (ss ? k : 0)
+    # (s+1)^k
+    d = ".d0(1)"; c = 1
+    for (j = 1; j <= k; ++j) {
+      c = c * (k - j + 1) / j
+      d = d sprintf(", .d%d(%d)", j, c)
+    }
+    print "vsine #(.ampl(1), .freq(100m)) v1(in, 0);"
+    for (i = 0; i < n; ++i) {
+      printf "va_laplace_nd #(%s, .n0(1)) b%d (0, o%d, in, 0);\n", d, i, i
+      printf "resistor #(1) r%d (o%d, 0);\n", i, i
+    }
+    print "print tran v(o0)"
+    print "tran 100m 20 trace=n > /dev/null"
+    print "status"
+  }' > laplace_$ss.gc
+
+  echo "$n instances, order $order, va_laplace_order $([ $ss = 1 ] && echo "$order" || echo 0)"
+  if [ -x /usr/bin/time ]; then
+    /usr/bin/time -f "%e s, max RSS %M kB" gnucap -b laplace_$ss.gc
+  else
+    time gnucap -b laplace_$ss.gc
+  fi
+done
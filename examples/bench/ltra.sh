@@ -0,0 +1,41 @@
+#!/bin/sh
+# time a transient run with many RC lines, the 192 section chain from
+# ../trln/rc_chain.gc vs. ltra, and compare the waveforms.
+# usage: ltra.sh [instances] [modes]
+
+n=${1:-100}
+modes=${2:-16}
+here=$(cd "$(dirname "$0")" && pwd)
+chain=$here/../trln/rc_chain.gc
+
+for dev in chain ltra; do
+  {
+    echo "spice"
+    sed -n '/^\.subckt net /,/^X1 nout1 /p' "$chain" | sed '$d'
+    echo "V30 in 0 pulse(0 1.8 0p 100p 100p .5n 1n)"
+    echo "verilog"
+    awk -v n="$n" -v m="$modes" -v dev="$dev" 'BEGIN {
+      for (i = 0; i < n; ++i) {
+        if (dev == "chain") {
+          printf "net x%d (o%d, in, 0);\n", i, i
+        } else {
+          printf "ltra #(.len(192), .r(2.224404), .l(0), .c(2.080806f), .modes(%d)) t%d (in, 0, o%d, 0);\n", m, i, i
+        }
+      }
+    }'
+    echo "print tran v(o0)"
+    echo "tran 1p 2n trace=n > ltra_$dev.out"
+    echo "status"
+  } > ltra_$dev.gc
+
+  echo "$n instances, $dev$([ $dev = ltra ] && echo ", $modes modes")"
+  if [ -x /usr/bin/time ]; then
+    /usr/bin/time -f "%e s, max RSS %M kB" gnucap -b ltra_$dev.gc
+  else
+    time gnucap -b ltra_$dev.gc
+  fi
+done
+
+paste ltra_chain.out ltra_ltra.out | awk '!/^#/ {
+  d = $2 - $4; if (d < 0) d = -d; if (d > m) m = d
+} END { print "max |v(chain) - v(ltra)|: " m }'
@@ -0,0 +1,37 @@
+#!/bin/sh
+# time the preprocessor on a synthetic include tree, count allocations.
+# usage: pp.sh [files] [lines per file] [older gnucap-mg-vams, to compare]
+
+n=${1:-2000}
+l=${2:-200}
+old=$3
+
+mkdir -p pp_inc
+awk -v n="$n" -v l="$l" 'BEGIN {
+  for (i = 0; i < n; ++i) {
+    f = sprintf("pp_inc/f%d.vams", i)
+    printf "`ifndef F%d\n`define F%d\n", i, i > f
+    printf "`define M%d(a, b) ((a) / (b) + %d)\n", i, i > f
+    for (j = 0; j < l; ++j) {
+      printf "// comment %d\nparameter real p%d_%d = `M%d(%d, 2) / 3; /* c */\n", j, i, j, i, j > f
+    }
+    printf "`endif\n" > f
+    close(f)
+    print "`include \"" f "\""
+  }
+}' > pp.vams
+
+echo "$n files, $l lines each, $(cat pp_inc/*.vams | wc -c) bytes"
+for mg in gnucap-mg-vams $old; do
+  echo "== $mg"
+  if [ -x /usr/bin/time ]; then
+    /usr/bin/time -f "%e s, max RSS %M kB" $mg --pp pp.vams > /dev/null
+  else
+    time $mg --pp pp.vams > /dev/null
+  fi
+  if command -v valgrind > /dev/null; then
+    valgrind $mg --pp pp.vams 2>&1 > /dev/null | grep "total heap usage"
+  else
+    echo "no valgrind, no allocation count"
+  fi
+done
@@ -0,0 +1,21 @@
+#!/bin/sh
+# time parsing a synthetic netlist with many parametrised instances.
+# usage: set_param.sh [instances]
+
+n=${1:-100000}
+here=$(cd "$(dirname "$0")" && pwd)
+vams=$here/../../vams
+
+gnucap-mg-vams -I "$vams" --cc "$vams"/resistor.vams | \
+  g++ -xc++ `gnucap-conf --cppflags` -O2 -fPIC -shared - -o resistor.so || exit 1
+
+awk -v n="$n" 'BEGIN {
+  print "attach ./resistor.so"
+  print "verilog"
+  for (i = 0; i < n; ++i) {
+    printf "resistor #(.r(1k), .tc1(1m), .tc2(1u), .noisy(0), .tnom(27), .m(1)) r%d (n%d, 0);\n", i, i
+  }
+}' > set_param.gc
+
+echo "$n instances"
+time gnucap -b set_param.gc > /dev/null
@@ -0,0 +1,51 @@
+#!/bin/sh
+# time a transient run of a model with many ports, each contribution
+# reading all of them, with and without --optimize-simd.
+# usage: simd.sh [instances] [ports]
+
+n=${1:-1000}
+k=${2:-8}
+here=$(cd "$(dirname "$0")" && pwd)
+vams=$here/../../vams
+
+awk -v k="$k" 'BEGIN {
+  printf "`include \"disciplines.vams\"\n"
+  printf "module dense%d(", k
+  for (j = 0; j < k; ++j) printf "%sp%d", (j ? ", " : ""), j
+  print ");"
+  for (j = 0; j < k; ++j) printf "electrical p%d;\n", j
+  print "analog begin"
+  printf "  real s;\n  s = 0."
+  for (j = 0; j < k; ++j) printf " + V(p%d)", j
+  print ";"
+  for (j = 0; j < k; ++j) {
+    printf "  I(p%d) <+ 1u * exp(s / %d.) * V(p%d) / (1. + s * s);\n", j, k, j
+  }
+  print "end"
+  print "endmodule"
+}' > dense$k.va
+
+for opt in "" --optimize-simd; do
+  gnucap-mg-vams -I "$vams" $opt --cc dense$k.va | \
+    g++ -xc++ `gnucap-conf --cppflags` -O2 -march=native -fPIC -shared - \
+      -o dense$k.so || exit 1
+
+  awk -v n="$n" -v k="$k" -v vams="$vams" 'BEGIN {
+    print "attach " vams "/vsine.so"
+    print "attach ./dense" k ".so"
+    print "verilog"
+    print "vsine #(.ampl(1), .freq(10m)) v1(in, 0);"
+    for (i = 0; i < n; ++i) {
+      printf "dense%d d%d(", k, i
+      for (j = 0; j < k; ++j) printf "%sn%d_%d", (j ? ", " : ""), i, j
+      print ");"
+      for (j = 0; j < k; ++j) printf "resistor #(1k) r%d_%d (in, n%d_%d);\n", i, j, i, j
+    }
+    print "print tran v(n0_0)"
+    print "tran 1 100 trace=n > /dev/null"
+    print "status"
+  }' > dense.gc
+
+  echo "$n instances, $k ports ${opt:-scalar}"
+  time gnucap -b dense.gc > /dev/null
+done
@@ -0,0 +1,47 @@
+#!/bin/sh
+# time a transient run of a model with many ports, each contribution
+# reading two of them, with and without --optimize-sparse.
+# usage: sparse.sh [instances] [ports]
+
+n=${1:-2000}
+k=${2:-16}
+
+awk -v k="$k" 'BEGIN {
+  printf "`include \"disciplines.vams\"\n"
+  printf "module sparse%d(", k
+  for (j = 0; j < k; ++j) printf "%sp%d", (j ? ", " : ""), j
+  print ");"
+  for (j = 0; j < k; ++j) printf "electrical p%d;\n", j
+  print "analog begin"
+  for (j = 0; j < k; ++j) {
+    printf "  I(p%d) <+ 1u * exp(V(p%d) / 1.) * tanh(V(p%d));\n", j, j, (j+1) % k
+  }
+  print "end"
+  print "endmodule"
+}' > sparse$k.va
+
+here=$(cd "$(dirname "$0")" && pwd)
+vams=$here/../../vams
+for opt in "" --optimize-sparse; do
+  gnucap-mg-vams -I "$vams" $opt --cc sparse$k.va | \
+    g++ -xc++ `gnucap-conf --cppflags` -O2 -fPIC -shared - -o sparse$k.so || exit 1
+
+  awk -v n="$n" -v k="$k" -v vams="$vams" 'BEGIN {
+    print "attach " vams "/vsine.so"
+    print "attach ./sparse" k ".so"
+    print "verilog"
+    print "vsine #(.ampl(1), .freq(10m)) v1(in, 0);"
+    for (i = 0; i < n; ++i) {
+      printf "sparse%d d%d(", k, i
+      for (j = 0; j < k; ++j) printf "%sn%d_%d", (j ? ", " : ""), i, j
+      print ");"
+      for (j = 0; j < k; ++j) printf "resistor #(1k) r%d_%d (in, n%d_%d);\n", i, j, i, j
+    }
+    print "print tran v(n0_0)"
+    print "tran 1 100 trace=n > /dev/null"
+    print "status"
+  }' > sparse.gc
+
+  echo "$n instances, $k ports ${opt:-dense}"
+  time gnucap -b sparse.gc > /dev/null
+done
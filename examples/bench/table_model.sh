@@ -0,0 +1,61 @@
+#!/bin/sh
+# time a transient run with many instances reading two shared tables,
+# one input and two inputs, about 10^5 points each.
+# usage: table_model.sh [instances] [points]
+
+n=${1:-1000}
+np=${2:-100000}
+here=$(cd "$(dirname "$0")" && pwd)
+vams=$here/../../vams
+
+awk -v np="$np" 'BEGIN {
+  for (i = 0; i < np; ++i) {
+    x = -2 + 4 * i / (np - 1)
+    printf "%.12g %.12g\n", x, 1e-3 * (exp(x) - 1)
+  }
+}' > table_1.tbl
+
+awk -v np="$np" 'BEGIN {
+  m = int(sqrt(np))
+  for (i = 0; i < m; ++i) {
+    for (j = 0; j < m; ++j) {
+      x = -2 + 4 * i / (m - 1)
+      y = 2 * j / (m - 1)
+      printf "%.12g %.12g %.12g\n", x, y, 1e-3 * x * (1 + y * y)
+    }
+  }
+}' > table_2.tbl
+
+for ctrl in 1L 3L; do
+  cat > table_$ctrl.va <<EOT
+\`include "disciplines.vams"
+module table_$ctrl(p, n, c);
+	inout p, n, c;
+	electrical p, n, c;
+	analog begin
+		I(p, n) <+ \$table_model(V(p, n), "table_1.tbl", "$ctrl");
+		I(p, n) <+ \$table_model(V(p, n), V(c), "table_2.tbl", "$ctrl,$ctrl");
+	end
+endmodule
+EOT
+  gnucap-mg-vams -I "$vams" --cc table_$ctrl.va | \
+    g++ -xc++ `gnucap-conf --cppflags` -O2 -fPIC -shared - -o table_$ctrl.so || exit 1
+
+  awk -v n="$n" -v ctrl="$ctrl" -v vams="$vams" 'BEGIN {
+    print "attach " vams "/vsine.so"
+    print "attach ./table_" ctrl ".so"
+    print "verilog"
+    print "vsine #(.ampl(1.5), .freq(1k)) v1(in, 0);"
+    print "vsine #(.ampl(1), .freq(300)) v2(c, 0);"
+    for (i = 0; i < n; ++i) {
+      printf "resistor #(100) r%d (in, p%d);\n", i, i
+      printf "table_%s #() t%d (p%d, 0, c);\n", ctrl, i, i
+    }
+    print "print tran v(p0)"
+    print "tran 10u 10m trace=n > /dev/null"
+    print "status"
+  }' > table_$ctrl.gc
+
+  echo "$n instances, $np points, $ctrl"
+  time gnucap -b table_$ctrl.gc
+done
@@ -0,0 +1,30 @@
+#!/bin/sh
+# time a transient run with many white and flicker noise sources,
+# va_trnoise off vs. on.
+# usage: trnoise.sh [instances] [steps]
+
+n=${1:-1000}
+steps=${2:-100000}
+
+for on in off on; do
+  awk -v n="$n" -v steps="$steps" -v on="$on" 'BEGIN {
+    print "verilog"
+    print "va_trnoise " on " seed=1 fmin=1 fmax=1e9"
+    for (i = 0; i < n; ++i) {
+      printf "white_noise #(.pwr(1e-20)) w%d (o%d, 0);\n", i, i
+      printf "flicker_noise #(.pwr(1e-16), .e(1)) f%d (o%d, 0);\n", i, i
+      printf "resistor #(1k) r%d (o%d, 0);\n", i, i
+      printf "capacitor #(1p) c%d (o%d, 0);\n", i, i
+    }
+    print "print tran v(o0)"
+    printf "tran 0 %g 1n dtmax=1n trace=n > /dev/null\n", steps * 1e-9
+    print "status"
+  }' > trnoise_$on.gc
+
+  echo "$n instances, $steps steps, va_trnoise $on"
+  if [ -x /usr/bin/time ]; then
+    /usr/bin/time -f "%e s, max RSS %M kB" gnucap -b trnoise_$on.gc
+  else
+    time gnucap -b trnoise_$on.gc
+  fi
+done
@@ -25,6 +25,7 @@
 #include <u_parameter.h>
 #include <globals.h>
 #include <d_dot.h>
+#include "e_va.h"
 /*--------------------------------------------------------------------------*/
 namespace {
 /*--------------------------------------------------------------------------*/
@@ -159,12 +160,22 @@ public:
       std::string range_expr = "1";
       std::string range_type;
       size_t here = cmd.cursor();
+      // the numeric ones, for VA_OVERLOADS
+      struct RANGE {
+	double lb, ub;
+	bool lb_closed, ub_closed, exclude;
+      };
+      std::vector<RANGE> ranges;
 
       for(;;){
+	RANGE r;
+	bool numeric = true;
 	if(cmd >> "from "){
 	  range_expr = range_expr + "*(";
+	  r.exclude = false;
 	}else if(cmd>> "exclude ") { untested();
 	  range_expr = range_expr + "*(1-";
+	  r.exclude = true;
 	}else{
 	  break;
 	}
@@ -192,14 +203,18 @@ public:
 	    assert(lb_);
 	    if(!lb_){ untested();
 	      incomplete();
+	      numeric = false;
 	    }else if(auto ii = dynamic_cast<Integer const*>(lb_)){
 	      incomplete();
 	      lb = to_string(ii->value());
+	      r.lb = ii->value();
 	    }else if(auto ff = dynamic_cast<Float const*>(lb_)){
 	      incomplete();
 	      lb = to_string(ff->value());
+	      r.lb = ff->value();
 	    }else{
 	      incomplete();
+	      numeric = false;
 	    }
 	  }
 
@@ -213,12 +228,16 @@ public:
 	    Base const* ub_ = LL.value();
 	    if(!ub_){ untested();
 	      incomplete();
+	      numeric = false;
 	    }else if(auto ii = dynamic_cast<Integer const*>(ub_)){
 	      ub = to_string(ii->value());
+	      r.ub = ii->value();
 	    }else if(auto ff = dynamic_cast<Float const*>(ub_)){
 	      ub = to_string(ff->value());
+	      r.ub = ff->value();
 	    }else{
 	      incomplete();
+	      numeric = false;
 	    }
 	  }
 	  trace2("bounds", lb, ub);
@@ -230,11 +249,18 @@ public:
 	  }else{ untested();
 	  }
 	  what = "(" + lb + lo + Name + ")*(" + Name + uo + ub + ")";
+	  r.lb_closed = (lo == "<=");
+	  r.ub_closed = (uo == "<=");
 	}else{ untested();
 	  cmd >> what;
 	  what = "(" + Name + "==" + what + ")";
+	  numeric = false;
 	}
 	range_expr = range_expr + what + ")";
+	if(numeric){
+	  ranges.push_back(r);
+	}else{
+	}
 	if(cmd.skip1(',')){ untested();
 	  break;
 	}else{
@@ -270,6 +296,13 @@ public:
 	trace2("c_param", IS_VALID, range_expr);
 	pl->set(IS_VALID, range_expr);
       }
+
+      if(auto o = dynamic_cast<VA_OVERLOADS*>(command_dispatcher["va_overload"])){
+	for(auto const& r : ranges){
+	  o->add_range(Scope, Name, r.lb, r.ub, r.lb_closed, r.ub_closed, r.exclude);
+	}
+      }else{ untested();
+      }
     }
     cmd.check(bDANGER, "syntax error");
   }
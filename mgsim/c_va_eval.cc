@@ -0,0 +1,247 @@
+/*                     -*- C++ -*-
+ * Copyright (C) 2023 Felix Salfelder
+ *
+ * This file is part of "Gnucap", the Gnu Circuit Analysis Package
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *------------------------------------------------------------------
+ * work stealing evaluator for batched modelgen devices
+ *
+ * va_eval <n>   evaluate batches with n threads, including the caller
+ * va_eval       show the current number of threads
+ *
+ * Each run splits the index range evenly. A thread works through its own
+ * range from the front, a chunk at a time. When it runs dry, it steals the
+ * back half of another range.
+ */
+#include <c_comand.h>
+#include <globals.h>
+#include "e_va.h"
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+/*--------------------------------------------------------------------------*/
+namespace {
+/*--------------------------------------------------------------------------*/
+class RANGE {
+  std::mutex _m;
+  size_t _begin{0};
+  size_t _end{0};
+public:
+  void set(size_t b, size_t e) {
+    std::lock_guard<std::mutex> l(_m);
+    _begin = b;
+    _end = e;
+  }
+  // take up to n from the front.
+  bool pop_front(size_t* b, size_t* e, size_t n) {
+    std::lock_guard<std::mutex> l(_m);
+    if(_begin < _end){
+      *b = _begin;
+      _begin = std::min(_begin + n, _end);
+      *e = _begin;
+      return true;
+    }else{
+      return false;
+    }
+  }
+  // take the back half, at least one.
+  bool steal(size_t* b, size_t* e) {
+    std::lock_guard<std::mutex> l(_m);
+    if(_begin < _end){
+      size_t mid = _begin + (_end - _begin) / 2;
+      *b = mid;
+      *e = _end;
+      _end = mid;
+      return true;
+    }else{
+      return false;
+    }
+  }
+};
+/*--------------------------------------------------------------------------*/
+class CMD_VA_EVAL : public CMD, public VA_EVAL_POOL {
+  std::vector<std::thread> _workers;
+  std::unique_ptr<RANGE[]> _ranges; // one per thread, the caller is 0.
+  size_t _np{1};
+  size_t _chunk{1}; // items per lock
+  std::mutex _m;
+  std::condition_variable _start;
+  std::condition_variable _done;
+  size_t _generation{0};
+  size_t _active{0};
+  bool _stop{false};
+  TASK const* _task{NULL};
+  std::exception_ptr _error;
+public:
+  explicit CMD_VA_EVAL() : CMD(), _ranges(new RANGE[1]) {}
+  ~CMD_VA_EVAL() {
+    set_threads(1);
+  }
+private: // CMD
+  void do_it(CS& cmd, CARD_LIST*)override {
+    if(cmd.more()){
+      int n = cmd.ctoi();
+      cmd.check(bWARNING, "what's this?");
+      set_threads(size_t(std::max(n, 1)));
+    }else{
+      IO::mstdout << "va_eval " << _np << '\n';
+    }
+  }
+private: // VA_EVAL_POOL
+  void run(TASK const& t, size_t n)override;
+private:
+  void set_threads(size_t n);
+  void worker(size_t k, size_t seen);
+  void work(size_t k);
+  bool next(size_t k, size_t* b, size_t* e);
+} p;
+DISPATCHER<CMD>::INSTALL d(&command_dispatcher, "va_eval", &p);
+/*--------------------------------------------------------------------------*/
+void CMD_VA_EVAL::set_threads(size_t n)
+{
+  {
+    std::lock_guard<std::mutex> l(_m);
+    _stop = true;
+  }
+  _start.notify_all();
+  for(auto& w : _workers){
+    w.join();
+  }
+  _workers.clear();
+  _stop = false;
+
+  _np = std::max(n, size_t(1));
+  _ranges.reset(new RANGE[_np]);
+  for(size_t k = 1; k < _np; ++k){
+    _workers.emplace_back(&CMD_VA_EVAL::worker, this, k, _generation);
+  }
+}
+/*--------------------------------------------------------------------------*/
+void CMD_VA_EVAL::run(TASK const& t, size_t n)
+{
+  size_t np = _np;
+  if(np < 2 || n < 2){
+    for(size_t i = 0; i < n; ++i){
+      t(i);
+    }
+    return;
+  }else{
+  }
+
+  {
+    std::lock_guard<std::mutex> l(_m);
+    for(size_t k = 0; k < np; ++k){
+      _ranges[k].set(n * k / np, n * (k+1) / np);
+    }
+    // about eight chunks per thread, leaves something to steal.
+    _chunk = std::max(n / (8 * np), size_t(1));
+    _task = &t;
+    _error = nullptr;
+    _active = np - 1;
+    ++_generation;
+  }
+  _start.notify_all();
+
+  work(0);
+
+  std::exception_ptr e;
+  {
+    std::unique_lock<std::mutex> l(_m);
+    _done.wait(l, [this]{ return _active == 0; });
+    _task = NULL;
+    e = _error;
+  }
+  if(e){
+    std::rethrow_exception(e);
+  }else{
+  }
+}
+/*--------------------------------------------------------------------------*/
+void CMD_VA_EVAL::worker(size_t k, size_t seen)
+{
+  for(;;){
+    {
+      std::unique_lock<std::mutex> l(_m);
+      _start.wait(l, [this, seen]{ return _stop || _generation != seen; });
+      if(_stop){
+	return;
+      }else{
+      }
+      seen = _generation;
+    }
+
+    work(k);
+
+    {
+      std::lock_guard<std::mutex> l(_m);
+      assert(_active);
+      if(--_active == 0){
+	_done.notify_all();
+      }else{
+      }
+    }
+  }
+}
+/*--------------------------------------------------------------------------*/
+void CMD_VA_EVAL::work(size_t k)
+{
+  assert(_task);
+  size_t b, e;
+  while(next(k, &b, &e)){
+    try{
+      for(size_t i = b; i < e; ++i){
+	(*_task)(i);
+      }
+    }catch(...){
+      std::lock_guard<std::mutex> l(_m);
+      if(!_error){
+	_error = std::current_exception();
+      }else{
+      }
+    }
+  }
+}
+/*--------------------------------------------------------------------------*/
+// a chunk of the own range first, then steal, starting with the next
+// neighbour.
+bool CMD_VA_EVAL::next(size_t k, size_t* b, size_t* e)
+{
+  if(_ranges[k].pop_front(b, e, _chunk)){
+    return true;
+  }else{
+  }
+  size_t np = _np;
+  for(size_t j = 1; j < np; ++j){
+    size_t sb, se;
+    if(_ranges[(k+j) % np].steal(&sb, &se)){
+      assert(sb < se);
+      *b = sb;
+      *e = std::min(sb + _chunk, se);
+      _ranges[k].set(*e, se);
+      return true;
+    }else{
+    }
+  }
+  return false;
+}
+/*--------------------------------------------------------------------------*/
+} // namespace
+/*--------------------------------------------------------------------------*/
+// vim:ts=8:sw=2:noet
@@ -0,0 +1,135 @@
+/*                     -*- C++ -*-
+ * Copyright (C) 2023 Felix Salfelder
+ *
+ * This file is part of "Gnucap", the Gnu Circuit Analysis Package
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *------------------------------------------------------------------
+ * time spent in devices generated with --gen-profile, and bypass hit
+ * rates in devices generated with --optimize-bypass
+ *
+ * va_prof         print tables, one row per model type and method
+ * va_prof calls   same, without the times, for reproducible output
+ * va_prof clear   reset all counters
+ *
+ * Counters are per model type, summed over all instances.
+ */
+#include <c_comand.h>
+#include <globals.h>
+#include <e_cardlist.h>
+#include <e_card.h>
+#include "e_va.h"
+#include <typeinfo>
+#include <iomanip>
+#include <sstream>
+#include <map>
+/*--------------------------------------------------------------------------*/
+namespace {
+/*--------------------------------------------------------------------------*/
+// the methods, as in tr_probe_num prof.<what>_ns
+static char const* what[] = {
+  "eval", "probes", "needs_eval", "review", "accept", "precalc"
+};
+/*--------------------------------------------------------------------------*/
+class CMD_VA_PROF : public CMD {
+  // one instance per model type
+  typedef std::map<std::string, CARD const*> MAP;
+public:
+  void do_it(CS& cmd, CARD_LIST* scope)override {
+    MAP m;
+    collect(&m, scope);
+    if(cmd >> "clear"){
+      for(auto const& i : m){
+	dynamic_cast<VA_PROFILED const*>(i.second)->prof_clear();
+      }
+    }else if(cmd >> "calls"){
+      print(m, false);
+    }else{
+      cmd.check(bWARNING, "what's this?");
+      print(m, true);
+    }
+  }
+private:
+  void collect(MAP* m, CARD_LIST const* scope)const {
+    assert(scope);
+    for(CARD const* c : *scope){
+      if(dynamic_cast<VA_PROFILED const*>(c)){
+	m->insert(std::make_pair(std::string(typeid(*c).name()), c));
+      }else{
+      }
+      if(c->subckt()){
+	collect(m, c->subckt());
+      }else{
+      }
+    }
+  }
+  void print(MAP const& m, bool times)const {
+    std::ostringstream o;
+    o << std::left << std::setw(16) << "model" << std::setw(12) << "method"
+      << std::right << std::setw(14) << "calls";
+    if(times){
+      o << std::setw(16) << "ns" << std::setw(12) << "ns/call";
+    }else{
+    }
+    o << '\n';
+    for(auto const& i : m){
+      CARD const* c = i.second;
+      for(char const* w : what){
+	double calls = c->tr_probe_num(std::string("prof.") + w + "_calls");
+	double ns = c->tr_probe_num(std::string("prof.") + w + "_ns");
+	if(calls > 0.){
+	  o << std::left << std::setw(16) << c->dev_type() << std::setw(12) << w
+	    << std::right << std::setw(14) << std::fixed << std::setprecision(0) << calls;
+	  if(times){
+	    o << std::setw(16) << ns << std::setw(12) << std::setprecision(1) << ns / calls;
+	  }else{
+	  }
+	  o << '\n';
+	}else{
+	}
+      }
+    }
+
+    bool head = false;
+    for(auto const& i : m){
+      CARD const* c = i.second;
+      double hits = c->tr_probe_num("bypass.hits");
+      double evals = c->tr_probe_num("bypass.evals");
+      if(hits < 0. || evals < 0.){
+	// not generated with bypass, or NOT_VALID
+      }else if(hits + evals > 0.){
+	if(!head){
+	  o << std::left << std::setw(16) << "model" << std::right
+	    << std::setw(14) << "hits" << std::setw(14) << "evals"
+	    << std::setw(12) << "rate" << '\n';
+	  head = true;
+	}else{
+	}
+	o << std::left << std::setw(16) << c->dev_type() << std::right
+	  << std::setw(14) << std::fixed << std::setprecision(0) << hits
+	  << std::setw(14) << evals << std::setw(12) << std::setprecision(3)
+	  << hits / (hits + evals) << '\n';
+      }else{
+      }
+    }
+    IO::mstdout << o.str();
+  }
+} p;
+DISPATCHER<CMD>::INSTALL d(&command_dispatcher, "va_prof", &p);
+/*--------------------------------------------------------------------------*/
+} // namespace
+/*--------------------------------------------------------------------------*/
+// vim:ts=8:sw=2:noet
@@ -19,16 +19,66 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
  * 02110-1301, USA.
  *------------------------------------------------------------------
- * Transmission line, RLGC and length. baseline model WIP: tran
+ * Transmission line, RLGC and length.
+ *
+ * Transient by recursive convolution. The y parameters expand into modes,
+ *   Y11 = y_0 + sum_k y_k,  Y12 = -y_0 - sum_k (-1)^k y_k,
+ *   y_0 = 1/(len Z),  y_k = 2 len Y / (len^2 Z Y + k^2 pi^2),
+ * with Z = R+sL, Y = G+sC. Even modes are driven by v1-v2, odd modes by
+ * v1+v2. Each mode is one or two exponentials, integrated exactly over a
+ * step with the port voltage linear in time, O(1) per mode and step. The
+ * first "modes" modes are exact, higher ones are lumped in groups that
+ * keep their capacitance. The dc admittance is exact.
  */
 #include "globals.h"
-#include "m_wave.h"
 #include "e_elemnt.h"
 /*--------------------------------------------------------------------------*/
 namespace {
 /*--------------------------------------------------------------------------*/
 enum {NUM_INIT_COND = 4};
 /*--------------------------------------------------------------------------*/
+// y(s) = c + sum r/(s-p). a complex pair is stored once.
+class LTRA_ADMITTANCE {
+public:
+  struct POLE {
+    COMPLEX p;
+    COMPLEX r;
+    bool pair;
+  };
+private:
+  double _c;
+  std::vector<POLE> _pole;
+public:
+  explicit LTRA_ADMITTANCE() : _c(0.) {}
+  void clear() {_c = 0.; _pole.clear();}
+  void add(double n0, double n1, double d0, double d1, double d2);
+  void add_conductance(double g) {_c += g;}
+  double c()const {return _c;}
+  size_t size()const {return _pole.size();}
+  POLE const& pole(size_t i)const {return _pole[i];}
+  double dc()const;
+};
+/*--------------------------------------------------------------------------*/
+// recursive convolution, one admittance.
+// x(t+h) = e x(t) + a v(t) + b v(t+h), i = c v + sum x
+class LTRA_STATE {
+  std::vector<COMPLEX> _x; // at the last accepted time
+  std::vector<COMPLEX> _e;
+  std::vector<COMPLEX> _a;
+  std::vector<COMPLEX> _b;
+  double _v; // input at the last accepted time
+  double _h; // step, _e, _a, _b are for
+  double _g; // c + sum b
+public:
+  explicit LTRA_STATE() : _v(0.), _h(0.), _g(0.) {}
+  void begin(LTRA_ADMITTANCE const&);
+  void set_step(LTRA_ADMITTANCE const&, double h);
+  double g()const {return _g;}
+  double hist(LTRA_ADMITTANCE const&)const;
+  void accept(double v);
+  void settle(LTRA_ADMITTANCE const&, double v);
+};
+/*--------------------------------------------------------------------------*/
 class COMMON_TRANSLINE : public COMMON_COMPONENT {
 public:
   PARAMETER<double> len;	/* length multiplier */
@@ -36,12 +86,13 @@ public:
   PARAMETER<double> L;
   PARAMETER<double> G;
   PARAMETER<double> C;
+  PARAMETER<int> modes;		/* exact modes, more are grouped */
   double   ic[NUM_INIT_COND];	/* initial conditions: v1, i1, v2, i2 */
   int	   icset;		/* flag: initial condition set */
 public:
-  double real_z0;
   double real_td;
-  double real_loss;
+  LTRA_ADMITTANCE _even;	/* v1-v2 -> i1, -i2 */
+  LTRA_ADMITTANCE _odd;		/* v1+v2 -> i1, i2 */
 private:
   explicit COMMON_TRANSLINE(const COMMON_TRANSLINE& p);
 public:
@@ -54,25 +105,29 @@ public:
   std::string	param_name(int)const override;
   std::string	param_name(int,int)const override;
   std::string	param_value(int)const override;
-  int param_count()const override {return (5 + COMMON_COMPONENT::param_count());}
+  int param_count()const override {return (6 + COMMON_COMPONENT::param_count());}
 public:
   void		precalc_last(const CARD_LIST*)override;
   std::string	name()const override		{untested(); return "transline";}
+private:
+  void		make_modes();
 };
 /*--------------------------------------------------------------------------*/
 class DEV_TRANSLINE : public ELEMENT {
 private:
-  WAVE	 _forward;
-  WAVE	 _reflect;
-  double _if0; // value of current source representing incident wave
-  double _ir0; // value of current source representing reflected wave
-  double _if1; // val of cs rep incident wave, one load ago
-  double _ir1; // val of cs rep reflected wave, one load ago
+  LTRA_STATE _even;
+  LTRA_STATE _odd;
+  double _time1; // last accepted time
+  double _g0[2]; // self and transadmittance, this step
+  double _g1[2]; // as loaded
+  double _h0[2]; // history current, port 1, port 2
+  double _h1[2]; // as loaded
   COMPLEX _y11;// AC equiv ckt
   COMPLEX _y12;// AC equiv ckt
 private:
   explicit	DEV_TRANSLINE(const DEV_TRANSLINE& p)
-    :ELEMENT(p), _forward(), _reflect(), _if0(0), _ir0(0), _if1(0), _ir1(0) {}
+    :ELEMENT(p), _even(), _odd(), _time1(0.),
+     _g0{0., 0.}, _g1{0., 0.}, _h0{0., 0.}, _h1{0., 0.} {}
 public:
   explicit	DEV_TRANSLINE(COMMON_COMPONENT* c=NULL);
 private: // override virtual
@@ -85,7 +140,7 @@ private: // override virtual
   int		net_nodes()const override	{return 4;}
   CARD*		clone()const override		{return new DEV_TRANSLINE(*this);}
   void		precalc_last()override;
-  void		tr_iwant_matrix()override;
+  void		tr_iwant_matrix()override	{tr_iwant_matrix_extended();}
   void		tr_begin()override;
   void		dc_advance()override;
   void		tr_advance()override;
@@ -111,16 +166,17 @@ private: // override virtual
   }
 private:
   void		setinitcond(CS&);
+  void		set_step();
 };
 /*--------------------------------------------------------------------------*/
 inline bool DEV_TRANSLINE::tr_needs_eval()const
 {
   assert(!is_q_for_eval());
-  return (_if0!=_if1 || _ir0!=_ir1);
+  return (_g0[0]!=_g1[0] || _g0[1]!=_g1[1] || _h0[0]!=_h1[0] || _h0[1]!=_h1[1]);
 }
 /*--------------------------------------------------------------------------*/
 inline double DEV_TRANSLINE::tr_involts()const
-{ untested();
+{
   return dn_diff(_n[IN1].v0(), _n[IN2].v0());
 }
 /*--------------------------------------------------------------------------*/
@@ -141,7 +197,123 @@ const double _default_R   (0);
 const double _default_L   (NOT_INPUT);
 const double _default_G   (0);
 const double _default_C   (NOT_INPUT);
+const int    _default_modes (16);
 const double LINLENTOL = .000001;
+const double MODE_GROUP_RATIO = 1.5;	/* grouped modes, k in [lo, lo*ratio] */
+const double MODE_GROUP_SPAN = 1e4;	/* up to k = span*(modes+1) */
+/*--------------------------------------------------------------------------*/
+// add (n0 + n1 s) / (d0 + d1 s + d2 s^2)
+void LTRA_ADMITTANCE::add(double n0, double n1, double d0, double d1, double d2)
+{
+  if (d2 != 0.) {
+    double disc = d1*d1 - 4.*d2*d0;
+    if (disc < 0.) {
+      COMPLEX p(-d1/(2.*d2), std::sqrt(-disc)/(2.*d2));
+      COMPLEX r = (n0 + n1*p) / (d2 * (p - std::conj(p)));
+      _pole.push_back(POLE{p, r, true});
+    }else{
+      double q = -.5 * (d1 + ((d1 < 0.) ? -std::sqrt(disc) : std::sqrt(disc)));
+      double p1 = q / d2;
+      double p2 = d0 / q;
+      if (p1 == p2) { untested();
+	p2 *= 1. + 1e-9;
+      }else{
+      }
+      _pole.push_back(POLE{p1, (n0 + n1*p1) / (d2 * (p1 - p2)), false});
+      _pole.push_back(POLE{p2, (n0 + n1*p2) / (d2 * (p2 - p1)), false});
+    }
+  }else if (d1 != 0.) {
+    double c = n1 / d1;
+    _c += c;
+    _pole.push_back(POLE{-d0/d1, (n0 - c*d0) / d1, false});
+  }else{
+    assert(d0 != 0.);
+    assert(n1 == 0.);
+    _c += n0 / d0;
+  }
+}
+/*--------------------------------------------------------------------------*/
+double LTRA_ADMITTANCE::dc()const
+{
+  double g = _c;
+  for (auto const& x : _pole) {
+    assert(x.p != 0.);
+    double y = (-x.r / x.p).real();
+    g += (x.pair) ? 2.*y : y;
+  }
+  return g;
+}
+/*--------------------------------------------------------------------------*/
+void LTRA_STATE::begin(LTRA_ADMITTANCE const& y)
+{
+  _x.assign(y.size(), 0.);
+  _e.assign(y.size(), 0.);
+  _a.assign(y.size(), 0.);
+  _b.assign(y.size(), 0.);
+  _v = 0.;
+  _h = 0.;
+  _g = y.c();
+}
+/*--------------------------------------------------------------------------*/
+// v linear over the step.
+//   int_0^h exp(p(h-t)) dt       = h phi1(ph), phi1(z) = (e^z-1)/z
+//   int_0^h exp(p(h-t)) t/h dt   = h phi2(ph), phi2(z) = (e^z-1-z)/z^2
+void LTRA_STATE::set_step(LTRA_ADMITTANCE const& y, double h)
+{
+  assert(h > 0.);
+  assert(_x.size() == y.size());
+  if (h == _h) {
+  }else{
+    _h = h;
+    _g = y.c();
+    for (size_t i = 0; i < y.size(); ++i) {
+      LTRA_ADMITTANCE::POLE const& x = y.pole(i);
+      COMPLEX z = x.p * h;
+      COMPLEX phi1, phi2;
+      if (std::abs(z) < 1e-3) {
+	phi1 = 1. + z * (.5 + z / 6.);
+	phi2 = .5 + z * (1. / 6. + z / 24.);
+      }else{
+	COMPLEX em1 = std::exp(z) - 1.;
+	phi1 = em1 / z;
+	phi2 = (em1 - z) / (z * z);
+      }
+      _e[i] = std::exp(z);
+      _a[i] = x.r * h * (phi1 - phi2);
+      _b[i] = x.r * h * phi2;
+      _g += (x.pair) ? 2.*_b[i].real() : _b[i].real();
+    }
+  }
+}
+/*--------------------------------------------------------------------------*/
+// i(t+h) = g v(t+h) + hist
+double LTRA_STATE::hist(LTRA_ADMITTANCE const& y)const
+{
+  double h = 0.;
+  for (size_t i = 0; i < _x.size(); ++i) {
+    double t = (_e[i] * _x[i] + _a[i] * _v).real();
+    h += (y.pole(i).pair) ? 2.*t : t;
+  }
+  return h;
+}
+/*--------------------------------------------------------------------------*/
+void LTRA_STATE::accept(double v)
+{
+  for (size_t i = 0; i < _x.size(); ++i) {
+    _x[i] = _e[i] * _x[i] + _a[i] * _v + _b[i] * v;
+  }
+  _v = v;
+}
+/*--------------------------------------------------------------------------*/
+// steady state
+void LTRA_STATE::settle(LTRA_ADMITTANCE const& y, double v)
+{
+  for (size_t i = 0; i < _x.size(); ++i) {
+    _x[i] = -y.pole(i).r / y.pole(i).p * v;
+  }
+  _v = v;
+}
+/*--------------------------------------------------------------------------*/
 /*--------------------------------------------------------------------------*/
 COMMON_TRANSLINE::COMMON_TRANSLINE(int c)
   :COMMON_COMPONENT(c),
@@ -150,7 +322,9 @@ COMMON_TRANSLINE::COMMON_TRANSLINE(int c)
    L(_default_L),
    G(_default_G),
    C(_default_C),
-   icset(false)
+   modes(_default_modes),
+   icset(false),
+   real_td(0.)
 {
   for (int i = 0;  i < NUM_INIT_COND;  ++i) {
     ic[i] = 0.;
@@ -164,7 +338,11 @@ COMMON_TRANSLINE::COMMON_TRANSLINE(const COMMON_TRANSLINE& p)
    L(p.L),
    G(p.G),
    C(p.C),
-   icset(p.icset)
+   modes(p.modes),
+   icset(p.icset),
+   real_td(p.real_td),
+   _even(p._even),
+   _odd(p._odd)
 {
   for (int i = 0;  i < NUM_INIT_COND;  ++i) {
     ic[i] = p.ic[i];
@@ -180,6 +358,7 @@ bool COMMON_TRANSLINE::operator==(const COMMON_COMPONENT& x)const
     && L == p->L
     && G == p->G
     && C == p->C
+    && modes == p->modes
     && icset == p->icset
     && COMMON_COMPONENT::operator==(x);
   if (rv) {
@@ -200,6 +379,7 @@ void COMMON_TRANSLINE::set_param_by_index(int I, std::string& Value, int Offset)
   case 2:  L = Value; break;
   case 3:  G = Value; break;
   case 4:  C = Value; break;
+  case 5:  modes = Value; break;
   default: COMMON_COMPONENT::set_param_by_index(I, Value, Offset); break;
   }
   //BUG// does not print IC
@@ -213,6 +393,7 @@ bool COMMON_TRANSLINE::param_is_printable(int I)const
   case 2:  return L.has_hard_value();
   case 3:  return G.has_hard_value();
   case 4:  return C.has_hard_value();
+  case 5:  return modes.has_hard_value();
   default: return COMMON_COMPONENT::param_is_printable(I);
   }
   //BUG// does not print IC
@@ -235,6 +416,7 @@ std::string COMMON_TRANSLINE::param_name(int I)const
   case 2:  return "l";
   case 3:  return "g";
   case 4:  return "c";
+  case 5:  return "modes";
   default: return COMMON_COMPONENT::param_name(I);
   }
   //BUG// does not print IC
@@ -262,6 +444,7 @@ std::string COMMON_TRANSLINE::param_value(int I)const
   case 2:  return L.string();
   case 3:  return G.string();
   case 4:  return C.string();
+  case 5:  return modes.string();
   default: return COMMON_COMPONENT::param_value(I);
   }
   //BUG// does not print IC
@@ -277,15 +460,93 @@ void COMMON_TRANSLINE::precalc_last(const CARD_LIST* Scope)
   L.e_val(_default_L, Scope);
   G.e_val(_default_G, Scope);
   C.e_val(_default_C, Scope);
+  modes.e_val(_default_modes, Scope);
 
-  // incomplete. how about transient?
+  real_td = double(len) * std::sqrt(double(L) * double(C));
+  make_modes();
+}
+/*--------------------------------------------------------------------------*/
+// sum 1/(a0 + pi^2 k^2), k = lo, lo+2, .. <= hi. midpoint rule if long.
+double mode_sum(double a0, long lo, long hi)
+{
+  assert(lo <= hi);
+  double s = 0.;
+  if (hi - lo < 64) {
+    for (long k = lo; k <= hi; k += 2) {
+      s += 1. / (a0 + M_PI * M_PI * double(k) * double(k));
+    }
+  }else{
+    long last = lo + 2 * ((hi - lo) / 2);
+    double k1 = double(lo - 1);
+    double k2 = double(last + 1);
+    if (a0 > 0.) {
+      double w = std::sqrt(a0);
+      double x1 = M_PI * k1 / w;
+      double x2 = M_PI * k2 / w;
+      s = .5 * std::atan((x2 - x1) / (1. + x1 * x2)) / (M_PI * w);
+    }else{
+      s = .5 * (1. / k1 - 1. / k2) / (M_PI * M_PI);
+    }
+  }
+  return s;
+}
+/*--------------------------------------------------------------------------*/
+void COMMON_TRANSLINE::make_modes()
+{
+  double l = len;
+  double r = std::max(double(R), OPT::shortckt / l);
+  double ll = L;
+  double g = G;
+  double cc = C;
+  double a0 = l * l * r * g;
+  double a1 = l * l * (r * cc + ll * g);
+  double a2 = l * l * ll * cc;
+  int n = std::max(int(modes), 0);
+
+  _even.clear();
+  _odd.clear();
+  _even.add(1., 0., l * r, l * ll, 0.);
+  for (int k = 1; k <= n; ++k) {
+    LTRA_ADMITTANCE& y = (k % 2) ? _odd : _even;
+    y.add(2. * l * g, 2. * l * cc, a0 + M_PI * M_PI * k * k, a1, a2);
+  }
+
+  // the rest, in groups of the same capacitance
+  long lo = n + 1;
+  long hi_max = long(MODE_GROUP_SPAN * (n + 1));
+  while (lo <= hi_max) {
+    long hi = std::max(lo + 1, long(lo * MODE_GROUP_RATIO));
+    for (long k = lo; k <= lo + 1; ++k) {
+      LTRA_ADMITTANCE& y = (k % 2) ? _odd : _even;
+      double w = double((hi - k) / 2 + 1);
+      double s = mode_sum(a0, k, hi);
+      y.add(w * 2. * l * g, w * 2. * l * cc, w / s, a1, a2);
+    }
+    lo = hi + 1;
+  }
+
+  // exact at dc
+  double ye, yo;
+  if (g > 0.) {
+    double y0 = std::sqrt(g / r);
+    double th = std::tanh(.5 * l * std::sqrt(r * g));
+    ye = .5 * y0 / th;
+    yo = .5 * y0 * th;
+  }else{
+    ye = 1. / (l * r);
+    yo = 0.;
+  }
+  _even.add_conductance(ye - _even.dc());
+  _odd.add_conductance(yo - _odd.dc());
+  trace3("COMMON_TRANSLINE::make_modes", n, _even.size(), _odd.size());
 }
 /*--------------------------------------------------------------------------*/
 /*--------------------------------------------------------------------------*/
 DEV_TRANSLINE::DEV_TRANSLINE(COMMON_COMPONENT* c)
   :ELEMENT(c),
-   _forward(), _reflect(),
-   _if0(0), _ir0(0), _if1(0), _ir1(0),
+   _even(), _odd(),
+   _time1(0.),
+   _g0{0., 0.}, _g1{0., 0.}, _h0{0., 0.}, _h1{0., 0.},
    _y11(), _y12()
 {
 }
@@ -293,77 +554,83 @@ DEV_TRANSLINE::DEV_TRANSLINE(COMMON_COMPONENT* c)
 void DEV_TRANSLINE::precalc_last()
 {
   ELEMENT::precalc_last();
-  const COMMON_TRANSLINE* c=prechecked_cast<const COMMON_TRANSLINE*>(common());
-  assert(c);
-  _forward.set_delay(c->real_td);
-  _reflect.set_delay(c->real_td);
   set_converged();
   assert(!is_constant());
 }
 /*--------------------------------------------------------------------------*/
-void DEV_TRANSLINE::tr_iwant_matrix()
-{
-  _sim->_aa.iwant(_n[OUT1].m_(),_n[OUT2].m_());
-  _sim->_aa.iwant(_n[IN1].m_(), _n[IN2].m_());
-  _sim->_lu.iwant(_n[OUT1].m_(),_n[OUT2].m_());
-  _sim->_lu.iwant(_n[IN1].m_(), _n[IN2].m_());
-}
-/*--------------------------------------------------------------------------*/
-/* first setup, initial dc, empty the lines
+/* first setup, initial dc, empty the line
  */
 void DEV_TRANSLINE::tr_begin()
 {
   ELEMENT::tr_begin();
   const COMMON_TRANSLINE* c=prechecked_cast<const COMMON_TRANSLINE*>(common());
   assert(c);
-  _forward.initialize().push(0.-c->real_td, 0.).push(0., 0.);
-  _reflect.initialize().push(0.-c->real_td, 0.).push(0., 0.);
+  _even.begin(c->_even);
+  _odd.begin(c->_odd);
+  _time1 = _sim->_time0;
+  _g1[0] = _g1[1] = 0.;
+  _h1[0] = _h1[1] = 0.;
+  _g0[0] = c->_even.dc() + c->_odd.dc();
+  _g0[1] = c->_odd.dc() - c->_even.dc();
+  _h0[0] = _h0[1] = 0.;
 }
 /*--------------------------------------------------------------------------*/
 /* before anything else .. see what is coming out
- * _if0 = output current ..
- * The "wave" class stores voltages, but we need currents,
- * because the simulator uses the Norton equivalent circuit.
- * This makes the Thevenin to Norton conversion.
+ * The history of the modes is a current source at each port, in
+ * parallel with the step admittance.
+ *   i1 = g11 v1 + g12 v2 + h1,  i2 = g12 v1 + g11 v2 + h2
  */
-void DEV_TRANSLINE::dc_advance()
+void DEV_TRANSLINE::set_step()
 {
-  ELEMENT::dc_advance();
   const COMMON_TRANSLINE* c=prechecked_cast<const COMMON_TRANSLINE*>(common());
   assert(c);
-  _if0 = 0.; incomplete(); // _forward.v_out(_sim->_time0).f0/c->real_z0;
-  _ir0 = 0.;  // _reflect.v_out(_sim->_time0).f0/c->real_z0;
+  double ge, go, he, ho;
+  double h = _sim->_time0 - _time1;
+  if (_sim->analysis_is_static()) {
+    ge = c->_even.dc();
+    go = c->_odd.dc();
+    he = ho = 0.;
+  }else if (h > 0.) {
+    _even.set_step(c->_even, h);
+    _odd.set_step(c->_odd, h);
+    ge = _even.g();
+    go = _odd.g();
+    he = _even.hist(c->_even);
+    ho = _odd.hist(c->_odd);
+  }else{ untested();
+    return;
+  }
+  _g0[0] = ge + go;
+  _g0[1] = go - ge;
+  _h0[0] = he + ho;
+  _h0[1] = ho - he;
 }
+/*--------------------------------------------------------------------------*/
+void DEV_TRANSLINE::dc_advance()
+{
+  ELEMENT::dc_advance();
+  set_step();
+}
+/*--------------------------------------------------------------------------*/
 void DEV_TRANSLINE::tr_advance()
 {
   ELEMENT::tr_advance();
-  const COMMON_TRANSLINE* c=prechecked_cast<const COMMON_TRANSLINE*>(common());
-  assert(c);
-  _if0 = 0.; incomplete(); // _forward.v_out(_sim->_time0).f0/c->real_z0;
-  _ir0 = 0.;  // _reflect.v_out(_sim->_time0).f0/c->real_z0;
+  set_step();
 }
+/*--------------------------------------------------------------------------*/
 void DEV_TRANSLINE::tr_regress()
 { untested();
   ELEMENT::tr_regress();
-  const COMMON_TRANSLINE* c=prechecked_cast<const COMMON_TRANSLINE*>(common());
-  assert(c);
-  _if0 = 0.; incomplete(); // _forward.v_out(_sim->_time0).f0/c->real_z0;
-  _ir0 = 0.;  // _reflect.v_out(_sim->_time0).f0/c->real_z0;
+  set_step();
 }
 /*--------------------------------------------------------------------------*/
 /* usually nothing, always converged.  It is all done in advance and accept.
- * UNLESS ... it is a very short line .. then we fake it here.
- * very short line means delay is less than internal time step.
  */
 bool DEV_TRANSLINE::do_tr()
-{ untested();
-  incomplete(); // won't work.
-  // code to deal with short lines goes here.
-  //if (_if0 != _if1  ||  _ir0 != _ir1) { untested();
-  if (!conchk(_if0, _if1, OPT::abstol, OPT::reltol*.01)
-       || !conchk(_ir0, _ir1, OPT::abstol, OPT::reltol*.01)) { untested();
+{
+  if (tr_needs_eval()) {
     q_load();
-  }else{ untested();
+  }else{
   }
   assert(converged());
   return true;
@@ -371,46 +638,37 @@ bool DEV_TRANSLINE::do_tr()
 /*--------------------------------------------------------------------------*/
 void DEV_TRANSLINE::tr_load()
 {
-  incomplete(); // won't work.
-		return;
-  //BUG// explicit mfactor
-  double lvf = NOT_VALID; // load value, forward
-  double lvr = NOT_VALID; // load value, reflected
-  if (!_sim->is_inc_mode()) { untested();
-    const COMMON_TRANSLINE* c = prechecked_cast<const COMMON_TRANSLINE*>(common());
-    assert(c);
-    _sim->_aa.load_symmetric(_n[OUT1].m_(), _n[OUT2].m_(), mfactor()/c->real_z0);
-    _sim->_aa.load_symmetric(_n[IN1].m_(),  _n[IN2].m_(),  mfactor()/c->real_z0);
-    lvf = _if0;
-    lvr = _ir0;
-  }else{ untested();
-    lvf = dn_diff(_if0, _if1);
-    lvr = dn_diff(_ir0, _ir1);
+  double d = dampdiff(&_g0[0], _g1[0]);
+  if (d != 0.) {
+    _sim->_aa.load_symmetric(_n[OUT1].m_(), _n[OUT2].m_(), d);
+    _sim->_aa.load_symmetric(_n[IN1].m_(),  _n[IN2].m_(),  d);
+  }else{
   }
-  if (lvf != 0.) { untested();
-    if (_n[OUT1].m_() != 0) { untested();
-      _n[OUT1].i() += mfactor() * lvf;
-    }else{untested();
-    }
-    if (_n[OUT2].m_() != 0) {untested();
-      _n[OUT2].i() -= mfactor() * lvf;
-    }else{ untested();
-    }
-  }else{ untested();
+  _g1[0] = _g0[0];
+
+  d = dampdiff(&_g0[1], _g1[1]);
+  if (d != 0.) {
+    _sim->_aa.load_asymmetric(_n[OUT1].m_(), _n[OUT2].m_(), _n[IN1].m_(), _n[IN2].m_(), d);
+    _sim->_aa.load_asymmetric(_n[IN1].m_(), _n[IN2].m_(), _n[OUT1].m_(), _n[OUT2].m_(), d);
+  }else{
   }
-  if (lvr != 0.) { untested();
-    if (_n[IN1].m_() != 0) { untested();
-      _n[IN1].i() += mfactor() * lvr;
-    }else{untested();
-    }
-    if (_n[IN2].m_() != 0) {untested();
-      _n[IN2].i() -= mfactor() * lvr;
-    }else{ untested();
+  _g1[1] = _g0[1];
+
+  for (int p = 0; p < 2; ++p) {
+    d = dampdiff(&_h0[p], _h1[p]);
+    if (d != 0.) {
+      if (_n[2*p].m_() != 0) {
+	_n[2*p].i() -= d;
+      }else{ untested();
+      }
+      if (_n[2*p+1].m_() != 0) { untested();
+	_n[2*p+1].i() += d;
+      }else{
+      }
+    }else{
     }
-  }else{ untested();
+    _h1[p] = _h0[p];
   }
-  _if1 = _if0;
-  _ir1 = _ir0;
 }
 /*--------------------------------------------------------------------------*/
 /* limit the time step to no larger than a line length.
@@ -420,21 +678,38 @@ TIME_PAIR DEV_TRANSLINE::tr_review()
   q_accept();
   const COMMON_TRANSLINE* c=prechecked_cast<const COMMON_TRANSLINE*>(common());
   assert(c);
-  return TIME_PAIR(_sim->_time0 + c->real_td, NEVER); // ok to miss the spikes, for now
+  if (c->real_td > 0.) {
+    return TIME_PAIR(_sim->_time0 + c->real_td, NEVER);
+  }else{ untested();
+    return TIME_PAIR(NEVER, NEVER);
+  }
 }
 /*--------------------------------------------------------------------------*/
-/* after this step is all done, determine the reflections and send them on.
+/* after this step is all done, move the modes along.
  */
 void DEV_TRANSLINE::tr_accept()
 {
   trace1(short_label().c_str(), _sim->_time0);
-  // incomplete
-//  _reflect.push(_sim->_time0, _forward.v_reflect(_sim->_time0, tr_outvolts()));
-//  _forward.push(_sim->_time0, _reflect.v_reflect(_sim->_time0, tr_involts()));
+  const COMMON_TRANSLINE* c=prechecked_cast<const COMMON_TRANSLINE*>(common());
+  assert(c);
+  double v1 = tr_outvolts();
+  double v2 = tr_involts();
+  if (_sim->analysis_is_static() || !(_sim->_time0 > _time1)) {
+    _even.settle(c->_even, v1 - v2);
+    _odd.settle(c->_odd, v1 + v2);
+  }else{
+    _even.accept(v1 - v2);
+    _odd.accept(v1 + v2);
+  }
+  _time1 = _sim->_time0;
 }
 /*--------------------------------------------------------------------------*/
 void DEV_TRANSLINE::tr_unload()
 {untested();
+  _g0[0] = _g0[1] = 0.;
+  _h0[0] = _h0[1] = 0.;
+  _sim->mark_inc_mode_bad();
+  tr_load();
 }
 /*--------------------------------------------------------------------------*/
 void DEV_TRANSLINE::do_ac()
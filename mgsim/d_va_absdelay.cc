@@ -51,12 +51,13 @@ public:
 class COMMON_ABSDELAY : public COMMON_DELAY {
 public:
   PARAMETER<double> _maxdelay{0.};
+  PARAMETER<int> _maxpoints{0}; // history bound, 0: unbounded
   std::string name()const override {return "va_delay";}
 public:
   ~COMMON_ABSDELAY();
   COMMON_ABSDELAY(int x) : COMMON_DELAY(x) {}
   COMMON_ABSDELAY(COMMON_ABSDELAY const& x) : COMMON_DELAY(x),
-     _maxdelay(x._maxdelay) {}
+     _maxdelay(x._maxdelay), _maxpoints(x._maxpoints) {}
   COMMON_ABSDELAY* clone()const override {return new COMMON_ABSDELAY(*this);}
 
   bool operator==(const COMMON_COMPONENT& x)const override;
@@ -210,6 +211,7 @@ void COMMON_ABSDELAY::precalc_last(const CARD_LIST* par_scope)
   COMMON_COMPONENT::precalc_last(par_scope);
   e_val(&_maxdelay, 1. , par_scope);
   e_val(&_delay, 1. , par_scope);
+  e_val(&_maxpoints, 0 , par_scope);
 }
 /*--------------------------------------------------------------------------*/
 bool COMMON_ABSDELAY::operator==(const COMMON_COMPONENT& x)const
@@ -217,6 +219,7 @@ bool COMMON_ABSDELAY::operator==(const COMMON_COMPONENT& x)const
   const COMMON_ABSDELAY* p = dynamic_cast<const COMMON_ABSDELAY*>(&x);
   return (p
     && _maxdelay == p->_maxdelay
+    && _maxpoints == p->_maxpoints
     && _delay == p->_delay
     && COMMON_COMPONENT::operator==(x));
 }
@@ -227,6 +230,8 @@ int COMMON_ABSDELAY::set_param_by_name(std::string Name, std::string Value)
     _delay = Value;
   }else if(Name == "maxdelay"){
     _maxdelay = Value;
+  }else if(Name == "maxpoints"){ untested();
+    _maxpoints = Value;
   }else{ untested();
     COMMON_COMPONENT::set_param_by_name(Name, Value);
   }
@@ -489,6 +494,7 @@ void DELAY::precalc_last()
   if(c){
   // move to void COMMON_ABSDELAY::precalc_last
     _forward.set_delay(c->_delay); // tr_begin?  tr_eval?
+    _forward.set_max_size(size_t(std::max(0, int(c->_maxpoints))));
   }else{
   }
   set_converged();
@@ -722,6 +728,9 @@ void COMMON_ABSDELAY::tr_accept(COMPONENT* c) const
     trace1("DELAY::accept", _sim->_time0 - e->_forward.last_time());
     e->_forward.push(_sim->_time0, e->tr_involts());
   }
+  // time does not go back past an accepted step.
+  // samples before the one bracketing _time0 are no longer needed.
+  e->_forward.cleanup(_sim->_time0);
 }
 /*--------------------------------------------------------------------------*/
 void COMMON_ABSDELAY::tr_advance(COMPONENT* c) const
@@ -31,6 +31,7 @@
 #include <e_node.h>
 #include <e_elemnt.h>
 #include <u_nodemap.h>
+#include <c_comand.h>
 #include "e_va.h"
 #include "e_rf.h"
 #include <u_limit.h>
@@ -237,6 +238,222 @@ public:
 }; //COMMON_LAPLACE_RP
 COMMON_LAPLACE_RP cl_rp(CC_STATIC);
 /*--------------------------------------------------------------------------*/
+// filters of this order and above are integrated internally, 0: never.
+int ss_order = 0;
+/*--------------------------------------------------------------------------*/
+class CMD_LAPLACE_ORDER : public CMD {
+public:
+  void do_it(CS& cmd, CARD_LIST*)override {
+    if(cmd.more()){
+      int n = cmd.ctoi();
+      cmd.check(bWARNING, "what's this?");
+      ss_order = std::max(n, 0);
+    }else{
+      IO::mstdout << "va_laplace_order " << ss_order << '\n';
+    }
+  }
+} p_order;
+DISPATCHER<CMD>::INSTALL d_order(&command_dispatcher, "va_laplace_order", &p_order);
+/*--------------------------------------------------------------------------*/
+// H(s) = N(s)/D(s) in controllable canonical form, in scaled time
+// tau = w0 t, so that the coefficients stay in range at high order.
+//   x_k' = x_{k+1},  x_n' = -sum a_k x_k + u,  y = sum c_k x_k + d u
+// A step of backward Euler or trapezoidal rule is solved in O(n). The
+// output is affine in the input, y = y0 + g u, with y0 and g fixed
+// during the step.
+class LAPLACE_SS {
+  std::vector<double> _a;
+  std::vector<double> _c;
+  double _d{0.};
+  double _w0{1.};
+  std::vector<double> _x;  // accepted state
+  double _u{0.};           // accepted input
+  std::vector<double> _xr; // step, u = 0
+  std::vector<double> _xb; // step, du
+  std::vector<double> _p;
+  std::vector<double> _q;
+  double _alpha{0.};
+  double _y0{0.};
+  double _g{0.};
+public:
+  int order()const {return int(_a.size());}
+  double y0()const {return _y0;}
+  double g()const {return _g;}
+  double state(int k)const {return _x[k];}
+
+  template<class C>
+  bool set(C const& num, C const& den);
+  void reset();
+  void dc();
+  void step(double h, bool trap);
+  void accept(double u, bool dc);
+private:
+  void solve(double const* r, double* x);
+  double output(double const* x)const;
+};
+/*--------------------------------------------------------------------------*/
+// ascending coefficients. false if improper, or no dynamics
+template<class C>
+bool LAPLACE_SS::set(C const& num, C const& den)
+{
+  int n = int(den.size()) - 1;
+  while(n > 0 && double(den[n]) == 0.){
+    --n;
+  }
+  int m = int(num.size()) - 1;
+  while(m > 0 && double(num[m]) == 0.){
+    --m;
+  }
+  if(n < 1 || m > n){ untested();
+    _a.clear();
+    _c.clear();
+    _d = 0.;
+    return false;
+  }else{
+  }
+
+  double dn = double(den[n]);
+  double d0 = double(den[0]);
+  if(d0 != 0.){
+    _w0 = std::pow(std::fabs(d0 / dn), 1. / n);
+  }else{ untested();
+    _w0 = 1.;
+  }
+  double lw = std::log(_w0);
+  double ldn = std::log(std::fabs(dn));
+  auto scaled = [&](double v, int i) {
+    if(v == 0.){
+      return 0.;
+    }else{
+      double s = (v < 0.) == (dn < 0.) ? 1. : -1.;
+      return s * std::exp(std::log(std::fabs(v)) - ldn + (i - n) * lw);
+    }
+  };
+
+  _a.resize(n);
+  for(int i = 0; i < n; ++i){
+    _a[i] = scaled(double(den[i]), i);
+  }
+  _d = (m == n) ? scaled(double(num[n]), n) : 0.;
+  _c.assign(n, 0.);
+  for(int i = 0; i < n; ++i){
+    double b = (i <= m) ? scaled(double(num[i]), i) : 0.;
+    _c[i] = b - _d * _a[i];
+  }
+
+  if(int(_x.size()) != n){
+    _x.assign(n, 0.);
+    _xr.resize(n);
+    _xb.resize(n);
+    _p.resize(n);
+    _q.resize(n);
+  }else{
+  }
+  return true;
+}
+/*--------------------------------------------------------------------------*/
+void LAPLACE_SS::reset()
+{
+  std::fill(_x.begin(), _x.end(), 0.);
+  _u = 0.;
+}
+/*--------------------------------------------------------------------------*/
+// steady state. a pole at 0 has none, pass through d then.
+void LAPLACE_SS::dc()
+{
+  _y0 = 0.;
+  if(_a.empty()){ untested();
+    _g = _d;
+  }else if(_a[0] != 0.){
+    _g = _c[0] / _a[0] + _d;
+  }else{ untested();
+    _g = _d;
+  }
+  _alpha = 0.;
+}
+/*--------------------------------------------------------------------------*/
+// (I - alpha A) x = r + alpha B u
+void LAPLACE_SS::step(double h, bool trap)
+{
+  int n = order();
+  assert(n);
+  _alpha = (trap ? .5 : 1.) * h * _w0;
+
+  // right hand side, into _xb as scratch
+  double* r = _xb.data();
+  for(int i = 0; i < n; ++i){
+    r[i] = _x[i];
+  }
+  if(trap){
+    for(int i = 0; i < n-1; ++i){
+      r[i] += _alpha * _x[i+1];
+    }
+    double s = _u;
+    for(int i = 0; i < n; ++i){
+      s -= _a[i] * _x[i];
+    }
+    r[n-1] += _alpha * s;
+  }else{
+  }
+  solve(r, _xr.data());
+
+  std::fill(_xb.begin(), _xb.end(), 0.);
+  _xb[n-1] = _alpha;
+  solve(_xb.data(), _xb.data());
+
+  _y0 = output(_xr.data());
+  _g = output(_xb.data()) + _d;
+}
+/*--------------------------------------------------------------------------*/
+void LAPLACE_SS::accept(double u, bool dc)
+{
+  int n = order();
+  if(!dc){
+    for(int i = 0; i < n; ++i){
+      _x[i] = _xr[i] + u * _xb[i];
+    }
+  }else if(n && _a[0] != 0.){
+    std::fill(_x.begin(), _x.end(), 0.);
+    _x[0] = u / _a[0];
+  }else{ untested();
+    std::fill(_x.begin(), _x.end(), 0.);
+  }
+  _u = u;
+}
+/*--------------------------------------------------------------------------*/
+// rows k < n-1 give x_k = p_k + q_k x_{n-1}, the last row gives x_{n-1}.
+// r and x may be the same.
+void LAPLACE_SS::solve(double const* r, double* x)
+{
+  int n = order();
+  double rn = r[n-1];
+  _p[n-1] = 0.;
+  _q[n-1] = 1.;
+  for(int i = n-2; i >= 0; --i){
+    _p[i] = r[i] + _alpha * _p[i+1];
+    _q[i] = _alpha * _q[i+1];
+  }
+  double sp = 0.;
+  double sq = 0.;
+  for(int i = 0; i < n; ++i){
+    sp += _a[i] * _p[i];
+    sq += _a[i] * _q[i];
+  }
+  double xn = (rn - _alpha * sp) / (1. + _alpha * sq);
+  for(int i = 0; i < n; ++i){
+    x[i] = _p[i] + _q[i] * xn;
+  }
+}
+/*--------------------------------------------------------------------------*/
+double LAPLACE_SS::output(double const* x)const
+{
+  double y = 0.;
+  for(int i = 0; i < order(); ++i){
+    y += _c[i] * x[i];
+  }
+  return y;
+}
+/*--------------------------------------------------------------------------*/
 class LAPLACE : public ELEMENT {
 private:
   int _n_ports{2};
@@ -251,6 +468,19 @@ private:
   double* _st_s{NULL}; // s0: 1+dens, s1 .. sk:  3 each.
   bool _set_parameters{false};
   int _pivot{-1};
+private: // state space, no subckt
+  bool _ss{false};
+  LAPLACE_SS _sys;
+  double _mh{1.};          // output scale, as _output->mfactor
+  double _ss_c0{0.};       // input, constant part
+  double _ss_time{NOT_VALID};
+  double _ss_time1{0.};    // last accepted
+  double _ss_t[3];         // accepted output history, for tr_review
+  double _ss_y[3];
+  int _ss_hist{0};
+  bool _ss_trap{false};    // method of the current step
+  std::vector<double> _ss_g;  // transconductance per input port
+  std::vector<double> _ss_g1; // loaded
 private: // construct
   explicit LAPLACE(LAPLACE const&);
 public:
@@ -277,7 +507,7 @@ public:
   CARD* clone()const override;
   std::string dev_type()const override{assert(has_common()); return common()->name();}
 private: // ELEMENT, pure
-  void tr_iwant_matrix() override { return COMPONENT::tr_iwant_matrix(); }
+  void tr_iwant_matrix() override;
   void ac_iwant_matrix() override;
   double tr_involts()const override { untested();
     incomplete();
@@ -287,7 +517,19 @@ private: // ELEMENT, pure
   double  tr_involts_limited()const override { untested(); incomplete(); return 0.; }
   COMPLEX ac_involts()const override { untested(); incomplete(); return 0.; }
 private: // BASE_SUBCKT
-  void	  tr_begin()override	{assert(subckt()); subckt()->tr_begin(); ELEMENT::tr_begin();
+  void	  tr_begin()override	{
+      if(_ss){
+	ELEMENT::tr_begin();
+	_method_a = OPT::method;
+	_sys.reset();
+	_ss_time = NOT_VALID;
+	_ss_time1 = 0.;
+	_ss_hist = 0;
+	std::fill(_ss_g1.begin(), _ss_g1.end(), 0.);
+	return;
+      }else{
+      }
+      assert(subckt()); subckt()->tr_begin(); ELEMENT::tr_begin();
       _s_[0]->_loss0 = 1.;
       _s_[0]->_loss1 = 1.;
       if(_set_parameters){
@@ -297,12 +539,21 @@ private: // BASE_SUBCKT
       }
 //      _output->_loss1 = _loss1;
   }
-  void	  tr_restore()override	{ untested();assert(subckt()); subckt()->tr_restore(); ELEMENT::tr_restore();}
+  void	  tr_restore()override	{ untested();
+      if(subckt()){ untested();
+	subckt()->tr_restore();
+      }else{ untested();
+      }
+      ELEMENT::tr_restore();
+  }
   void	  dc_advance()override; //{ untested();set_not_converged(); /*really?*/ assert(subckt()); subckt()->dc_advance();}
   void	  tr_advance()override;	// { untested();assert(subckt()); subckt()->tr_advance();}
   void	  tr_regress()override {
     set_not_converged();
-    assert(subckt()); subckt()->tr_regress();
+    if(_ss){
+    }else{
+      assert(subckt()); subckt()->tr_regress();
+    }
     ELEMENT::tr_regress();
   }
   bool	  tr_needs_eval()const override; // { untested();assert(subckt()); return subckt()->tr_needs_eval();}
@@ -310,8 +561,8 @@ private: // BASE_SUBCKT
   void    tr_queue_eval()override {if(tr_needs_eval()){q_eval();}else{} }
   bool	  do_tr()override; // { untested();assert(subckt());set_converged(subckt()->do_tr());return converged();}
   void	  tr_load()override;
-  TIME_PAIR tr_review()override	{assert(subckt()); return _time_by = subckt()->tr_review();}
-  void	  tr_accept()override	{assert(subckt()); subckt()->tr_accept(); ELEMENT::tr_accept();}
+  TIME_PAIR tr_review()override;
+  void	  tr_accept()override;
   void	  tr_unload()override;
   void	  ac_begin()override;
   void	  do_ac()override;
@@ -329,6 +580,10 @@ private: // overrides
   int net_nodes()const override	{return _n_ports*2;}
   int min_nodes()const override {return 4;}
   int int_nodes()const override {
+    if(_ss){
+      return 0;
+    }else{
+    }
     COMMON_LAPLACE const* c = prechecked_cast<COMMON_LAPLACE const*>(common());
     assert(c);
     int dens = int(c->den_size());
@@ -370,6 +625,20 @@ private: // node list
   node_t& state_node(int k) {return _n[net_nodes()+k];}
 private: // impl
   friend class COMMON_LAPLACE;
+  bool use_ss(COMMON_LAPLACE const*)const;
+  void expand_ss();
+  void precalc_last_ss();
+  bool do_tr_ss();
+  void tr_load_ss();
+  double tr_review_ss()const;
+  double ss_input()const;
+  double out_mfactor()const {
+    if(_output){
+      return _output->mfactor();
+    }else{
+      return mfactor() * _mh;
+    }
+  }
 }; // LAPLACE
 /*--------------------------------------------------------------------------*/
 bool COMMON_LAPLACE::operator==(const COMMON_COMPONENT& x)const
@@ -427,7 +696,13 @@ double LAPLACE::tr_probe_num(std::string const& n) const
 
   if(n[0] == 's'){
     int idx = atoi(n.substr(1).c_str());
-    if(idx < dens){
+    if(!_ss){
+    }else if(idx < _sys.order()){
+      return _sys.state(idx);
+    }else{ untested();
+    }
+    if(_ss){ untested();
+    }else if(idx < dens){
       return _n[net_nodes() + idx].v0();
     }else{ untested();
     }
@@ -463,6 +738,8 @@ bool LAPLACE::tr_needs_eval()const
     return false;
   }else if (!converged()) {
     return true;
+  }else if(_ss){
+    return true;
   }else   if(_sim->is_first_iteration()){ untested();
     return true;
   }else{
@@ -479,6 +756,10 @@ bool LAPLACE::tr_needs_eval()const
 bool LAPLACE::do_tr()
 {
   trace2("test_lap2::do_tr", this, long_label());
+  if(_ss){
+    return do_tr_ss();
+  }else{
+  }
   COMMON_LAPLACE const* c = prechecked_cast<COMMON_LAPLACE const*>(common());
   assert(c);
   set_converged();
@@ -518,16 +799,22 @@ bool LAPLACE::do_tr()
 inline void LAPLACE::dc_advance()
 {
   set_not_converged();
-  assert(subckt());
-  subckt()->dc_advance();
+  if(_ss){
+  }else{
+    assert(subckt());
+    subckt()->dc_advance();
+  }
   return ELEMENT::dc_advance();
 }
 /*--------------------------------------------------------------------------*/
 inline void LAPLACE::tr_advance()
 {
   set_not_converged();
-  assert(subckt());
-  subckt()->tr_advance();
+  if(_ss){
+  }else{
+    assert(subckt());
+    subckt()->tr_advance();
+  }
   return ELEMENT::tr_advance();
 }
 /*--------------------------------------------------------------------------*/
@@ -636,6 +923,13 @@ void LAPLACE::expand()
   assert(c);
   int dens = int(c->den_size());
   assert(dens);
+  if(use_ss(c)){
+    _ss = true;
+    expand_ss();
+    return;
+  }else{
+    _ss = false;
+  }
   _pivot = c->pivot();
   assert(_pivot >= 0);
   trace2("expand", dens, _pivot);
@@ -933,6 +1227,11 @@ void LAPLACE::precalc_last()
   auto c = static_cast<COMMON_LAPLACE*>(mutable_common());
   assert(c);
   trace1("LAPLACE::precalc_last0b", c->_type);
+  if(_ss){
+    precalc_last_ss();
+    return;
+  }else{
+  }
 
   LAPLACE* m = this;
   LAPLACE const* p = this;
@@ -1073,7 +1372,7 @@ void LAPLACE::set_parameters(const std::string& Label, CARD *Owner,
 void LAPLACE::ac_load()
 {
   //ac_load_shunt(); // BUG. explicit mfactor.
-  _sim->_acx.load_symmetric(_n[OUT1].m_(), _n[OUT2].m_(), mfactor() * _output->mfactor() * _loss0);
+  _sim->_acx.load_symmetric(_n[OUT1].m_(), _n[OUT2].m_(), mfactor() * out_mfactor() * _loss0);
   if(ac_use_sckt){ untested();
     assert(subckt());
     subckt()->ac_load();
@@ -1104,8 +1403,8 @@ void LAPLACE::do_ac()
     COMPLEX den = evalp(z, c->_p_den.begin(), c->_p_den.size());
 
     // BUG: explicit mfactor.
-    trace1("do_ac mfactor hack", _output->mfactor());
-    _acg = _output->mfactor() * num/den;
+    trace1("do_ac mfactor hack", out_mfactor());
+    _acg = out_mfactor() * num/den;
   }
 }
 /*--------------------------------------------------------------------------*/
@@ -1120,6 +1419,10 @@ void LAPLACE::ac_begin()
 /*--------------------------------------------------------------------------*/
 void LAPLACE::tr_load()
 {
+  if(_ss){
+    return tr_load_ss();
+  }else{
+  }
   tr_load_shunt();
   assert(subckt());
   trace3("LAPLACE::tr_load", _loaditer, _sim->iteration_tag(), _loss0);
@@ -1130,11 +1433,19 @@ void LAPLACE::tr_load()
 void LAPLACE::tr_unload()
 { untested();
   incomplete();
-  subckt()->tr_unload();
+  if(subckt()){ untested();
+    subckt()->tr_unload();
+  }else{ untested();
+  }
 }
 /*--------------------------------------------------------------------------*/
 double LAPLACE::tr_amps() const
 {
+  if(_ss){
+    // as _output->tr_amps, without the output mfactor
+    return _sys.y0() + _sys.g() * ss_input();
+  }else{
+  }
   assert(_output);
   double r = _output->tr_amps();
   if(_loss0){
@@ -1155,6 +1466,231 @@ double LAPLACE::tr_amps() const
   return r;
 }
 /*--------------------------------------------------------------------------*/
+void LAPLACE::tr_iwant_matrix()
+{
+  if(!_ss){
+    return COMPONENT::tr_iwant_matrix();
+  }else{
+  }
+  // tr_iwant_matrix_extended
+  assert(is_device());
+  for (int ii = 0;  ii < ext_nodes();  ++ii) {
+    if (_n[ii].m_() >= 0) {
+      for (int jj = 0;  jj < ii ;  ++jj) {
+	_sim->_aa.iwant(_n[ii].m_(),_n[jj].m_());
+	_sim->_lu.iwant(_n[ii].m_(),_n[jj].m_());
+      }
+    }else{itested();
+      // node 1 is grounded or invalid
+    }
+  }
+}
+/*--------------------------------------------------------------------------*/
+TIME_PAIR LAPLACE::tr_review()
+{
+  if(_ss){
+    q_accept();
+    _time_by.reset();
+    _time_by.min_error_estimate(tr_review_check_and_convert(tr_review_ss()));
+    return _time_by;
+  }else{
+    assert(subckt());
+    return _time_by = subckt()->tr_review();
+  }
+}
+/*--------------------------------------------------------------------------*/
+void LAPLACE::tr_accept()
+{
+  if(_ss){
+    bool dc = _sim->analysis_is_static() || !(_sim->_time0 > _ss_time1);
+    if(dc){
+      _ss_hist = 1;
+    }else{
+      _ss_hist = std::min(_ss_hist + 1, 3);
+    }
+    for(int i=_ss_hist-1; i>0; --i){
+      _ss_t[i] = _ss_t[i-1];
+      _ss_y[i] = _ss_y[i-1];
+    }
+    _ss_t[0] = _sim->_time0;
+    _ss_y[0] = tr_amps();
+    _sys.accept(ss_input(), dc);
+    _ss_time1 = _sim->_time0;
+  }else{
+    assert(subckt());
+    subckt()->tr_accept();
+  }
+  ELEMENT::tr_accept();
+}
+/*--------------------------------------------------------------------------*/
+// state space. high order filters, where the subckt has many nodes and
+// ill conditioned coefficients. decided once, at first expand.
+bool LAPLACE::use_ss(COMMON_LAPLACE const* c)const
+{
+  assert(c);
+  if(subckt()){
+    return false;
+  }else if(_ss){
+    return true;
+  }else if(ss_order <= 0){
+    return false;
+  }else if(c->is_rp() || c->den_is_p() || c->num_size() > c->den_size()){
+    return false;
+  }else{
+    return int(c->den_size()) - 1 >= ss_order;
+  }
+}
+/*--------------------------------------------------------------------------*/
+void LAPLACE::expand_ss()
+{
+  ELEMENT::expand();
+  assert(_n);
+  if(_st_s){
+  }else{
+    _st_s = new double[3];
+    std::fill_n(_st_s, 3, 0.);
+  }
+  if(_st_b_in_){
+  }else{
+    _st_b_in_ = _st_s;
+  }
+  _ss_g.assign(_n_ports+1, 0.);
+  _ss_g1.assign(_n_ports+1, 0.);
+}
+/*--------------------------------------------------------------------------*/
+void LAPLACE::precalc_last_ss()
+{
+  auto c = prechecked_cast<COMMON_LAPLACE const*>(common());
+  assert(c);
+  assert(_st_b_in_);
+
+  double mhack = _st_b_in_[1];
+  if(_loss0){
+    assert(_loss0 == 1);
+    mhack = - _loss0 * mhack;
+  }else{
+  }
+  _st_b_in_[1] = 0.;
+  if(_set_parameters){
+    _mh = mhack;
+  }else{
+    _st_b_in_[0] = 0.;
+    _st_b_in_[2] = 1.;
+    _mh = 1.;
+  }
+
+  if(_sys.set(c->_p_num, c->_p_den)){
+  }else{ untested();
+    error(bDANGER, long_label() + ": improper transfer function\n");
+  }
+  trace3("LAPLACE::precalc_last_ss", long_label(), _sys.order(), _mh);
+}
+/*--------------------------------------------------------------------------*/
+// u = c0 + sum in[i] v_i, linearized as in va_fpoly_g
+double LAPLACE::ss_input()const
+{
+  double u = _ss_c0;
+  for(int i=2; i<=_n_ports; ++i){
+    u += _st_b_in_[i] * dn_diff(_n[2*i-2].v0(), _n[2*i-1].v0());
+  }
+  return u;
+}
+/*--------------------------------------------------------------------------*/
+bool LAPLACE::do_tr_ss()
+{
+  double h = _sim->_time0 - _ss_time1;
+  if(_sim->analysis_is_static() || !(h > 0.) || !_sys.order()){
+    _sys.dc();
+    _ss_time = NOT_VALID;
+  }else if(_sim->_time0 != _ss_time){
+    // as integrate in d_va_filter. the derivative from before a
+    // discontinuity is bogus, use euler.
+    _ss_trap = _time[1] != 0. && _method_a != mEULER;
+    _sys.step(h, _ss_trap);
+    _ss_time = _sim->_time0;
+  }else{
+    // same step, y0 and g unchanged
+  }
+
+  double c0 = _st_b_in_[0];
+  if(_set_parameters){
+    for(int i=2; i<=_n_ports; ++i){
+      c0 -= _st_b_in_[i] * volts_limited(_n[2*i-2], _n[2*i-1]);
+    }
+  }else{
+  }
+  _ss_c0 = c0;
+
+  double g = _mh * _sys.g();
+  _m0.x = 0.;
+  _m0.c1 = 0.;
+  _m0.c0 = _mh * _sys.y0() + g * c0;
+  for(int i=2; i<=_n_ports; ++i){
+    _ss_g[i] = g * _st_b_in_[i];
+  }
+
+  set_converged(conchk(_m1.c0, _m0.c0));
+  for(int i=2; converged() && i<=_n_ports; ++i){
+    set_converged(conchk(_ss_g1[i], _ss_g[i]));
+  }
+
+  if(_loaditer != _sim->iteration_tag()){
+    q_load();
+  }else{ untested();
+  }
+  return converged();
+}
+/*--------------------------------------------------------------------------*/
+/* the internal states are integrated here, not by capacitors, so there is
+ * no STORAGE to estimate the truncation error. Estimate it from the
+ * output, as STORAGE does from its charge. The derivative of order
+ * method+1 is a divided difference over the accepted outputs and the one
+ * at _time0. The error is h^2/2 y^(2) with euler, h^3/12 y^(3) with trap,
+ * whichever do_tr_ss used for this step.
+ */
+double LAPLACE::tr_review_ss()const
+{
+  bool trap = _ss_trap;
+  int m = trap ? 3 : 2;
+  double factor = trap ? 1./12. : .5;
+  double h = _sim->_time0 - _ss_time1;
+  if(!_sys.order() || !(h > 0.) || _ss_hist < m){
+    return NEVER;
+  }else{
+  }
+
+  double t[4] = {_sim->_time0, _ss_t[0], _ss_t[1], _ss_t[2]};
+  double y[4] = {tr_amps(), _ss_y[0], _ss_y[1], _ss_y[2]};
+  for(int k=1; k<=m; ++k){
+    for(int i=0; i<=m-k; ++i){
+      double dt = t[i] - t[i+k];
+      if(!(dt > 0.)){ untested();
+	return NEVER;
+      }else{
+      }
+      y[i] = (y[i] - y[i+1]) / dt * k;
+    }
+  }
+
+  double tol = OPT::trtol * std::max(OPT::abstol,
+      OPT::reltol * std::max(std::abs(tr_amps()), std::abs(_ss_y[0])));
+  double denom = factor * std::abs(y[0]);
+  if(denom < tol / BIGBIG){ untested();
+    return BIGBIG;
+  }else{
+    return std::pow(tol / denom, 1. / m);
+  }
+}
+/*--------------------------------------------------------------------------*/
+void LAPLACE::tr_load_ss()
+{
+  tr_load_shunt();
+  tr_load_source();
+  for(int i=2; i<=_n_ports; ++i){
+    tr_load_extended(_n[OUT1], _n[OUT2], _n[2*i-2], _n[2*i-1], &_ss_g[i], &_ss_g1[i]);
+  }
+}
+/*--------------------------------------------------------------------------*/
 /*--------------------------------------------------------------------------*/
 } // namespace
 /*--------------------------------------------------------------------------*/
@@ -20,6 +20,18 @@
  * 02110-1301, USA.
  *------------------------------------------------------------------
  * noise
+ *
+ * In transient, with "va_trnoise on", a source is a current, or drives its
+ * filter node. White noise is held over a step, band limited to 1/(2h).
+ * Flicker noise is the sum of first order sections, one per decade between
+ * fmin and fmax. Both cost O(1) per accepted step. Off by default, then
+ * nothing is drawn or loaded.
+ *
+ * va_trnoise                      show the settings
+ * va_trnoise on|off seed=<n> fmin=<f> fmax=<f>
+ *
+ * Each source draws from its own stream, seeded from seed and its label.
+ * The streams restart in tr_begin.
  */
 #include <e_elemnt.h>
 #include <globals.h>
@@ -27,10 +39,95 @@
 #include <u_xprobe.h>
 #include <u_status.h>
 #include <u_cardst.h>
+#include <c_comand.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <sstream>
+#include <vector>
 
 /*--------------------------------------------------------------------------*/
 namespace {
 /*--------------------------------------------------------------------------*/
+bool trn_on = false;
+int trn_seed = 0;
+double trn_fmin = 1.;
+double trn_fmax = 1e9;
+/*--------------------------------------------------------------------------*/
+class CMD_TRNOISE : public CMD {
+public:
+  void do_it(CS& cmd, CARD_LIST*)override {
+    if(cmd.more()){
+      size_t here = cmd.cursor();
+      do{
+	ONE_OF
+	  || Set(cmd, "on",   &trn_on, true)
+	  || Set(cmd, "off",  &trn_on, false)
+	  || Get(cmd, "seed", &trn_seed)
+	  || Get(cmd, "fmin", &trn_fmin)
+	  || Get(cmd, "fmax", &trn_fmax)
+	  ;
+      }while(cmd.more() && !cmd.stuck(&here));
+      cmd.check(bWARNING, "what's this?");
+      if(trn_fmin > 0.){
+      }else{ untested();
+	trn_fmin = 1.;
+      }
+      trn_fmax = std::max(trn_fmax, trn_fmin);
+    }else{
+      std::ostringstream o;
+      o << "va_trnoise " << (trn_on ? "on" : "off") << " seed=" << trn_seed
+	<< " fmin=" << trn_fmin << " fmax=" << trn_fmax << '\n';
+      IO::mstdout << o.str();
+    }
+  }
+} p_trnoise;
+DISPATCHER<CMD>::INSTALL d_trnoise(&command_dispatcher, "va_trnoise", &p_trnoise);
+/*--------------------------------------------------------------------------*/
+// splitmix64, one word of state. gaussians by Box-Muller, in pairs.
+class TR_RANDOM {
+  uint64_t _s{0};
+  double _spare{0.};
+  bool _has_spare{false};
+public:
+  void seed(uint64_t s) {
+    _s = s;
+    _has_spare = false;
+  }
+  uint64_t next() {
+    uint64_t z = (_s += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+  }
+  // in (0, 1]
+  double uniform() {
+    return double((next() >> 11) + 1) * (1. / 9007199254740992.);
+  }
+  double gauss() {
+    if(_has_spare){
+      _has_spare = false;
+      return _spare;
+    }else{
+      double r = std::sqrt(-2. * std::log(uniform()));
+      double phi = 2. * M_PI * uniform();
+      _spare = r * std::sin(phi);
+      _has_spare = true;
+      return r * std::cos(phi);
+    }
+  }
+};
+/*--------------------------------------------------------------------------*/
+// FNV-1a, the same on every platform.
+uint64_t label_hash(std::string const& s)
+{
+  uint64_t h = 0xcbf29ce484222325ull;
+  for(char c : s){
+    h = (h ^ uint64_t((unsigned char)c)) * 0x100000001b3ull;
+  }
+  return h;
+}
+/*--------------------------------------------------------------------------*/
 class COMMON_NOISE : public COMMON_COMPONENT {
   std::string _name; // PARAMETER<string>?
 protected:
@@ -124,12 +221,30 @@ public:
   }
 public:
   virtual double do_noise(ELEMENT const* e, std::string const&)const;
+  // density ~ 1/f^exponent
+  virtual double exponent()const {return 0.;}
 }; // COMMON_NOISE
 COMMON_NOISE ccn(CC_STATIC);
 /*--------------------------------------------------------------------------*/
 class DEV_NOISE : public ELEMENT /* COMPONENT? */ {
   double* _values{NULL};
  // std::string _name; // PARAMETER<string>?
+private: // transient
+  bool _trn{false};
+  TR_RANDOM _rnd;
+  double _time1{0.};
+  double _gw{0.};		// white, draw for the next step
+  std::vector<double> _fk;	// flicker, section corners
+  std::vector<double> _sk;	// deviation, unit density at 1Hz
+  std::vector<double> _gk;	// draws for the next step
+  std::vector<double> _x0;	// state at _time0
+  std::vector<double> _x1;	// state at _time1
+  double _u{0.};		// unit sample, step to _time0
+  double _s0{0.};		// sample
+  double _c0{0.};		// loaded source
+  double _c1{0.};
+  double _g0{0.};		// loaded shunt, filter node
+  double _g1{0.};
 public:
   explicit DEV_NOISE(COMMON_COMPONENT* p) : ELEMENT(p){ }
   explicit DEV_NOISE(const DEV_NOISE& p) : ELEMENT(p){ }
@@ -159,6 +274,14 @@ public: // make noise
       return mfactor() * ev;
     }
   }
+  // the density is pwr_scale() * value(), as in noise_num
+  double pwr_scale()const {
+    if(_values){
+      return mfactor() * _values[1];
+    }else{
+      return mfactor();
+    }
+  }
 private: // override virtual
   void set_parameters(const std::string& Label, CARD *Owner,
 		      COMMON_COMPONENT *Common, double Value,
@@ -182,19 +305,36 @@ private: // override virtual
   bool	use_obsolete_callback_parse()const override { untested();return false;}
   CARD*	clone()const override {return new DEV_NOISE(*this);}
   void tr_iwant_matrix()override{}
-  void tr_begin()override {}
-  void tr_load()override {}
-  void tr_unload()override { untested();}
+  void tr_begin()override;
+  void tr_load()override;
+  void tr_unload()override;
   void ac_iwant_matrix()override {}
   void ac_begin()override {}
   void dc_advance()override {}
-  void tr_advance()override {}
-  void tr_regress()override {}
+  void tr_advance()override {
+    if(_trn){
+      set_step();
+    }else{
+    }
+  }
+  void tr_regress()override {
+    if(_trn){
+      set_step();
+    }else{
+    }
+  }
   void tr_restore()override {itested();}
-  double tr_amps()const override { return 0.;}
-  bool tr_needs_eval()const override {return false;}
-  TIME_PAIR tr_review()override {return TIME_PAIR();}
-  bool do_tr()override {return true;}
+  void tr_accept()override;
+  double tr_amps()const override { return _s0;}
+  bool tr_needs_eval()const override {return _trn;}
+  TIME_PAIR tr_review()override {
+    if(_trn){
+      q_accept();
+    }else{
+    }
+    return TIME_PAIR();
+  }
+  bool do_tr()override;
   void do_ac()override {}
   void ac_load()override {
     if(_loss0){
@@ -219,6 +359,10 @@ private:
     static std::string names[] = {"p", "n"};
     return names[i];
   }
+private:
+  void make_sections(double e);
+  void draw();
+  void set_step();
 };
 DEV_NOISE ww(&ccn);
 static DISPATCHER<CARD>::INSTALL dwn(&device_dispatcher, "white_noise|va_white_noise", &ww);
@@ -294,6 +438,7 @@ public:
     _e.e_val(1., scope);
     COMMON_NOISE::precalc_last(scope);
   }
+  double exponent()const override {return _e;}
 
 };
 COMMON_FLICK ccf(CC_STATIC);
@@ -394,6 +539,155 @@ void DEV_NOISE::set_parameters(const std::string& Label, CARD *Owner,
   _loss1 = _loss0 = 1.;
 }
 /*--------------------------------------------------------------------------*/
+void DEV_NOISE::tr_begin()
+{
+  _trn = trn_on && _sim->analysis_is_tran();
+  _time1 = _sim->_time0;
+  _u = _s0 = 0.;
+  _c0 = _c1 = 0.;
+  _g0 = _g1 = 0.;
+  if(_trn){
+    auto cc = prechecked_cast<COMMON_NOISE const*>(common());
+    assert(cc);
+    _rnd.seed(uint64_t(trn_seed) ^ label_hash(long_label()));
+    make_sections(cc->exponent());
+    for(size_t k=0; k<_x1.size(); ++k){
+      // start stationary
+      _x1[k] = _x0[k] = _sk[k] * _rnd.gauss();
+    }
+    draw();
+  }else{
+  }
+}
+/*--------------------------------------------------------------------------*/
+/* first order sections with corners f_k, one per decade of [fmin, fmax],
+ * density c f_k^-e / (1 + (f/f_k)^2). c matches the sum to 1/f^e at the
+ * center of the band. Within 0.5dB for .5 <= e <= 1.5, a decade inside
+ * the band. White noise has no sections.
+ */
+void DEV_NOISE::make_sections(double e)
+{
+  size_t n = 0;
+  if(e != 0.){
+    n = 1 + size_t(std::ceil(std::log10(trn_fmax / trn_fmin)));
+  }else{
+  }
+  _fk.resize(n);
+  _sk.resize(n);
+  _gk.resize(n);
+  _x0.resize(n);
+  _x1.resize(n);
+  if(n){
+    double r = (n > 1) ? std::pow(trn_fmax / trn_fmin, 1. / double(n-1)) : 1.;
+    double fc = std::sqrt(trn_fmin * trn_fmax);
+    double sum = 0.;
+    for(size_t k=0; k<n; ++k){
+      _fk[k] = trn_fmin * std::pow(r, double(k));
+      double q = fc / _fk[k];
+      sum += std::pow(_fk[k], -e) / (1. + q*q);
+    }
+    double c = std::pow(fc, -e) / sum;
+    for(size_t k=0; k<n; ++k){
+      // variance, the density integrated over f
+      _sk[k] = std::sqrt(c * std::pow(_fk[k], -e) * M_PI * _fk[k] * .5);
+    }
+  }else{
+  }
+}
+/*--------------------------------------------------------------------------*/
+void DEV_NOISE::draw()
+{
+  if(_gk.empty()){
+    _gw = _rnd.gauss();
+  }else{
+    for(double& g : _gk){
+      g = _rnd.gauss();
+    }
+  }
+}
+/*--------------------------------------------------------------------------*/
+/* the unit sample for the step from _time1 to _time0, from the draws made
+ * at _time1, so that a rejected step is redone with the same draws.
+ * A section is updated exactly for any h,
+ *   x0 = a x1 + sqrt(1 - a^2) s g,  a = exp(-2 pi f_k h)
+ */
+void DEV_NOISE::set_step()
+{
+  double h = _sim->_time0 - _time1;
+  if(!(h > 0.)){
+    _u = 0.;
+  }else if(_fk.empty()){
+    _u = _gw / std::sqrt(2. * h);
+  }else{
+    _u = 0.;
+    for(size_t k=0; k<_fk.size(); ++k){
+      double a = std::exp(-2. * M_PI * _fk[k] * h);
+      _x0[k] = a * _x1[k] + std::sqrt(1. - a*a) * _sk[k] * _gk[k];
+      _u += _x0[k];
+    }
+  }
+}
+/*--------------------------------------------------------------------------*/
+void DEV_NOISE::tr_accept()
+{
+  if(_sim->_time0 > _time1){
+    _x1 = _x0;
+    draw();
+    _time1 = _sim->_time0;
+  }else{
+  }
+}
+/*--------------------------------------------------------------------------*/
+/* a current between the output nodes, or, with _loss0, the filter node
+ * at -tr_amps(), as in the other filters.
+ */
+bool DEV_NOISE::do_tr()
+{
+  if(_trn){
+    double u = _sim->analysis_is_tran_dynamic() ? _u : 0.;
+    _s0 = std::sqrt(std::abs(pwr_scale() * value())) * u;
+    _g0 = _loss0;
+    _c0 = _loss0 ? _s0 * _loss0 : _s0;
+    if(_c0 != _c1 || _g0 != _g1){
+      q_load();
+    }else{
+    }
+  }else{
+  }
+  return true;
+}
+/*--------------------------------------------------------------------------*/
+void DEV_NOISE::tr_load()
+{
+  double d = dampdiff(&_g0, _g1);
+  if(d != 0.){
+    _sim->_aa.load_symmetric(_n[OUT1].m_(), _n[OUT2].m_(), d);
+  }else{
+  }
+  _g1 = _g0;
+
+  d = dampdiff(&_c0, _c1);
+  if(d != 0.){
+    if(_n[OUT1].m_() != 0){
+      _n[OUT1].i() -= d;
+    }else{ untested();
+    }
+    if(_n[OUT2].m_() != 0){
+      _n[OUT2].i() += d;
+    }else{
+    }
+  }else{
+  }
+  _c1 = _c0;
+}
+/*--------------------------------------------------------------------------*/
+void DEV_NOISE::tr_unload()
+{ untested();
+  _c0 = _g0 = 0.;
+  _sim->mark_inc_mode_bad();
+  tr_load();
+}
+/*--------------------------------------------------------------------------*/
 double COMMON_NOISE::do_noise(ELEMENT const* e, std::string const& what)const
 {
   auto E = prechecked_cast<DEV_NOISE const*>(e);
@@ -21,6 +21,10 @@
  *------------------------------------------------------------------
  * Inverse Z transform filter
  * BUG1: current input not currently implemented
+ *
+ * The denominator is evaluated as a cascade of second order sections,
+ * from the poles where given (zi_zp, zi_np, zi_rp), or computed roots. If
+ * these do not reproduce the denominator, the direct form is used.
  */
 #include <globals.h>
 #include <e_compon.h>
@@ -30,6 +34,7 @@
 #include "e_va.h"
 #include "e_rf.h"
 #include <u_limit.h>
+#include <array>
 
 /*--------------------------------------------------------------------------*/
 /*--------------------------------------------------------------------------*/
@@ -71,18 +76,22 @@ public:
   PARAMETER<double> _delay{0.}; // "t0"
   PARAMETER<double> _period{1.}; // "T"
   PARAMETER<double> _ttime{.1}; // "\tau"
+  std::vector<COMPLEX> _den_roots; // from pole data, before convert_nd
   std::string name()const override {return "va_zi";}
 public:
   ~COMMON_ZIFILTER();
   COMMON_ZIFILTER(int x) : COMMON_RF_BASE(x) {}
   COMMON_ZIFILTER(COMMON_ZIFILTER const& x) : COMMON_RF_BASE(x),
-    _delay(x._delay), _period(x._period), _ttime(x._ttime) {}
+    _delay(x._delay), _period(x._period), _ttime(x._ttime),
+    _den_roots(x._den_roots) {}
   COMMON_ZIFILTER* clone()const override {return new COMMON_ZIFILTER(*this);}
 
   bool operator==(const COMMON_COMPONENT& x)const override;
   void set_param_by_index(int I, std::string& Value, int Offset)override;
   int set_param_by_name(std::string Name, std::string Value)override;
   void precalc_last(const CARD_LIST* par_scope)override;
+protected:
+  void keep_den_roots();
 }; //COMMON_ZIFILTER
 COMMON_ZIFILTER czi(CC_STATIC);
 /*--------------------------------------------------------------------------*/
@@ -129,6 +138,7 @@ public:
 
   void precalc_last(const CARD_LIST* par_scope)override{ untested();
     COMMON_ZIFILTER::precalc_last(par_scope);
+    keep_den_roots();
     convert_nd();
     reduce_shift();
   }
@@ -145,6 +155,7 @@ public:
 
   void precalc_last(const CARD_LIST* par_scope)override{
     COMMON_ZIFILTER::precalc_last(par_scope);
+    keep_den_roots();
     convert_nd();
     reduce_shift();
     trace2("zp::pl", _p_den.size(), _p_num.size());
@@ -162,12 +173,266 @@ public:
 
   void precalc_last(const CARD_LIST* par_scope)override{ untested();
     COMMON_ZIFILTER::precalc_last(par_scope);
+    keep_den_roots();
     convert_nd();
     reduce_shift();
   }
 }; //COMMON_ZIFILTER_RP
 COMMON_ZIFILTER_RP czi_rp(CC_STATIC);
 /*--------------------------------------------------------------------------*/
+// H(x) = N(x)/D(x), x = z^-1. D is factored into second order sections,
+// N stays a polynomial, in transposed form.
+//   v = sum_k n_k u[-k] / d_0
+//   s_j: y = v - a1 y[-1] - a2 y[-2],  v <- y
+class ZI_SOS {
+  std::vector<double> _b; // numerator / d0
+  std::vector<double> _a; // a1 a2, per section
+  typedef std::array<double, 3> factor;
+public:
+  int sections()const {return int(_a.size()/2);}
+  int num_regs()const {return _b.empty() ? 0 : int(_b.size()) - 1 + 2*sections();}
+  bool is_set()const {return !_b.empty();}
+  void clear() {_b.clear(); _a.clear();}
+  bool set(std::vector<double> const& num, std::vector<double> const& den,
+	   std::vector<COMPLEX> const& den_roots);
+  double step(double u, double* r)const;
+private:
+  static bool roots(std::vector<double> const& p, std::vector<COMPLEX>* r);
+  static bool factors(std::vector<COMPLEX> const& r, std::vector<factor>* f);
+};
+/*--------------------------------------------------------------------------*/
+// one sample. r: num_regs() registers. no branches on the data.
+inline double ZI_SOS::step(double u, double* r)const
+{
+  int m = int(_b.size()) - 1;
+  assert(m >= 0);
+  double const* b = _b.data();
+  double v = b[0] * u + (m ? r[0] : 0.);
+  for(int k = 1; k < m; ++k){
+    r[k-1] = b[k] * u + r[k];
+  }
+  if(m){
+    r[m-1] = b[m] * u;
+  }else{
+  }
+  r += m;
+
+  double const* a = _a.data();
+  int n = sections();
+  for(int j = 0; j < n; ++j){
+    double y = v - a[0] * r[0] - a[1] * r[1];
+    r[1] = r[0];
+    r[0] = y;
+    v = y;
+    a += 2;
+    r += 2;
+  }
+  return v;
+}
+/*--------------------------------------------------------------------------*/
+// Durand-Kerner, simultaneous. ascending coefficients, trimmed.
+bool ZI_SOS::roots(std::vector<double> const& p, std::vector<COMPLEX>* r)
+{
+  assert(r);
+  int n = int(p.size()) - 1;
+  r->clear();
+  if(n < 1){
+    return true;
+  }else{
+  }
+  assert(p[n] != 0.);
+  double rad = 0.;
+  for(int i = 0; i < n; ++i){
+    rad = std::max(rad, std::abs(p[i] / p[n]));
+  }
+  rad = 1. + rad;
+
+  std::vector<COMPLEX>& z = *r;
+  z.resize(n);
+  std::vector<COMPLEX> w(n);
+  COMPLEX seed(.4, .9);
+  COMPLEX s = 1.;
+  for(int i = 0; i < n; ++i){
+    s *= seed;
+    z[i] = rad * s;
+  }
+
+  bool done = false;
+  for(int it = 0; it < 500 && !done; ++it){
+    done = true;
+    for(int i = 0; i < n; ++i){
+      COMPLEX q = evalp(z[i], p.begin(), p.size()) / p[n];
+      for(int j = 0; j < n; ++j){
+	if(j != i){
+	  q /= (z[i] - z[j]);
+	}else{
+	}
+      }
+      w[i] = q;
+      if(std::abs(q) > 1e-14 * (1. + std::abs(z[i]))){
+	done = false;
+      }else{
+      }
+    }
+    for(int i = 0; i < n; ++i){
+      z[i] -= w[i];
+    }
+  }
+  // polish on the full polynomial, where it helps.
+  for(auto& x : z){
+    for(int it = 0; it < 3; ++it){
+      COMPLEX v = evalp(x, p.begin(), p.size());
+      COMPLEX dv = 0.;
+      for(int i = n; i > 0; --i){
+	dv = dv * x + double(i) * p[i];
+      }
+      if(dv == 0.){ untested();
+	break;
+      }else{
+      }
+      COMPLEX y = x - v / dv;
+      if(std::abs(evalp(y, p.begin(), p.size())) < std::abs(v)){
+	x = y;
+      }else{
+	break;
+      }
+    }
+  }
+  // may stall at rounding level. set checks the result.
+  for(auto x : z){
+    if(!std::isfinite(std::abs(x))){ untested();
+      return false;
+    }else{
+    }
+  }
+  return true;
+}
+/*--------------------------------------------------------------------------*/
+// real factors, constant term 1.
+bool ZI_SOS::factors(std::vector<COMPLEX> const& r, std::vector<factor>* f)
+{
+  assert(f);
+  f->clear();
+  std::vector<double> re;
+  std::vector<COMPLEX> up;
+  std::vector<COMPLEX> lo;
+  for(auto x : r){
+    if(std::abs(x) == 0.){ untested();
+      return false;
+    }else if(std::abs(x.imag()) <= 1e-8 * std::abs(x)){
+      re.push_back(x.real());
+    }else if(x.imag() > 0.){
+      up.push_back(x);
+    }else{
+      lo.push_back(x);
+    }
+  }
+  if(up.size() != lo.size()){ untested();
+    return false;
+  }else{
+  }
+  for(auto x : up){
+    // nearest conjugate
+    size_t best = 0;
+    for(size_t j = 1; j < lo.size(); ++j){
+      if(std::abs(lo[j] - std::conj(x)) < std::abs(lo[best] - std::conj(x))){
+	best = j;
+      }else{
+      }
+    }
+    COMPLEX y = 1. / x;
+    COMPLEX v = 1. / lo[best];
+    lo.erase(lo.begin() + long(best));
+    f->push_back(factor{{1., -(y + v).real(), (y * v).real()}});
+  }
+  std::sort(re.begin(), re.end());
+  for(size_t i = 0; i < re.size(); i += 2){
+    double a = -1. / re[i];
+    double b = (i + 1 < re.size()) ? -1. / re[i+1] : 0.;
+    f->push_back(factor{{1., a + b, a * b}});
+  }
+  return true;
+}
+/*--------------------------------------------------------------------------*/
+// den_roots: roots of D, if known. false if D does not factor well, use
+// direct form then.
+bool ZI_SOS::set(std::vector<double> const& num, std::vector<double> const& den,
+		 std::vector<COMPLEX> const& den_roots)
+{
+  clear();
+  std::vector<double> d(den);
+  while(d.size() > 1 && d.back() == 0.){
+    d.pop_back();
+  }
+  if(d.empty() || d[0] == 0.){ untested();
+    return false;
+  }else{
+  }
+  std::vector<COMPLEX> rd;
+  std::vector<factor> fd;
+  bool given = den_roots.size() + 1 == d.size();
+  if(given){
+    rd = den_roots;
+  }else if(!roots(d, &rd)){ untested();
+    return false;
+  }else{
+  }
+  if(!factors(rd, &fd)){ untested();
+    return false;
+  }else{
+  }
+
+  // poles close to the unit circle last. a2 = p1 p2 in z.
+  auto radius = [](factor const& x) {
+    return x[2] != 0. ? std::abs(x[2]) : x[1] * x[1];
+  };
+  std::sort(fd.begin(), fd.end(), [&](factor const& x, factor const& y) {
+    return radius(x) < radius(y);
+  });
+  _a.resize(2 * fd.size());
+  for(size_t j = 0; j < fd.size(); ++j){
+    _a[2*j] = fd[j][1];
+    _a[2*j+1] = fd[j][2];
+  }
+  _b.assign(num.begin(), num.end());
+  while(_b.size() > 1 && _b.back() == 0.){
+    _b.pop_back();
+  }
+  if(_b.empty()){ untested();
+    _b.push_back(0.);
+  }else{
+  }
+  for(auto& x : _b){
+    x /= d[0];
+  }
+
+  // backward check, d0 prod(factors) against D. computed roots of
+  // clustered poles are less accurate than D itself.
+  std::vector<double> q(1, d[0]);
+  for(auto const& f : fd){
+    std::vector<double> t(q.size() + 2, 0.);
+    for(size_t i = 0; i < q.size(); ++i){
+      t[i] += q[i] * f[0];
+      t[i+1] += q[i] * f[1];
+      t[i+2] += q[i] * f[2];
+    }
+    q.swap(t);
+  }
+  double norm = 0.;
+  for(double x : d){
+    norm += std::abs(x);
+  }
+  for(size_t i = 0; i < q.size(); ++i){
+    double di = (i < d.size()) ? d[i] : 0.;
+    if(std::abs(q[i] - di) > (given ? 1e-6 : 1e-9) * norm){ untested();
+      clear();
+      return false;
+    }else{
+    }
+  }
+  return true;
+}
+/*--------------------------------------------------------------------------*/
 class ZFILTER : public ELEMENT {
 private:
   int _n_ports{2};
@@ -180,6 +445,8 @@ private:
   double _new_event{0.};
   double _pending_event{0.};
   double _previous_event{0.};
+  ZI_SOS _sos;
+  std::vector<double> _sos_regs;
 private: // construct
   explicit ZFILTER(ZFILTER const&);
 public:
@@ -215,6 +482,7 @@ private: // BASE_SUBCKT
   TIME_PAIR tr_review()override;
 
   void new_sample_event(double ne);
+  double step_direct(double new_input);
   void tr_accept()override;
   void tr_unload()override;
   void ac_begin()override;
@@ -276,6 +544,19 @@ void COMMON_ZIFILTER::precalc_last(const CARD_LIST* par_scope)
   e_val(&_period, 1. , par_scope);
   e_val(&_ttime, 0.1 , par_scope);
   e_val(&_delay, 0. , par_scope);
+  _den_roots.clear();
+}
+/*--------------------------------------------------------------------------*/
+// pole pairs, as in convert and invres
+void COMMON_ZIFILTER::keep_den_roots()
+{
+  _den_roots.clear();
+  if(is_rp() || den_is_p()){
+    for(size_t i = 0; i+1 < _p_den.size(); i += 2){
+      _den_roots.push_back(COMPLEX(_p_den[i], _p_den[i+1]));
+    }
+  }else{ untested();
+  }
 }
 /*--------------------------------------------------------------------------*/
 bool COMMON_ZIFILTER::operator==(const COMMON_COMPONENT& x)const
@@ -391,6 +672,34 @@ bool ZFILTER::do_tr()
   return ELEMENT::do_tr();
 }
 /*--------------------------------------------------------------------------*/
+// one sample, direct form II
+double ZFILTER::step_direct(double new_input)
+{
+  auto c = prechecked_cast<COMMON_ZIFILTER const*>(common());
+  assert(c);
+  int num_den = c->den_size();
+  int num_num = c->num_size();
+  int num_regs = std::max(num_den, num_num);
+  int i = num_regs-1;
+
+  for(i=num_regs-1; i>num_den-1; --i){
+    _regs[i] = _regs[i-1];
+  }
+  for(       ; i>0; --i){
+    trace3("den", i, c->_p_den[i], c->_p_den.size());
+    _regs[i] = _regs[i-1];
+    new_input -= _regs[i] * c->_p_den[i] / c->_p_den[0];
+  }
+  _regs[0] = new_input;
+
+  double output = 0.;
+  for(i=0; i<num_num; ++i){
+    output += _regs[i] * c->_p_num[i];
+  }
+  assert(c->_p_den[0]);
+  return output / c->_p_den[0];
+}
+/*--------------------------------------------------------------------------*/
 void ZFILTER::tr_advance()
 {
   ELEMENT::tr_advance();
@@ -406,30 +715,15 @@ void ZFILTER::tr_advance()
 
   // move to accept??
   if(_pending_event != _new_event) {
-    int num_den = c->den_size();
-    int num_num = c->num_size();
-    int num_regs = std::max(num_den, num_num);
     // double& new_output = _y[0].f1 = 0;
     _old_output = _output;
     double new_input = tr_involts();
-    int i = num_regs-1;
-
-    for(i=num_regs-1; i>num_den-1; --i){
-      _regs[i] = _regs[i-1];
-    }
-    for(       ; i>0; --i){
-      trace3("den", i, c->_p_den[i], c->_p_den.size());
-      _regs[i] = _regs[i-1];
-      new_input -= _regs[i] * c->_p_den[i] / c->_p_den[0];
-    }
-    _regs[0] = new_input;
 
-    _output = 0.;
-    for(i=0; i<num_num; ++i){
-      _output += _regs[i] * c->_p_num[i];
+    if(_sos.is_set()){
+      _output = _sos.step(new_input, _sos_regs.data());
+    }else{ untested();
+      _output = step_direct(new_input);
     }
-    assert(c->_p_den[0]);
-    _output /= c->_p_den[0];
    //  _y[0].f0 = _output;
     trace4("ZFILTER::accept", _sim->_time0, c->_p_den[0], c->_p_num[0], new_input);
     trace4("ZFILTER::accept", _sim->_time0, _output, _old_output, tr_involts());
@@ -516,6 +810,7 @@ void ZFILTER::tr_begin()
   int num_regs = std::max(num_den, num_num);
   trace3("ZFILTER::tr_begin", tr_input(), num_num, _sim->_time0);
   std::fill_n(_regs, num_regs, 0.);
+  std::fill(_sos_regs.begin(), _sos_regs.end(), 0.);
 }
 /*--------------------------------------------------------------------------*/
 void ZFILTER::tr_restore()
@@ -677,6 +972,20 @@ void ZFILTER::precalc_last()
   }
   assert( c->_p_num.size());
   assert( c->_p_den.size());
+
+  auto z = prechecked_cast<COMMON_ZIFILTER const*>(c);
+  assert(z);
+  std::vector<double> num(c->_p_num.begin(), c->_p_num.end());
+  std::vector<double> den(c->_p_den.begin(), c->_p_den.end());
+  if(_sos.set(num, den, z->_den_roots)){
+    trace2("ZFILTER::precalc_last sos", long_label(), _sos.sections());
+  }else{ untested();
+    error(bTRACE, long_label() + ": using direct form\n");
+  }
+  if(int(_sos_regs.size()) != _sos.num_regs()){
+    _sos_regs.assign(_sos.num_regs(), 0.);
+  }else{
+  }
 }
 /*--------------------------------------------------------------------------*/
 void ZFILTER::set_parameters(const std::string& Label, CARD *Owner,
@@ -0,0 +1,276 @@
+/*                                 -*- C++ -*-
+ * Copyright (C) 2023 Felix Salfelder
+ *
+ * This file is part of "Gnucap", the Gnu Circuit Analysis Package
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *------------------------------------------------------------------
+ * VAFUSED : the flow branches of a module instance, optimize-fuse
+ *
+ * Each branch is stamped like VAFLOW, from the state array in the
+ * instance. The matrix positions of all branch nodes are collected in
+ * tr_iwant_matrix, so tr_load does not go through node_t.
+ */
+#include "e_va.h"
+#include <globals.h>
+#include <e_elemnt.h>
+/*--------------------------------------------------------------------------*/
+namespace {
+/*--------------------------------------------------------------------------*/
+class VAFUSED : public ELEMENT, public VA_FUSED {
+  struct BRANCH {
+    double* values;
+    int n_ports;
+    size_t node;  // output in _nn, controls follow
+    size_t old;   // in _old
+    COMMON_VASRC const* common;
+    double abstol;
+  };
+  std::vector<BRANCH> _br;
+  std::vector<node_t> _nn;
+  std::vector<int> _m;      // matrix positions, parallel to _nn
+  std::vector<double> _old; // loaded values
+  double _time{NOT_VALID};
+private:
+  explicit VAFUSED(const VAFUSED& p) : ELEMENT(p) {
+    // only the prototype is copied.
+    assert(p._br.empty());
+  }
+public:
+  explicit VAFUSED() : ELEMENT() {}
+  ~VAFUSED() {}
+private: // override virtual
+  char	   id_letter()const override	{ untested();unreachable(); return '\0';}
+  std::string value_name()const override{ untested(); return "";}
+  std::string dev_type()const override	{return "va_fused";}
+  int	   max_nodes()const override	{return net_nodes();}
+  int	   min_nodes()const override	{return net_nodes();}
+  int	   matrix_nodes()const override	{return net_nodes();}
+  int	   net_nodes()const override	{return int(_nn.size());}
+  CARD*	   clone()const override	{return new VAFUSED(*this);}
+  void	   precalc_last()override;
+  void	   tr_iwant_matrix()override;
+  bool	   do_tr()override;
+  void	   tr_load()override;
+  void	   tr_unload()override;
+  double   tr_involts()const override	{ untested();unreachable(); return NOT_VALID;}
+  double   tr_involts_limited()const override { untested();unreachable(); return NOT_VALID;}
+  double   tr_amps()const override	{ untested(); return NOT_VALID;}
+  void	   ac_iwant_matrix()override;
+  void	   ac_load()override;
+  COMPLEX  ac_involts()const override	{ untested(); return NOT_VALID;}
+  COMPLEX  ac_amps()const override	{ untested(); return NOT_VALID;}
+  std::string port_name(int)const override { untested();
+    return "";
+  }
+  double tr_probe_num(const std::string& x)const override;
+private: // VA_FUSED
+  void clear_branches()override;
+  void add_branch(COMMON_VASRC const*, int n_states, double states[],
+		  int n_nodes, const node_t nodes[])override;
+private:
+  void map_positions();
+}f; // VAFUSED
+DISPATCHER<CARD>::INSTALL d1(&device_dispatcher, "va_fused", &f);
+/*--------------------------------------------------------------------------*/
+void VAFUSED::clear_branches()
+{
+  _br.clear();
+  _nn.clear();
+  _m.clear();
+  _old.clear();
+  _n = _nodes;
+}
+/*--------------------------------------------------------------------------*/
+void VAFUSED::add_branch(COMMON_VASRC const* c, int n_states, double states[],
+			 int n_nodes, const node_t nodes[])
+{
+  trace3("VAFUSED::add_branch", long_label(), n_states, n_nodes);
+  assert(states);
+  assert(n_states >= 2);
+  assert(n_nodes == 2 * (n_states - 1)); // no current ports
+
+  BRANCH b;
+  b.values = states;
+  b.n_ports = n_states - 1;
+  b.node = _nn.size();
+  b.old = _old.size();
+  b.common = c;
+  b.abstol = OPT::abstol;
+  _br.push_back(b);
+
+  _nn.insert(_nn.end(), nodes, nodes + n_nodes);
+  _old.resize(_old.size() + n_states, 0.);
+  std::fill_n(states, n_states, 0.);
+  _n = _nn.data();
+}
+/*--------------------------------------------------------------------------*/
+void VAFUSED::precalc_last()
+{
+  ELEMENT::precalc_last();
+  for(auto& b : _br){
+    if(b.common){
+      b.abstol = b.common->flow_abstol();
+    }else{ untested();
+      b.abstol = OPT::abstol;
+    }
+  }
+}
+/*--------------------------------------------------------------------------*/
+void VAFUSED::map_positions()
+{
+  _m.resize(_nn.size());
+  for(size_t i = 0; i < _nn.size(); ++i){
+    _m[i] = _n[i].m_();
+  }
+}
+/*--------------------------------------------------------------------------*/
+// as tr_iwant_matrix_extended, but per branch.
+void VAFUSED::tr_iwant_matrix()
+{
+  map_positions();
+  for(auto const& b : _br){
+    int const* m = &_m[b.node];
+    for(int ii = 0; ii < 2 * b.n_ports; ++ii){
+      if(m[ii] >= 0){
+	for(int jj = 0; jj < ii; ++jj){
+	  _sim->_aa.iwant(m[ii], m[jj]);
+	  _sim->_lu.iwant(m[ii], m[jj]);
+	}
+      }else{ untested();
+      }
+    }
+  }
+}
+/*--------------------------------------------------------------------------*/
+void VAFUSED::ac_iwant_matrix()
+{
+  map_positions();
+  for(auto const& b : _br){
+    int const* m = &_m[b.node];
+    for(int ii = 0; ii < 2 * b.n_ports; ++ii){
+      if(m[ii] >= 0){
+	for(int jj = 0; jj < ii; ++jj){
+	  _sim->_acx.iwant(m[ii], m[jj]);
+	}
+      }else{ untested();
+      }
+    }
+  }
+}
+/*--------------------------------------------------------------------------*/
+bool VAFUSED::do_tr()
+{
+  trace2("VAFUSED::do_tr", long_label(), _br.size());
+  if(!_sim->_v0){ untested();
+  }else if(_loaditer != _sim->iteration_tag()){
+    q_load();
+  }else{ untested();
+  }
+
+  set_converged(conchk(_time, _sim->_time0));
+  _time = _sim->_time0;
+  for(auto const& b : _br){
+    if(!converged()){
+      break;
+    }else{
+    }
+    double const* v = b.values;
+    double const* o = &_old[b.old];
+    set_converged(conchk(o[0], v[0], b.abstol));
+    for(int i = 1; converged() && i <= b.n_ports; ++i){
+      set_converged(conchk(o[i], v[i]));
+    }
+  }
+  return converged();
+}
+/*--------------------------------------------------------------------------*/
+void VAFUSED::tr_load()
+{
+  for(auto const& b : _br){
+    double* v = b.values;
+    double* o = &_old[b.old];
+    int const* m = &_m[b.node];
+
+    double d = dampdiff(&v[1], o[1]);
+    if(d != 0.){
+      _sim->_aa.load_symmetric(m[0], m[1], d);
+    }else{
+    }
+    o[1] = v[1];
+
+    d = dampdiff(&v[0], o[0]);
+    if(d != 0.){
+      if(m[1] != 0){
+	_sim->_i[m[1]] += d;
+      }else{
+      }
+      if(m[0] != 0){
+	_sim->_i[m[0]] -= d;
+      }else{
+      }
+    }else{
+    }
+    o[0] = v[0];
+
+    for(int i = 2; i <= b.n_ports; ++i){
+      d = dampdiff(&v[i], o[i]);
+      if(d != 0.){
+	_sim->_aa.load_asymmetric(m[0], m[1], m[2*i-2], m[2*i-1], d);
+      }else{
+      }
+      o[i] = v[i];
+    }
+  }
+}
+/*--------------------------------------------------------------------------*/
+void VAFUSED::tr_unload()
+{ untested();
+  for(auto const& b : _br){ untested();
+    std::fill_n(b.values, b.n_ports+1, 0.);
+  }
+  _sim->mark_inc_mode_bad();
+  tr_load();
+}
+/*--------------------------------------------------------------------------*/
+void VAFUSED::ac_load()
+{
+  double mf = mfactor();
+  for(auto const& b : _br){
+    double const* v = b.values;
+    int const* m = &_m[b.node];
+    _sim->_acx.load_symmetric(m[0], m[1], mf * v[1]);
+    for(int i = 2; i <= b.n_ports; ++i){
+      _sim->_acx.load_asymmetric(m[0], m[1], m[2*i-2], m[2*i-1], mf * v[i]);
+    }
+  }
+}
+/*--------------------------------------------------------------------------*/
+double VAFUSED::tr_probe_num(const std::string& x)const
+{
+  if (Umatch(x, "branches ")) {
+    return double(_br.size());
+  }else if (Umatch(x, "nodes ")) {
+    return double(_nn.size());
+  }else{
+    return ELEMENT::tr_probe_num(x);
+  }
+}
+/*--------------------------------------------------------------------------*/
+}
+/*--------------------------------------------------------------------------*/
+/*--------------------------------------------------------------------------*/
+// vim:ts=8:sw=2:noet:
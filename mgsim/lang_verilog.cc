@@ -27,6 +27,7 @@
 #include <e_subckt.h>
 #include <e_model.h>
 #include <u_lang.h>
+#include "e_va.h"
 /*--------------------------------------------------------------------------*/
 namespace {
 /*--------------------------------------------------------------------------*/
@@ -790,6 +791,15 @@ void LANG_VERILOG::print_command(OMSTREAM& o, const DEV_DOT* x)
   o << x->s() << '\n';
 }
 /*--------------------------------------------------------------------------*/
+// a new top level definition, see VA_OVERLOADS
+static void overload_add(CARD const* c)
+{
+  if(auto o = dynamic_cast<VA_OVERLOADS*>(command_dispatcher["va_overload"])){
+    o->add(c);
+  }else{ untested();
+  }
+}
+/*--------------------------------------------------------------------------*/
 class CMD_PARAMSET : public CMD {
   void do_it(CS& cmd, CARD_LIST* Scope) override {
     if(Scope == &CARD_LIST::card_list){
@@ -828,6 +838,7 @@ class CMD_PARAMSET : public CMD {
     }
     trace3("CMD_PARAMSET", paramset->long_label(), paramset->dev_type(), paramset);
     Scope->push_back(paramset);
+    overload_add(paramset);
   }
 } p1;
 DISPATCHER<CMD>::INSTALL d1(&command_dispatcher, "paramset", &p1);
@@ -841,6 +852,7 @@ class CMD_MODULE : public CMD {
     assert(!new_module->is_device());
     lang_verilog.parse_module(cmd, new_module);
     Scope->push_back(new_module);
+    overload_add(new_module);
   }
 } p2;
 DISPATCHER<CMD>::INSTALL d2(&command_dispatcher, "module|macromodule", &p2);
@@ -25,19 +25,112 @@
 #define M_WAVE_H
 #include <l_denoise.h>
 #include <m_interp.h>
+#include <vector>
+#include <iterator>
+/*--------------------------------------------------------------------------*/
+// contiguous ring of samples, capacity is a power of 2.
+// grows at the back, shrinks at both ends.
+class WAVE_RING {
+private:
+  std::vector<DPAIR> _buf;
+  size_t _head{0};
+  size_t _size{0};
+public:
+  class const_iterator {
+    WAVE_RING const* _r;
+    size_t _i;
+  public:
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef DPAIR value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef DPAIR const* pointer;
+    typedef DPAIR const& reference;
+
+    const_iterator(WAVE_RING const* r, size_t i) : _r(r), _i(i) {}
+    reference operator*()const {return (*_r)[_i];}
+    pointer operator->()const {return &(*_r)[_i];}
+    reference operator[](difference_type d)const {return (*_r)[_i+d];}
+    const_iterator& operator++() {++_i; return *this;}
+    const_iterator& operator--() {--_i; return *this;}
+    const_iterator operator++(int) {const_iterator t(*this); ++_i; return t;}
+    const_iterator operator--(int) {const_iterator t(*this); --_i; return t;}
+    const_iterator& operator+=(difference_type d) {_i+=d; return *this;}
+    const_iterator& operator-=(difference_type d) {_i-=d; return *this;}
+    const_iterator operator+(difference_type d)const {return const_iterator(_r, _i+d);}
+    const_iterator operator-(difference_type d)const {return const_iterator(_r, _i-d);}
+    difference_type operator-(const_iterator const& x)const {
+      return difference_type(_i) - difference_type(x._i);
+    }
+    bool operator==(const_iterator const& x)const {return _i == x._i;}
+    bool operator!=(const_iterator const& x)const {return _i != x._i;}
+    bool operator<(const_iterator const& x)const {return _i < x._i;}
+    bool operator>(const_iterator const& x)const {return _i > x._i;}
+    bool operator<=(const_iterator const& x)const {return _i <= x._i;}
+    bool operator>=(const_iterator const& x)const {return _i >= x._i;}
+  };
+
+  size_t size()const {return _size;}
+  bool empty()const {return !_size;}
+  size_t capacity()const {return _buf.size();}
+  DPAIR& operator[](size_t i) {
+    assert(i < _size);
+    return _buf[(_head + i) & (_buf.size() - 1)];
+  }
+  DPAIR const& operator[](size_t i)const {
+    assert(i < _size);
+    return _buf[(_head + i) & (_buf.size() - 1)];
+  }
+  DPAIR& front() {return (*this)[0];}
+  DPAIR& back() {return (*this)[_size-1];}
+  DPAIR const& front()const {return (*this)[0];}
+  DPAIR const& back()const {return (*this)[_size-1];}
+  const_iterator begin()const {return const_iterator(this, 0);}
+  const_iterator end()const {return const_iterator(this, _size);}
+
+  void clear() {_head = 0; _size = 0;}
+  void push_back(DPAIR const& x) {
+    if(_size == _buf.size()){
+      grow();
+    }else{
+    }
+    ++_size;
+    back() = x;
+  }
+  void pop_back() {assert(_size); --_size;}
+  // drop the n oldest samples at once
+  void pop_front(size_t n=1) {
+    assert(n <= _size);
+    if(_buf.size()){
+      _head = (_head + n) & (_buf.size() - 1);
+    }else{ untested();
+    }
+    _size -= n;
+  }
+private:
+  void grow() {
+    std::vector<DPAIR> b(std::max(size_t(8), 2 * _buf.size()));
+    for(size_t i = 0; i < _size; ++i){
+      b[i] = (*this)[i];
+    }
+    _buf.swap(b);
+    _head = 0;
+  }
+};
 /*--------------------------------------------------------------------------*/
 class WAVE {
 private:
-  std::deque<DPAIR> _w;
+  WAVE_RING _w;
   double _delay;
+  size_t _max_size{0};	// memory bound, in samples. 0: unbounded
+  mutable size_t _cursor{1};	// upper neighbour of the last v_out
 public:
-  typedef std::deque<DPAIR>::iterator iterator;
-  typedef std::deque<DPAIR>::const_iterator const_iterator;
+  typedef WAVE_RING::const_iterator const_iterator;
 
   explicit WAVE(double d=0);
   explicit WAVE(const WAVE&);
 	  ~WAVE() {}
   WAVE&	   set_delay(double d);
+  WAVE&	   set_max_size(size_t n) {_max_size = n ? std::max(n, size_t(4)) : 0; return *this;}
   WAVE&	   initialize();
   WAVE&	   push(double t, double v);
   FPOLY1   v_out(double t)const;
@@ -59,20 +152,23 @@ public:
   }
   double time()const {
     if(_w.size()){
-      return _w.begin()->first;
+      return _w.front().first;
     }else{ untested();
       return NEVER;
     }
   }
   double next_time()const { untested();
     if(_w.size()>1){ untested();
-      return (_w.begin()+1)->first;
+      return _w[1].first;
     }else{ untested();
       return NEVER;
     }
   }
   void new_transition(double when, double rt, double ft, double fv);
   double cleanup(double until);
+private:
+  void pop_front(size_t n);
+  void thin();
 };
 /*--------------------------------------------------------------------------*/
 /*--------------------------------------------------------------------------*/
@@ -82,21 +178,55 @@ public:
 //
 inline WAVE& WAVE::push(double t, double v)
 {
+  size_t n = _w.size();
+  if(!_max_size){
+  }else if(n >= 2 && t+_delay - _w[n-2].first < 2.5 * _delay / double(_max_size)){
+    // too close, the delay would hold more than _max_size samples.
+    // replace the last one, the spacing stays above 1.25*_delay/_max_size.
+    _w.pop_back();
+  }else if(n >= _max_size){ untested();
+    thin();
+  }else{
+  }
   _w.push_back(DPAIR(t+_delay, v));
   return *this;
 }
 /*--------------------------------------------------------------------------*/
+inline void WAVE::pop_front(size_t n)
+{
+  _w.pop_front(n);
+  _cursor = (_cursor > n) ? (_cursor - n) : 1;
+}
+/*--------------------------------------------------------------------------*/
+// out of memory budget anyway, e.g. without cleanup. drop every other
+// sample, keep the oldest, it brackets the current time, and the newest.
+inline void WAVE::thin()
+{
+  size_t n = _w.size();
+  size_t k = 1;
+  for(size_t i = 1 + n % 2; i < n; i += 2){
+    _w[k++] = _w[i];
+  }
+  while(_w.size() > k){
+    _w.pop_back();
+  }
+  _cursor = 1;
+}
+/*--------------------------------------------------------------------------*/
 // initialize: remove all info, fill it with all 0.
 //
 inline WAVE& WAVE::initialize()
 {
   _w.clear();
+  _cursor = 1;
   return *this;
 }
 /*--------------------------------------------------------------------------*/
 inline WAVE::WAVE(const WAVE& w)
   :_w(w._w),
-   _delay(w._delay)
+   _delay(w._delay),
+   _max_size(w._max_size),
+   _cursor(w._cursor)
 { untested();
 }
 /*--------------------------------------------------------------------------*/
@@ -118,9 +248,32 @@ inline WAVE& WAVE::set_delay(double d)
 // v_out: return the value at the "output" end
 // args: t = the time now
 //
+// same as interpolate over the whole wave, but the search starts from the
+// previous result. time mostly moves forward, this is amortized O(1).
 inline FPOLY1 WAVE::v_out(double t)const
 {
-  return interpolate(_w.begin(), _w.end(), t, 0., 0.);
+  size_t n = _w.size();
+  if(n < 2){
+    DPAIR oo[1];
+    if(n){
+      oo[0] = _w.front();
+    }else{ untested();
+    }
+    return interpolate(oo, oo+n, t, 0., 0.);
+  }else{
+  }
+
+  size_t u = std::min(std::max(_cursor, size_t(1)), n-1);
+  while(u < n-1 && _w[u].first <= t){
+    ++u;
+  }
+  while(u > 1 && _w[u-1].first > t){
+    --u;
+  }
+  _cursor = u;
+
+  DPAIR oo[2] = { _w[u-1], _w[u] };
+  return interpolate(oo, oo+2, t, 0., 0.);
 }
 /*--------------------------------------------------------------------------*/
 // reflect: calculate a reflection
@@ -137,8 +290,8 @@ inline double WAVE::v_reflect(double t, double v_total)const
 inline WAVE& WAVE::operator+=(const WAVE& x)
 { untested();
   untested();
-  for (std::deque<DPAIR>::iterator
-	 i = _w.begin(); i != _w.end(); ++i) { untested();
+  for (size_t k = 0; k < _w.size(); ++k) { untested();
+    DPAIR* i = &_w[k];
     untested();
     (*i).second += x.v_out((*i).first).f0;
   }
@@ -148,8 +301,8 @@ inline WAVE& WAVE::operator+=(const WAVE& x)
 inline WAVE& WAVE::operator+=(double x)
 { untested();
   untested();
-  for (std::deque<DPAIR>::iterator
-	 i = _w.begin(); i != _w.end(); ++i) { untested();
+  for (size_t k = 0; k < _w.size(); ++k) { untested();
+    DPAIR* i = &_w[k];
     untested();
     (*i).second += x;
   }
@@ -159,8 +312,8 @@ inline WAVE& WAVE::operator+=(double x)
 inline WAVE& WAVE::operator*=(const WAVE& x)
 { untested();
   untested();
-  for (std::deque<DPAIR>::iterator
-	 i = _w.begin(); i != _w.end(); ++i) { untested();
+  for (size_t k = 0; k < _w.size(); ++k) { untested();
+    DPAIR* i = &_w[k];
     untested();
     (*i).second *= x.v_out((*i).first).f0;
   }
@@ -170,8 +323,8 @@ inline WAVE& WAVE::operator*=(const WAVE& x)
 inline WAVE& WAVE::operator*=(double x)
 { untested();
   untested();
-  for (std::deque<DPAIR>::iterator
-	 i = _w.begin(); i != _w.end(); ++i) { untested();
+  for (size_t k = 0; k < _w.size(); ++k) { untested();
+    DPAIR* i = &_w[k];
     untested();
     (*i).second *= x;
   }
@@ -180,21 +333,18 @@ inline WAVE& WAVE::operator*=(double x)
 /*--------------------------------------------------------------------------*/
 inline double WAVE::cleanup(double start)
 {
-  auto b = _w.begin();
-  double pending = NEVER; // b->first;
-
-  while(_w.size() > 1 && _w.front().first <= start){
-    trace3("cleanup front", _w.size(), _w.back().first, start);
-    ++b;
-    if(b->first == start){
-      _w.pop_front();
-    }else if(b->first <= start){
-      _w.pop_front();
-    }else{
-      pending = b->first;
-      break;
-    }
-    assert(_w.size());
+  // keep the last sample not after start, drop all before it.
+  size_t j = 0;
+  while(j < _w.size() && _w[j].first <= start){
+    ++j;
+  }
+  double pending = NEVER;
+  if(j == 0){
+  }else if(j < _w.size()){
+    pending = _w[j].first;
+    pop_front(j-1);
+  }else{
+    pop_front(j-1);
   }
   for(auto w : _w){
     trace2("clean", w.first, w.second);
@@ -29,7 +29,14 @@
 #include <io_trace.h>
 #include <e_model.h>
 #include <c_comand.h>
+#include "e_va.h"
 #include <set>
+#include <map>
+#include <cmath>
+#include <cstdlib>
+#include <cctype>
+#include <algorithm>
+#include <iterator>
 /*--------------------------------------------------------------------------*/
 namespace{
 /*--------------------------------------------------------------------------*/
@@ -55,6 +62,351 @@ static void grow_nodes(size_t Index, node_t*& n, size_t& capacity, size_t capaci
   }
 }
 /*--------------------------------------------------------------------------*/
+// overload index. the top level candidates for a model name, with the
+// numeric from/exclude ranges c_param reports through VA_OVERLOADS.
+// Binning an instance looks up the bins of one key parameter, then checks
+// the remaining ranges. Whatever cannot be read as a number does not
+// constrain, the final decision is is_valid in expand.
+//
+// numbers as in spice, "1k", "2.2Meg", "10u", "3mil", "1pF". the scale
+// letter is case insensitive, trailing letters are units.
+static bool parse_number(std::string const& s, double* x)
+{
+  char const* b = s.c_str();
+  while(isspace(*b)){
+    ++b;
+  }
+  char* e;
+  double v = strtod(b, &e);
+  if(e == b || v != v){
+    return false;
+  }else{
+  }
+  switch(toupper(*e)){
+  case 'T': v *= 1e12; ++e; break;
+  case 'G': v *= 1e9; ++e; break;
+  case 'K': v *= 1e3; ++e; break;
+  case 'U': v *= 1e-6; ++e; break;
+  case 'N': v *= 1e-9; ++e; break;
+  case 'P': v *= 1e-12; ++e; break;
+  case 'F': v *= 1e-15; ++e; break;
+  case 'A': v *= 1e-18; ++e; break;
+  case 'M':
+    if(toupper(e[1]) == 'E' && toupper(e[2]) == 'G'){
+      v *= 1e6;
+      e += 3;
+    }else if(toupper(e[1]) == 'I' && toupper(e[2]) == 'L'){
+      v *= 25.4e-6;
+      e += 3;
+    }else{
+      v *= 1e-3;
+      ++e;
+    }
+    break;
+  default:
+    break;
+  }
+  while(isalpha(*e)){
+    ++e;
+  }
+  while(isspace(*e)){
+    ++e;
+  }
+  *x = v;
+  return !*e;
+}
+/*--------------------------------------------------------------------------*/
+struct BIN_RANGE {
+  std::string name;
+  double lb, ub;
+  bool lb_closed, ub_closed;
+  bool exclude;
+
+  bool contains(double x)const {
+    return (lb_closed ? lb<=x : lb<x) && (ub_closed ? x<=ub : x<ub);
+  }
+  bool admits(double x)const { return contains(x) != exclude; }
+};
+/*--------------------------------------------------------------------------*/
+// bumped when a definition comes or goes, see CMD_VA_OVERLOAD
+static size_t overload_generation = 0;
+// the ranges of the registered definitions, and of the one being parsed,
+// by scope.
+static std::map<CARD const*, std::vector<BIN_RANGE>> definition_ranges;
+static std::map<CARD_LIST const*, std::vector<BIN_RANGE>> pending_ranges;
+/*--------------------------------------------------------------------------*/
+class OVERLOAD_INDEX {
+  struct CANDIDATE {
+    CARD* card;
+    std::vector<BIN_RANGE> ranges;
+    std::map<std::string, double> defaults; // numeric, ranged parameters only
+  };
+  typedef std::vector<std::pair<std::string, std::string>> PARAMS;
+  std::vector<CANDIDATE> _c;
+  size_t _size{0};
+  CARD const* _front{NULL};
+  CARD const* _back{NULL};
+  size_t _generation{0};
+  bool _built{false};
+  size_t _users{0}; // prototypes, see DEV_INSTANCE_PROTO::index
+  // bins of the key parameter. slot 2j+1 is _cuts[j], slot 2j the open
+  // interval below it.
+  std::string _key;
+  std::vector<double> _cuts;
+  std::vector<std::vector<size_t>> _slots;
+public:
+  bool is_current(CARD_LIST const&)const;
+  void build(CARD_LIST const&, std::string const& modelname);
+  void select(PARAMS const&, std::vector<CARD*>*)const;
+  void all(std::vector<CARD*>*)const;
+  size_t size()const {return _c.size();}
+  void attach() {++_users;}
+  bool detach() {assert(_users); return !--_users;}
+private:
+  bool admits(CANDIDATE const&, std::map<std::string, double> const& num,
+              std::set<std::string> const& given)const;
+  size_t slot(double x)const;
+};
+/*--------------------------------------------------------------------------*/
+bool OVERLOAD_INDEX::is_current(CARD_LIST const& l)const
+{
+  if(!_built || _generation != overload_generation || l.size() != _size){
+    return false;
+  }else if(!_size){ untested();
+    return true;
+  }else{
+    return *l.begin() == _front && *std::prev(l.end()) == _back;
+  }
+}
+/*--------------------------------------------------------------------------*/
+void OVERLOAD_INDEX::build(CARD_LIST const& toplevel, std::string const& modelname)
+{
+  _c.clear();
+  _cuts.clear();
+  _slots.clear();
+  _key = "";
+
+  std::map<std::string, size_t> count;
+  for(CARD_LIST::const_iterator i = toplevel.find_(modelname);
+      i != toplevel.end(); i = toplevel.find_again(modelname, ++i)){
+    CANDIDATE c;
+    c.card = *i;
+    auto d = definition_ranges.find(c.card);
+    if(d == definition_ranges.end()){
+    }else if(CARD_LIST const* s = c.card->subckt()){
+      PARAM_LIST const* pl = s->params();
+      std::set<std::string> keys;
+      for(auto const& r : d->second){
+	c.ranges.push_back(r);
+	if(!r.exclude){
+	  keys.insert(r.name);
+	}else{
+	}
+	PARAM_LIST::const_iterator p = pl->find(r.name);
+	double v;
+	if(p == pl->end() || !p->second.has_hard_value()){
+	}else if(parse_number(p->second.string(), &v)){
+	  c.defaults[r.name] = v;
+	}else{
+	}
+      }
+      for(auto const& k : keys){
+	++count[k];
+      }
+    }else{ untested();
+    }
+    _c.push_back(c);
+  }
+
+  _size = toplevel.size();
+  _front = _size ? *toplevel.begin() : NULL;
+  _back = _size ? *std::prev(toplevel.end()) : NULL;
+  _generation = overload_generation;
+  _built = true;
+
+  size_t best = 1;
+  for(auto const& k : count){
+    if(k.second > best){
+      best = k.second;
+      _key = k.first;
+    }else{
+    }
+  }
+  if(_key == ""){
+    return;
+  }else{
+  }
+
+  for(auto const& c : _c){
+    for(auto const& r : c.ranges){
+      if(r.name == _key && !r.exclude){
+	_cuts.push_back(r.lb);
+	_cuts.push_back(r.ub);
+      }else{
+      }
+    }
+  }
+  std::sort(_cuts.begin(), _cuts.end());
+  _cuts.erase(std::unique(_cuts.begin(), _cuts.end()), _cuts.end());
+
+  size_t m = _cuts.size();
+  _slots.resize(2*m + 1);
+  for(size_t i = 0; i < _c.size(); ++i){
+    // the first key range places the candidate, admits checks the others.
+    BIN_RANGE const* k = NULL;
+    for(auto const& r : _c[i].ranges){
+      if(r.name == _key && !r.exclude){
+	k = &r;
+	break;
+      }else{
+      }
+    }
+    for(size_t s = 0; s <= 2*m; ++s){
+      double x;
+      if(s % 2){
+	x = _cuts[s/2];
+      }else if(s < 2*m){
+	x = std::nextafter(_cuts[s/2], -HUGE_VAL);
+      }else{
+	x = std::nextafter(_cuts[m-1], HUGE_VAL);
+      }
+      if(!k || k->contains(x)){
+	_slots[s].push_back(i);
+      }else{
+      }
+    }
+  }
+}
+/*--------------------------------------------------------------------------*/
+size_t OVERLOAD_INDEX::slot(double x)const
+{
+  size_t j = size_t(std::lower_bound(_cuts.begin(), _cuts.end(), x) - _cuts.begin());
+  if(j < _cuts.size() && _cuts[j] == x){
+    return 2*j + 1;
+  }else{
+    return 2*j;
+  }
+}
+/*--------------------------------------------------------------------------*/
+bool OVERLOAD_INDEX::admits(CANDIDATE const& c, std::map<std::string, double> const& num,
+                            std::set<std::string> const& given)const
+{
+  for(auto const& r : c.ranges){
+    auto n = num.find(r.name);
+    auto d = c.defaults.find(r.name);
+    if(n != num.end()){
+      if(!r.admits(n->second)){
+	return false;
+      }else{
+      }
+    }else if(given.count(r.name)){
+      // not a number.
+    }else if(d != c.defaults.end() && !r.admits(d->second)){
+      return false;
+    }else{
+    }
+  }
+  return true;
+}
+/*--------------------------------------------------------------------------*/
+// the candidates that may be valid for an instance with parameters p, in
+// library order.
+void OVERLOAD_INDEX::select(PARAMS const& p, std::vector<CARD*>* out)const
+{
+  assert(out);
+  std::map<std::string, double> num;
+  std::set<std::string> given;
+  for(auto const& x : p){
+    double d;
+    if(x.first == ""){
+      // by position. no names to match.
+      all(out);
+      return;
+    }else if(parse_number(x.second, &d)){
+      num[x.first] = d;
+    }else{
+    }
+    given.insert(x.first);
+  }
+
+  auto k = num.find(_key);
+  if(_key != "" && k != num.end()){
+    for(size_t i : _slots[slot(k->second)]){
+      if(admits(_c[i], num, given)){
+	out->push_back(_c[i].card);
+      }else{
+      }
+    }
+  }else{
+    for(auto const& c : _c){
+      if(admits(c, num, given)){
+	out->push_back(c.card);
+      }else{
+      }
+    }
+  }
+}
+/*--------------------------------------------------------------------------*/
+void OVERLOAD_INDEX::all(std::vector<CARD*>* out)const
+{
+  assert(out);
+  for(auto const& c : _c){
+    out->push_back(c.card);
+  }
+}
+/*--------------------------------------------------------------------------*/
+// not destroyed, protos may go later. an entry goes with its last user.
+static std::map<std::string, OVERLOAD_INDEX>& overload_index()
+{
+  static std::map<std::string, OVERLOAD_INDEX>* ix = new std::map<std::string, OVERLOAD_INDEX>;
+  return *ix;
+}
+/*--------------------------------------------------------------------------*/
+// keeps track of module and paramset definitions. A definition that is
+// added, replaced or deleted starts a new generation, and the indices are
+// rebuilt on next use. The list size and ends catch the others.
+//
+// va_overload   print generation, definitions and indexed model names
+class CMD_VA_OVERLOAD : public CMD, public VA_OVERLOADS {
+  std::set<CARD const*> _defs;
+private: // CMD
+  void do_it(CS& cmd, CARD_LIST*)override {
+    cmd.check(bWARNING, "what's this?");
+    IO::mstdout << "va_overload generation=" << overload_generation
+		<< " definitions=" << _defs.size()
+		<< " indexed=" << overload_index().size() << '\n';
+  }
+private: // VA_OVERLOADS
+  void add(CARD const* c)override {
+    _defs.insert(c);
+    definition_ranges.erase(c);
+    auto p = pending_ranges.find(c->subckt());
+    if(p != pending_ranges.end()){
+      definition_ranges[c] = std::move(p->second);
+    }else{
+    }
+    // left over from a failed definition, if any.
+    pending_ranges.clear();
+    ++overload_generation;
+  }
+  void remove(CARD const* c)override {
+    if(_defs.erase(c)){
+      definition_ranges.erase(c);
+      ++overload_generation;
+    }else{
+    }
+  }
+  void add_range(CARD_LIST const* scope, std::string const& name,
+                 double lb, double ub, bool lb_closed, bool ub_closed,
+                 bool exclude)override {
+    pending_ranges[scope].push_back(BIN_RANGE{name, lb, ub, lb_closed, ub_closed, exclude});
+  }
+  size_t generation()const override {
+    return overload_generation;
+  }
+} p_overload;
+DISPATCHER<CMD>::INSTALL d_overload(&command_dispatcher, "va_overload", &p_overload);
+/*--------------------------------------------------------------------------*/
 class DEV_INSTANCE_PROTO;
 class COMMON_INSTANCE : public COMMON_PARAMLIST {
 public:
@@ -219,7 +571,13 @@ public:
   }
   ~DEV_INSTANCE_PROTO(){
     protos().erase(this);
+    release_index();
   }
+private:
+  std::string _indexed; // model name, see index()
+  void release_index();
+public:
+  OVERLOAD_INDEX& index(std::string const& modelname);
 private:
   CARD* clone() const override;
   CARD* clone_instance()const override{ untested(); return clone();}
@@ -257,6 +615,32 @@ public:
 }pp; // DEV_INSTANCE_PROTO
 DISPATCHER<CARD>::INSTALL dd(&device_dispatcher, "instance_proto", &pp);
 /*--------------------------------------------------------------------------*/
+// the overload index for modelname, kept while a prototype uses it.
+OVERLOAD_INDEX& DEV_INSTANCE_PROTO::index(std::string const& modelname)
+{
+  if(_indexed == modelname){ untested();
+  }else{
+    release_index();
+    overload_index()[modelname].attach();
+    _indexed = modelname;
+  }
+  return overload_index()[modelname];
+}
+/*--------------------------------------------------------------------------*/
+void DEV_INSTANCE_PROTO::release_index()
+{
+  if(_indexed == ""){
+  }else{
+    auto i = overload_index().find(_indexed);
+    assert(i != overload_index().end());
+    if(i->second.detach()){
+      overload_index().erase(i);
+    }else{
+    }
+    _indexed = "";
+  }
+}
+/*--------------------------------------------------------------------------*/
 void INSTANCE::prepare_overload(CARD* model, std::string modelname, DEV_INSTANCE_PROTO* Proto) const
 {
   // assert(Proto==this); // for now.
@@ -369,9 +753,21 @@ void INSTANCE::collect_overloads(DEV_INSTANCE_PROTO* Proto) const
     assert(Proto->subckt());
     CARD_LIST const& toplevel = CARD_LIST::card_list;
 
-    CARD_LIST::const_iterator i = toplevel.find_(modelname);
-    while(i != toplevel.end()) {
-      auto const& a = attributes(tag_t(*i));
+    OVERLOAD_INDEX& ix = Proto->index(modelname);
+    if(!ix.is_current(toplevel)){
+      ix.build(toplevel, modelname);
+    }else{
+    }
+    std::vector<CARD*> top;
+    ix.select(_params, &top);
+    if(top.empty()){
+      // none fits. let expand report it.
+      ix.all(&top);
+    }else{
+    }
+
+    for(CARD* i : top){
+      auto const& a = attributes(tag_t(i));
       std::string desc;
       if(a){
 	desc = a->operator[](std::string("desc"));
@@ -384,8 +780,7 @@ void INSTANCE::collect_overloads(DEV_INSTANCE_PROTO* Proto) const
       }
       error(bLOG, long_label() + ": " + modelname + " from top level" + desc + "\n");
 
-      prepare_overload(*i, modelname, Proto);
-      i = toplevel.find_again(modelname, ++i);
+      prepare_overload(i, modelname, Proto);
     }
 
     MODEL_CARD* m = model_dispatcher[modelname];
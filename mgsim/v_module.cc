@@ -27,6 +27,8 @@
 #include <e_paramlist.h>
 #include <e_subckt.h>
 #include <io_trace.h>
+#include <c_comand.h>
+#include "e_va.h"
 /*--------------------------------------------------------------------------*/
 namespace{
 /*--------------------------------------------------------------------------*/
@@ -54,6 +56,15 @@ static void grow_nodes(size_t Index, node_t*& n, size_t& capacity, size_t capaci
 /*--------------------------------------------------------------------------*/
 static COMMON_PARAMLIST Default_SUBCKT(CC_STATIC);
 /*--------------------------------------------------------------------------*/
+// a top level definition may go, see VA_OVERLOADS
+static void overload_remove(CARD const* c)
+{
+  if(auto o = dynamic_cast<VA_OVERLOADS*>(command_dispatcher["va_overload"])){
+    o->remove(c);
+  }else{
+  }
+}
+/*--------------------------------------------------------------------------*/
 class DEV_MODULE : public BASE_SUBCKT {
 private:
   friend class DEV_SUBCKT_PROTO;
@@ -64,7 +75,7 @@ protected:
   explicit	DEV_MODULE(const DEV_MODULE&);
 public:
   explicit	DEV_MODULE(COMMON_COMPONENT* c);
-		~DEV_MODULE()		{ delete[] _n; _node_capacity = 0; }
+		~DEV_MODULE();
   CARD*		clone()const override;
 private:
   void		set_port_by_index(int Index, std::string& Value) override;
@@ -339,6 +350,13 @@ DEV_MODULE::DEV_MODULE(const DEV_MODULE& p)
   assert(!subckt());
 }
 /*--------------------------------------------------------------------------*/
+DEV_MODULE::~DEV_MODULE()
+{
+  overload_remove(this);
+  delete[] _n;
+  _node_capacity = 0;
+}
+/*--------------------------------------------------------------------------*/
 int DEV_MODULE::set_param_by_name(std::string Name, std::string Value)
 {
   assert(_parent);
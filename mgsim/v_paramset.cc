@@ -24,6 +24,9 @@
 #include <e_paramlist.h>
 #include <globals.h>
 #include <u_lang.h>
+#include <c_comand.h>
+#include "e_va.h"
+#include <unordered_map>
 /*--------------------------------------------------------------------------*/
 namespace{
 /*--------------------------------------------------------------------------*/
@@ -32,6 +35,27 @@ const size_t node_capacity_floor = 2;
 /*--------------------------------------------------------------------------*/
 static COMMON_PARAMLIST Default_PARAMSET(CC_STATIC);
 /*--------------------------------------------------------------------------*/
+// a top level definition may go, see VA_OVERLOADS
+static void overload_remove(CARD const* c)
+{
+  if(auto o = dynamic_cast<VA_OVERLOADS*>(command_dispatcher["va_overload"])){
+    o->remove(c);
+  }else{
+  }
+}
+/*--------------------------------------------------------------------------*/
+// bumped whenever a top level definition comes or goes
+static size_t definitions_generation()
+{
+  static VA_OVERLOADS const* o = NULL;
+  if(o){
+  }else if((o = dynamic_cast<VA_OVERLOADS const*>(command_dispatcher["va_overload"]))){
+  }else{ untested();
+    return 0;
+  }
+  return o->generation();
+}
+/*--------------------------------------------------------------------------*/
 // from u_lang.cc, cut down a bit.
 static CARD const* find_proto(const std::string& Name, const CARD* Scope)
 {
@@ -65,14 +89,19 @@ static CARD const* find_proto(const std::string& Name, const CARD* Scope)
 } // find_proto
 /*--------------------------------------------------------------------------*/
 class PARAMSET : public BASE_SUBCKT {
+  typedef std::vector<std::pair<std::string, Expression*>> ARGS;
 private: // partly redudant
   PARAMSET const* _parent; // use _dev?
   COMPONENT const* _dev; // owned by paramset instance.
   size_t _node_capacity;
+  mutable ARGS _args; // prototype only, parsed from _args_common.
+  mutable COMMON_COMPONENT const* _args_common{NULL};
+  mutable size_t _args_generation{0};
+  mutable std::unordered_map<std::string, std::string> _resolved; // same.
 public:
   PARAMSET();
   PARAMSET(PARAMSET const& p);
-  ~PARAMSET(){ delete[] _n; _node_capacity = 0; }
+  ~PARAMSET();
 private:
   bool is_device() const override { return owner(); }
   std::string value_name()const override{ untested();unreachable(); return "";}
@@ -230,6 +259,10 @@ private: // no ops for top level
 #endif
 private:
   COMPONENT const* prepare_dev(CARD const* proto);
+  ARGS const& args()const;
+  void clear_args()const;
+public: // prototype
+  std::string const& resolved(std::string const& value)const;
 private: // base class?
   void grow_nodes(size_t);
 }ps;
@@ -271,6 +304,46 @@ PARAMSET::PARAMSET(PARAMSET const& p)
   }
 }
 /*--------------------------------------------------------------------------*/
+PARAMSET::~PARAMSET()
+{
+  overload_remove(this);
+  delete[] _n;
+  _node_capacity = 0;
+  clear_args();
+}
+/*--------------------------------------------------------------------------*/
+void PARAMSET::clear_args()const
+{
+  for(auto& a : _args){
+    delete a.second;
+  }
+  _args.clear();
+  _args_common = NULL;
+  _resolved.clear();
+}
+/*--------------------------------------------------------------------------*/
+// the argument expressions, .name=value, of a paramset prototype.
+PARAMSET::ARGS const& PARAMSET::args()const
+{
+  auto pc = prechecked_cast<COMMON_PARAMLIST const*>(common());
+  assert(pc);
+  if(_args_common != pc || _args_generation != definitions_generation()){
+    // the definition has changed.
+    clear_args();
+  }else{
+  }
+  if(!_args_common){
+    _args_common = pc;
+    _args_generation = definitions_generation();
+    for(auto const& p : pc->_params){
+      CS cmd(CS::_STRING, p.second.string());
+      _args.push_back(std::make_pair(p.first, new Expression(cmd)));
+    }
+  }else{
+  }
+  return _args;
+}
+/*--------------------------------------------------------------------------*/
 CARD* PARAMSET::clone() const
 {
   PARAMSET* n = new PARAMSET(*this);
@@ -455,56 +528,84 @@ static void demangle(std::string& value)
   }
 }
 /*--------------------------------------------------------------------------*/
-void resolve_copy(CARD_LIST* t, PARAM_LIST const& p, const CARD_LIST*)
+// an instance value with its symbols prefixed, so they survive e_val in
+// the paramset. instances mostly pass the same few values, the prototype
+// keeps the results along with its args.
+std::string const& PARAMSET::resolved(std::string const& value)const
+{
+  auto m = _resolved.find(value);
+  if(m != _resolved.end()){
+    return m->second;
+  }else{
+  }
+
+  CS cmd(CS::_STRING, value);
+  Expression f(cmd);
+  CARD_LIST empty;
+  empty.set_verilog_math();
+  Expression e(f, &empty);
+  Expression E;
+
+  bool skip1 = false;
+  for(auto ii=e.begin(); ii!=e.end(); ++ii){
+    trace2("EXP", (*ii)->name(), dynamic_cast<Token_SYMBOL*>(*ii));
+    trace2("EXP", (*ii)->name(), dynamic_cast<Token_CONSTANT*>(*ii));
+    if(dynamic_cast<Token_PARLIST*>(*ii)){
+      skip1 = true;
+      E.push_back(*ii);
+    }else if(skip1){
+      assert(dynamic_cast<Token_SYMBOL*>(*ii));
+      E.push_back(*ii);
+      skip1 = false;
+    }else if(dynamic_cast<Token_CONSTANT*>(*ii)
+	&& !dynamic_cast<const Float*>((*ii)->data())
+	&& !dynamic_cast<const Integer*>((*ii)->data())) {
+      incomplete(); // probably;
+	    unreachable(); // unfixed m_expression_reduce gets us here.
+      E.push_back(new Token_SYMBOL("_." + (*ii)->name()));
+      delete(*ii);
+    }else if(dynamic_cast<Token_SYMBOL*>(*ii)) {
+      assert(!dynamic_cast<const Float*>((*ii)->data()));
+      assert(!dynamic_cast<const Integer*>((*ii)->data()));
+      E.push_back(new Token_SYMBOL("_." + (*ii)->name()));
+      delete(*ii);
+    }else{
+      E.push_back(*ii);
+    }
+  }
+  while(e.size()){
+    e.pop_back();
+  }
+
+  std::stringstream s;
+  E.dump(s);
+  return _resolved.emplace(value, s.str()).first->second;
+}
+/*--------------------------------------------------------------------------*/
+// a reduced number. the token name is its value.
+static bool is_number(Expression const& e)
+{
+  if(e.size() != 1){
+    return false;
+  }else if(auto c = dynamic_cast<Token_CONSTANT const*>(e.front())){
+    return dynamic_cast<Float const*>(c->data())
+        || dynamic_cast<Integer const*>(c->data());
+  }else{
+    return false;
+  }
+}
+/*--------------------------------------------------------------------------*/
+void resolve_copy(CARD_LIST* t, PARAM_LIST const& p, PARAMSET const* proto)
 {
   assert(t);
+  assert(proto);
   PARAM_LIST& out = *t->params();
 
   for (PARAM_LIST::const_iterator i = p.begin(); i != p.end(); ++i) {
     if (i->second.has_hard_value()) {
-      CS cmd(CS::_STRING, i->second.string());
-      Expression f(cmd);
-      CARD_LIST empty;
-      empty.set_verilog_math();
-      Expression e(f, &empty);
-      Expression E;
-	
-      bool skip1 = false;
-      for(auto ii=e.begin(); ii!=e.end(); ++ii){
-	trace2("EXP", (*ii)->name(), dynamic_cast<Token_SYMBOL*>(*ii));
-	trace2("EXP", (*ii)->name(), dynamic_cast<Token_CONSTANT*>(*ii));
-	if(dynamic_cast<Token_PARLIST*>(*ii)){
-	  skip1 = true;
-	  E.push_back(*ii);
-	}else if(skip1){
-	  assert(dynamic_cast<Token_SYMBOL*>(*ii));
-	  E.push_back(*ii);
-	  skip1 = false;
-	}else if(dynamic_cast<Token_CONSTANT*>(*ii)
-	    && !dynamic_cast<const Float*>((*ii)->data())
-	    && !dynamic_cast<const Integer*>((*ii)->data())) {
-	  incomplete(); // probably;
-		unreachable(); // unfixed m_expression_reduce gets us here.
-	  E.push_back(new Token_SYMBOL("_." + (*ii)->name()));
-	  delete(*ii);
-	}else if(dynamic_cast<Token_SYMBOL*>(*ii)) {
-	  assert(!dynamic_cast<const Float*>((*ii)->data()));
-	  assert(!dynamic_cast<const Integer*>((*ii)->data()));
-	  E.push_back(new Token_SYMBOL("_." + (*ii)->name()));
-	  delete(*ii);
-	}else{
-	  E.push_back(*ii);
-	}
-      }
-      while(e.size()){
-	e.pop_back();
-      }
-
-      std::stringstream s;
-      E.dump(s);
-      out.set(i->first, s.str());
-      trace2("resolve copy1", i->first, s.str());
-
+      std::string const& s = proto->resolved(i->second.string());
+      out.set(i->first, s);
+      trace2("resolve copy1", i->first, s);
     }else{ untested();
     }
   }
@@ -526,29 +627,34 @@ CARD* PARAMSET::deflate()
   assert(dev->owner()==this);
 
   auto c = prechecked_cast<COMMON_PARAMLIST*>(mutable_common());
-  auto pc = prechecked_cast<COMMON_PARAMLIST const*>(_parent->common());
 
   *subckt()->params() = PARAM_LIST();
   // c->_params set_try_again ...
   subckt()->params()->set_try_again(_parent->subckt()->params());
   trace0("PARAMSET::resolve?");
-  resolve_copy(subckt(), c->_params, NULL);
+  // before resolve_copy, drops the results if the definition has changed.
+  ARGS const& args = _parent->args();
+  resolve_copy(subckt(), c->_params, _parent);
   for(auto const& x : c->_params){
     trace1("debugp", x.first);
   }
 
   trace4("PARAMSET::deflate args fwd", dev->long_label(), dev->dev_type(), long_label(), dev_type());
   trace2("PARAMSET::deflate args fwd", dev->long_label(), my_mfactor());
-  for(auto pi=pc->_params.begin(); pi!=pc->_params.end(); ++pi){
-    trace3("PARAMSET::deflate args fwd2", dev->long_label(), pi->first, pi->second.string());
-    CS cmd(CS::_STRING, pi->second.string());
-    Expression e(cmd);
-    Expression r(e, subckt());
-    std::stringstream s;
-    r.dump(s);
-
-    std::string value = s.str();
-    demangle(value);
+  for(auto pi=args.begin(); pi!=args.end(); ++pi){
+    trace2("PARAMSET::deflate args fwd2", dev->long_label(), pi->first);
+    assert(pi->second);
+    Expression r(*pi->second, subckt());
+    std::string value;
+    if(is_number(r)){
+      // nothing to demangle
+      value = r.front()->name();
+    }else{
+      std::stringstream s;
+      r.dump(s);
+      value = s.str();
+      demangle(value);
+    }
     trace3("PARAMSET::deflate args fix", long_label(), pi->first, value);
     assert(pi->first!="");
     assert(pi->first!="$mfactor");
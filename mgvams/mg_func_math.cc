@@ -43,6 +43,12 @@
 //}
 /*--------------------------------------------------------------------------*/
 namespace{
+/*--------------------------------------------------------------------------*/
+// the result depends on the arguments only.
+class MATH_FUNCTION : public MGVAMS_FUNCTION {
+  bool is_pure()const override {return true;}
+  bool is_reentrant()const override {return true;}
+};
 #if 1
 /*--------------------------------------------------------------------------*/
 
@@ -80,9 +86,9 @@ DISPATCHER<FUNCTION>::INSTALL d_max(&function_dispatcher, "max|$max", &max);
 #endif
 #if 1
 /*--------------------------------------------------------------------------*/
-class abs : public MGVAMS_FUNCTION {
+class abs : public MATH_FUNCTION {
 public:
-  explicit abs() : MGVAMS_FUNCTION(){
+  explicit abs() : MATH_FUNCTION(){
     set_label("abs");
   }
   ~abs() { }
@@ -111,9 +117,9 @@ public:
 } p_abs;
 DISPATCHER<FUNCTION>::INSTALL d_abs(&function_dispatcher, "abs|$abs", &p_abs);
 /*--------------------------------------------------------------------------*/
-class asinh : public MGVAMS_FUNCTION {
+class asinh : public MATH_FUNCTION {
 public:
-  asinh() : MGVAMS_FUNCTION(){
+  asinh() : MATH_FUNCTION(){
     set_label("asinh");
   }
   std::string eval(CS& Cmd, const CARD_LIST* Scope)const override { untested();
@@ -142,9 +148,9 @@ public:
 } p_asinh;
 DISPATCHER<FUNCTION>::INSTALL d_asinh(&function_dispatcher, "asinh|$asinh", &p_asinh);
 /*--------------------------------------------------------------------------*/
-class atan : public MGVAMS_FUNCTION {
+class atan : public MATH_FUNCTION {
 public:
-  atan() : MGVAMS_FUNCTION(){
+  atan() : MATH_FUNCTION(){
     set_label("atan");
   }
   std::string eval(CS& Cmd, const CARD_LIST* Scope)const override { untested();
@@ -172,9 +178,9 @@ public:
 } p_atan;
 DISPATCHER<FUNCTION>::INSTALL d_atan(&function_dispatcher, "atan|$atan", &p_atan);
 /*--------------------------------------------------------------------------*/
-class atanh : public MGVAMS_FUNCTION {
+class atanh : public MATH_FUNCTION {
 public:
-  atanh() : MGVAMS_FUNCTION(){
+  atanh() : MATH_FUNCTION(){
     set_label("atanh");
   }
   std::string eval(CS& Cmd, const CARD_LIST* Scope)const override { untested();
@@ -201,9 +207,9 @@ public:
 } p_atanh;
 DISPATCHER<FUNCTION>::INSTALL d_atanh(&function_dispatcher, "atanh|$atanh", &p_atanh);
 /*--------------------------------------------------------------------------*/
-class cos : public MGVAMS_FUNCTION {
+class cos : public MATH_FUNCTION {
 public:
-  explicit cos() : MGVAMS_FUNCTION(){
+  explicit cos() : MATH_FUNCTION(){
     set_label("cos");
   }
   std::string eval(CS& Cmd, const CARD_LIST* Scope)const override { itested();
@@ -228,9 +234,9 @@ public:
 } p_cos;
 DISPATCHER<FUNCTION>::INSTALL d_cos(&function_dispatcher, "cos|$cos", &p_cos);
 /*--------------------------------------------------------------------------*/
-class cosh : public MGVAMS_FUNCTION {
+class cosh : public MATH_FUNCTION {
 public:
-  explicit cosh() : MGVAMS_FUNCTION(){
+  explicit cosh() : MATH_FUNCTION(){
     set_label("cosh");
   }
   std::string eval(CS& Cmd, const CARD_LIST* Scope)const override { itested();
@@ -255,9 +261,9 @@ public:
 } p_cosh;
 DISPATCHER<FUNCTION>::INSTALL d_cosh(&function_dispatcher, "cosh|$cosh", &p_cosh);
 /*--------------------------------------------------------------------------*/
-class exp : public MGVAMS_FUNCTION {
+class exp : public MATH_FUNCTION {
 public:
-  explicit exp() : MGVAMS_FUNCTION(){
+  explicit exp() : MATH_FUNCTION(){
     set_label("exp");
   }
   std::string eval(CS& Cmd, const CARD_LIST* Scope)const override { untested();
@@ -285,9 +291,9 @@ public:
 } p_exp;
 DISPATCHER<FUNCTION>::INSTALL d_exp(&function_dispatcher, "exp|$exp", &p_exp);
 /*--------------------------------------------------------------------------*/
-class expm1 : public MGVAMS_FUNCTION {
+class expm1 : public MATH_FUNCTION {
 public:
-  explicit expm1() : MGVAMS_FUNCTION(){
+  explicit expm1() : MATH_FUNCTION(){
     set_label("expm1");
   }
   std::string eval(CS& Cmd, const CARD_LIST* Scope)const override { untested();
@@ -312,9 +318,9 @@ public:
 } p_expm1;
 DISPATCHER<FUNCTION>::INSTALL d_expm1(&function_dispatcher, "expm1|$expm1", &p_expm1);
 /*--------------------------------------------------------------------------*/
-class limexp : public MGVAMS_FUNCTION {
+class limexp : public MATH_FUNCTION {
 public:
-  explicit limexp() : MGVAMS_FUNCTION(){
+  explicit limexp() : MATH_FUNCTION(){
     set_label("limexp");
   }
   ~limexp() { }
@@ -353,9 +359,9 @@ public:
 } p_limexp;
 DISPATCHER<FUNCTION>::INSTALL d_limexp(&function_dispatcher, "limexp|$limexp", &p_limexp);
 /*--------------------------------------------------------------------------*/
-class floor : public MGVAMS_FUNCTION {
+class floor : public MATH_FUNCTION {
 public:
-  explicit floor() : MGVAMS_FUNCTION(){
+  explicit floor() : MATH_FUNCTION(){
     set_label("$floor");
   }
   std::string eval(CS& Cmd, const CARD_LIST* Scope)const override { untested();
@@ -376,9 +382,9 @@ public:
 } p_floor;
 DISPATCHER<FUNCTION>::INSTALL d_floor(&function_dispatcher, "floor|$floor", &p_floor);
 /*--------------------------------------------------------------------------*/
-class log : public MGVAMS_FUNCTION {
+class log : public MATH_FUNCTION {
 public:
-  explicit log() : MGVAMS_FUNCTION(){
+  explicit log() : MATH_FUNCTION(){
     set_label("$log10");
   }
   std::string eval(CS& Cmd, const CARD_LIST* Scope)const override { untested();
@@ -412,9 +418,9 @@ public:
 } p_log;
 DISPATCHER<FUNCTION>::INSTALL d_log(&function_dispatcher, "log|$log10", &p_log);
 /*--------------------------------------------------------------------------*/
-class ln : public MGVAMS_FUNCTION {
+class ln : public MATH_FUNCTION {
 public:
-  explicit ln() : MGVAMS_FUNCTION(){
+  explicit ln() : MATH_FUNCTION(){
     set_label("ln");
   }
   std::string eval(CS& Cmd, const CARD_LIST* Scope)const override { untested();
@@ -451,9 +457,9 @@ public:
 } p_ln;
 DISPATCHER<FUNCTION>::INSTALL d_ln(&function_dispatcher, "ln|$ln|$log", &p_ln);
 /*--------------------------------------------------------------------------*/
-class ln1p : public MGVAMS_FUNCTION {
+class ln1p : public MATH_FUNCTION {
 public:
-  explicit ln1p() : MGVAMS_FUNCTION(){
+  explicit ln1p() : MATH_FUNCTION(){
     set_label("ln1p");
   }
   std::string eval(CS& Cmd, const CARD_LIST* Scope)const override { untested();
@@ -487,9 +493,9 @@ public:
 } p_ln1p;
 DISPATCHER<FUNCTION>::INSTALL d_ln1p(&function_dispatcher, "ln1p|$ln1p", &p_ln1p);
 /*--------------------------------------------------------------------------*/
-class pow: public MGVAMS_FUNCTION {
+class pow: public MATH_FUNCTION {
 public:
-  explicit pow() : MGVAMS_FUNCTION(){
+  explicit pow() : MATH_FUNCTION(){
     set_label("pow");
   }
   ~pow() { }
@@ -543,9 +549,9 @@ public:
 } p_pow;
 DISPATCHER<FUNCTION>::INSTALL d_pow(&function_dispatcher, "pow|$pow", &p_pow);
 /*--------------------------------------------------------------------------*/
-class sin : public MGVAMS_FUNCTION {
+class sin : public MATH_FUNCTION {
 public:
-  explicit sin() : MGVAMS_FUNCTION(){
+  explicit sin() : MATH_FUNCTION(){
     set_label("sin");
   }
   std::string eval(CS& Cmd, const CARD_LIST* Scope)const override { itested();
@@ -570,9 +576,9 @@ public:
 } p_sin;
 DISPATCHER<FUNCTION>::INSTALL d_sin(&function_dispatcher, "sin|$sin", &p_sin);
 /*--------------------------------------------------------------------------*/
-class sinh : public MGVAMS_FUNCTION {
+class sinh : public MATH_FUNCTION {
 public:
-  explicit sinh() : MGVAMS_FUNCTION(){
+  explicit sinh() : MATH_FUNCTION(){
     set_label("sinh");
   }
   std::string eval(CS& Cmd, const CARD_LIST* Scope)const override { itested();
@@ -598,9 +604,9 @@ public:
 } p_sinh;
 DISPATCHER<FUNCTION>::INSTALL d_sinh(&function_dispatcher, "sinh|$sinh", &p_sinh);
 /*--------------------------------------------------------------------------*/
-class sqrt : public MGVAMS_FUNCTION {
+class sqrt : public MATH_FUNCTION {
 public:
-  explicit sqrt() : MGVAMS_FUNCTION(){
+  explicit sqrt() : MATH_FUNCTION(){
     set_label("sqrt");
   }
   std::string eval(CS& Cmd, const CARD_LIST* Scope)const override { itested();
@@ -636,9 +642,9 @@ public:
 } p_sqrt;
 DISPATCHER<FUNCTION>::INSTALL d_sqrt(&function_dispatcher, "sqrt|$sqrt", &p_sqrt);
 /*--------------------------------------------------------------------------*/
-class tanh : public MGVAMS_FUNCTION {
+class tanh : public MATH_FUNCTION {
 public:
-  explicit tanh() : MGVAMS_FUNCTION(){
+  explicit tanh() : MATH_FUNCTION(){
     set_label("tanh");
   }
   std::string eval(CS& Cmd, const CARD_LIST* Scope)const override { itested();
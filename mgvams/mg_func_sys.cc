@@ -43,6 +43,7 @@ public:
   ~ABSTIME() { }
 private:
   bool static_code()const override {return true;}
+  bool is_reentrant()const override {return true;}
 //  Token* new_token(Module& m, size_t)const override { untested();
 //    m.install(this);
 //    return new Token_CALL("$abstime", this);
@@ -58,6 +59,9 @@ private:
     o____ "return _sim->_time0;\n";
     o__ "}\n";
   }
+  std::string needs_eval_cond()const override {
+    return "_sim->_time0 != _bypass_time";
+  }
 } abstime;
 DISPATCHER<FUNCTION>::INSTALL d_abstime(&function_dispatcher, "$abstime", &abstime);
 /*--------------------------------------------------------------------------*/
@@ -69,6 +73,7 @@ public:
   ~SIMPARAM(){ }
 private:
   bool static_code()const override {return true;}
+  bool is_reentrant()const override {return true;}
   std::string eval(CS&, const CARD_LIST*)const override{ untested();
     return "$$simparam";
   }
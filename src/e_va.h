@@ -25,6 +25,8 @@
 #define GNUCAP_E_VA_H
 /*--------------------------------------------------------------------------*/
 #include <e_compon.h>
+#include <functional>
+#include <unordered_map>
 /*--------------------------------------------------------------------------*/
 class NATURE {
 public:
@@ -73,6 +75,178 @@ public:
   virtual int args(int) const{ untested(); return 0; }
 };
 /*--------------------------------------------------------------------------*/
+// concurrent evaluation of queued instances, installed as a command.
+class VA_EVAL_POOL {
+public:
+  class TASK {
+  public:
+    virtual ~TASK() {}
+    virtual void operator()(size_t i)const = 0;
+  };
+public:
+  virtual ~VA_EVAL_POOL() {}
+  // call t(i) for all i < n, in any order. returns when all are done.
+  virtual void run(TASK const& t, size_t n) = 0;
+};
+/*--------------------------------------------------------------------------*/
+// module and paramset definitions at top level, the candidates of
+// overloaded instances. installed as a command.
+class VA_OVERLOADS {
+public:
+  virtual ~VA_OVERLOADS() {}
+  // a definition has been added, or is about to go
+  virtual void add(CARD const*) = 0;
+  virtual void remove(CARD const*) = 0;
+  // changes with each add and each effective remove
+  virtual size_t generation()const = 0;
+  // a numeric from or exclude range of parameter name, in the definition
+  // being parsed into scope. the next add takes it over.
+  virtual void add_range(CARD_LIST const* scope, std::string const& name,
+                         double lb, double ub, bool lb_closed, bool ub_closed,
+                         bool exclude) = 0;
+};
+/*--------------------------------------------------------------------------*/
+// devices generated with gen-profile or optimize-bypass. the counters are
+// per model type and read through tr_probe_num, prof.<what>_ns,
+// prof.<what>_calls and bypass.hits, bypass.evals.
+class VA_PROFILED {
+public:
+  virtual ~VA_PROFILED() {}
+  virtual void prof_clear()const = 0;
+};
+/*--------------------------------------------------------------------------*/
+// one element for the flow branches of a module instance, optimize-fuse.
+// a branch is a DEV_CPOLY_G without current ports. states[0] is the
+// constant part, states[1] the self admittance, states[2+] transadmittances.
+// nodes[0], nodes[1] are the output, nodes[2k-2], nodes[2k-1] control
+// states[k].
+class VA_FUSED {
+public:
+  virtual ~VA_FUSED() {}
+  virtual void clear_branches() = 0;
+  virtual void add_branch(COMMON_VASRC const*, int n_states, double states[],
+			  int n_nodes, const node_t nodes[]) = 0;
+};
+/*--------------------------------------------------------------------------*/
+// commons with equal parameters, optimize-intern. hash is consistent with
+// operator== of the generated commons, it only reads parameter values.
+inline size_t va_hash(size_t h, size_t x)
+{
+  return h ^ (x + 0x9e3779b9 + (h << 6) + (h >> 2));
+}
+inline size_t va_hash(size_t h, PARAMETER<double> const& p)
+{
+  double v = p;
+  return va_hash(h, v == 0. ? size_t(0) : std::hash<double>()(v));
+}
+inline size_t va_hash(size_t h, PARAMETER<int> const& p)
+{
+  int v = p;
+  return va_hash(h, std::hash<int>()(v));
+}
+template<class T>
+size_t va_hash(size_t h, PARAMETER<T> const& p)
+{
+  return va_hash(h, std::hash<std::string>()(p.string()));
+}
+/*--------------------------------------------------------------------------*/
+class VA_COMMON_POOL;
+// the entry of an interned common, a member of the common. a copy is not
+// interned.
+class VA_POOLED {
+  friend class VA_COMMON_POOL;
+  VA_COMMON_POOL* _pool{NULL};
+  size_t _hash{0};
+public:
+  VA_POOLED() {}
+  VA_POOLED(VA_POOLED const&) {}
+  VA_POOLED& operator=(VA_POOLED const&) {return *this;}
+  inline ~VA_POOLED();
+  bool is_pooled()const {return _pool;}
+};
+/*--------------------------------------------------------------------------*/
+// interned commons by hash. equal commons in the same scope evaluate to
+// the same values, so they are shared within a scope only.
+class VA_COMMON_POOL {
+  struct ENTRY {
+    COMMON_COMPONENT* common;
+    CARD_LIST const* scope;
+    VA_POOLED* pooled;
+  };
+  std::unordered_multimap<size_t, ENTRY> _pool;
+public:
+  VA_COMMON_POOL() {}
+  ~VA_COMMON_POOL() {
+    // commons may outlive the pool
+    for(auto& i : _pool){
+      i.second.pooled->_pool = NULL;
+    }
+  }
+  // an equal common in scope, or NULL
+  COMMON_COMPONENT* find(COMMON_COMPONENT const& c, CARD_LIST const* scope,
+                         size_t h)const {
+    auto r = _pool.equal_range(h);
+    for(auto i = r.first; i != r.second; ++i){
+      if(i->second.scope == scope && *i->second.common == c){
+	return i->second.common;
+      }else{
+      }
+    }
+    return NULL;
+  }
+  void insert(COMMON_COMPONENT* c, VA_POOLED* p, CARD_LIST const* scope,
+              size_t h) {
+    assert(p);
+    assert(!p->_pool);
+    p->_pool = this;
+    p->_hash = h;
+    _pool.emplace(h, ENTRY{c, scope, p});
+  }
+  // the parameters of an entry have changed.
+  void rehash(VA_POOLED* p, size_t h) {
+    assert(p);
+    assert(p->_pool == this);
+    if(h == p->_hash){
+    }else{
+      auto r = _pool.equal_range(p->_hash);
+      for(auto i = r.first; i != r.second; ++i){
+	if(i->second.pooled == p){
+	  ENTRY e = i->second;
+	  _pool.erase(i);
+	  p->_hash = h;
+	  _pool.emplace(h, e);
+	  return;
+	}else{
+	}
+      }
+      unreachable();
+    }
+  }
+  void erase(VA_POOLED* p) {
+    assert(p);
+    assert(p->_pool == this);
+    auto r = _pool.equal_range(p->_hash);
+    for(auto i = r.first; i != r.second; ++i){
+      if(i->second.pooled == p){
+	_pool.erase(i);
+	p->_pool = NULL;
+	return;
+      }else{
+      }
+    }
+    unreachable();
+  }
+  size_t size()const {return _pool.size();}
+};
+/*--------------------------------------------------------------------------*/
+inline VA_POOLED::~VA_POOLED()
+{
+  if(_pool){
+    _pool->erase(this);
+  }else{
+  }
+}
+/*--------------------------------------------------------------------------*/
 inline void e_val(double* p, const double& x, const CARD_LIST*)
 { untested();
   assert(p);
@@ -30,6 +30,30 @@
 #include <e_storag.h>
 #include <e_base.h> // CKT_BASE
 #include <u_sim_data.h> // see simparam
+#include <m_math.h> // conchk
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+
+// vector width for ddouble_ kernels, picked at build time if VA_SIMD is
+// defined, see optimize-simd. -DVA_NO_SIMD forces the scalar fallback.
+#if !defined(VA_SIMD) || defined(VA_NO_SIMD)
+# define VA_SIMD_WIDTH 1
+#elif defined(__AVX__)
+# include <immintrin.h>
+# define VA_SIMD_WIDTH 4
+#elif defined(__SSE2__)
+# include <emmintrin.h>
+# define VA_SIMD_WIDTH 2
+#else
+# define VA_SIMD_WIDTH 1
+#endif
 
 // attribute index
 typedef int aidx;
@@ -54,13 +78,132 @@ typedef int integer;
 #define inf std::numeric_limits<double>::infinity()
 #define Inf inf
 
+/*--------------------------------------------------------------------------*/
+// value+gradient kernels. n is a multiple of VA_SIMD_WIDTH.
+// loads and stores are unaligned, allocators need not honour alignas.
+namespace simd {
+#if VA_SIMD_WIDTH == 4
+typedef __m256d vec;
+inline vec load(double const* p) { return _mm256_loadu_pd(p); }
+inline void store(double* p, vec v) { _mm256_storeu_pd(p, v); }
+inline vec set1(double d) { return _mm256_set1_pd(d); }
+inline vec add(vec a, vec b) { return _mm256_add_pd(a, b); }
+inline vec sub(vec a, vec b) { return _mm256_sub_pd(a, b); }
+inline vec mul(vec a, vec b) { return _mm256_mul_pd(a, b); }
+inline vec div(vec a, vec b) { return _mm256_div_pd(a, b); }
+#elif VA_SIMD_WIDTH == 2
+typedef __m128d vec;
+inline vec load(double const* p) { return _mm_loadu_pd(p); }
+inline void store(double* p, vec v) { _mm_storeu_pd(p, v); }
+inline vec set1(double d) { return _mm_set1_pd(d); }
+inline vec add(vec a, vec b) { return _mm_add_pd(a, b); }
+inline vec sub(vec a, vec b) { return _mm_sub_pd(a, b); }
+inline vec mul(vec a, vec b) { return _mm_mul_pd(a, b); }
+inline vec div(vec a, vec b) { return _mm_div_pd(a, b); }
+#else
+typedef double vec;
+inline vec load(double const* p) { return *p; }
+inline void store(double* p, vec v) { *p = v; }
+inline vec set1(double d) { return d; }
+inline vec add(vec a, vec b) { return a + b; }
+inline vec sub(vec a, vec b) { return a - b; }
+inline vec mul(vec a, vec b) { return a * b; }
+inline vec div(vec a, vec b) { return a / b; }
+#endif
+enum { width = VA_SIMD_WIDTH };
+/*--------------------------------------------------------------------------*/
+template<int n>
+inline void copy(double* a, double const* b)
+{
+  for(int i=0; i<n; i+=width){
+    store(a+i, load(b+i));
+  }
+}
+// a += b
+template<int n>
+inline void add(double* a, double const* b)
+{
+  for(int i=0; i<n; i+=width){
+    store(a+i, add(load(a+i), load(b+i)));
+  }
+}
+// a -= b
+template<int n>
+inline void sub(double* a, double const* b)
+{
+  for(int i=0; i<n; i+=width){
+    store(a+i, sub(load(a+i), load(b+i)));
+  }
+}
+// a = -b
+template<int n>
+inline void neg(double* a, double const* b)
+{
+  vec z = set1(0.);
+  for(int i=0; i<n; i+=width){
+    store(a+i, sub(z, load(b+i)));
+  }
+}
+// a *= s
+template<int n>
+inline void scale(double* a, double s)
+{
+  vec v = set1(s);
+  for(int i=0; i<n; i+=width){
+    store(a+i, mul(load(a+i), v));
+  }
+}
+// a /= s
+template<int n>
+inline void rscale(double* a, double s)
+{
+  vec v = set1(s);
+  for(int i=0; i<n; i+=width){
+    store(a+i, div(load(a+i), v));
+  }
+}
+// product rule, a' = a' b + a b'. the value slot is left to the caller.
+template<int n>
+inline void mul_rule(double* a, double const* b)
+{
+  vec a0 = set1(*a);
+  vec b0 = set1(*b);
+  for(int i=0; i<n; i+=width){
+    store(a+i, add(mul(load(a+i), b0), mul(a0, load(b+i))));
+  }
+}
+// quotient rule, a' = (a' b - a b') / b^2. the value slot is left to the caller.
+template<int n>
+inline void div_rule(double* a, double const* b)
+{
+  vec a0 = set1(*a);
+  vec b0 = set1(*b);
+  vec bb = set1(*b * *b);
+  for(int i=0; i<n; i+=width){
+    store(a+i, div(sub(mul(load(a+i), b0), mul(a0, load(b+i))), bb));
+  }
+}
+/*--------------------------------------------------------------------------*/
+} // simd
+/*--------------------------------------------------------------------------*/
+template<int numderiv, int... idx>
+class sddouble_;
+/*--------------------------------------------------------------------------*/
 template<int numderiv>
 class ddouble_ {
+  // value and derivatives, padded to a multiple of the vector width.
+  enum { _n = (numderiv + simd::width) / simd::width * simd::width };
 protected:
-  double _data[1+numderiv];
+  alignas(sizeof(simd::vec)) double _data[_n];
 public:
+  enum { num_deriv = numderiv };
   ddouble_(ddouble_ const& o) {
-    notstd::copy_n(o._data, numderiv+1, _data);
+    simd::copy<_n>(_data, o._data);
+  }
+  template<int... idx>
+  ddouble_(sddouble_<numderiv, idx...> const& o) {
+    clear();
+    o.scatter(_data);
   }
   explicit ddouble_() { clear(); }
   // fixme: implicit conversion in af args..
@@ -80,22 +223,29 @@ private:
 public:
   virtual double const& value()const {return _data[0];}
   double d(int i)const { untested();return _data[i];}
+  double deriv(int i)const {return _data[i+1];}
   double const& operator[](int i)const { untested();return _data[i+1];}
   double& operator[](int i){return _data[i+1];}
   operator double()const { return *_data; }
 #if 1
   ddouble_& operator=(ddouble_ const& o) {
     assert(o == o);
-    notstd::copy_n(o._data, numderiv+1, _data);
+    simd::copy<_n>(_data, o._data);
     return *this;
   }
 #else
   ddouble_& operator=(ddouble_ o) { untested();
     assert(o == o);
-    notstd::copy_n(o._data, numderiv+1, _data);
+    simd::copy<_n>(_data, o._data);
     return *this;
   }
 #endif
+  template<int... idx>
+  ddouble_& operator=(sddouble_<numderiv, idx...> const& o) {
+    clear();
+    o.scatter(_data);
+    return *this;
+  }
   ddouble_& operator=(PARAMETER<double> const& o) {
     assert(o == o);
     *_data = o;
@@ -189,9 +339,7 @@ public:
   }
 
   ddouble_& operator+=(const ddouble_& o) {
-    for(int i=0; i<=numderiv; ++i){
-      _data[i] += o._data[i];
-    }
+    simd::add<_n>(_data, o._data);
     return *this;
   }
   ddouble_ operator+(ddouble_ const& o) const {
@@ -219,9 +367,7 @@ public:
   }
 
   ddouble_& operator-=(const ddouble_& o) {
-    for(int i=0; i<=numderiv; ++i){
-      _data[i] -= o._data[i];
-    }
+    simd::sub<_n>(_data, o._data);
     return *this;
   }
   ddouble_ operator-(ddouble_ const& o) const {
@@ -246,22 +392,16 @@ public:
   }
   ddouble_ operator-() const {
     ddouble_ ret;
-    for(int i=0; i<=numderiv; ++i){
-      ret._data[i] = - _data[i];
-    }
+    simd::neg<_n>(ret._data, _data);
     return ret;
   }
 
   ddouble_& operator*=(const ddouble_& o) {
     assert(*o._data == *o._data);
     assert(*_data == *_data);
-    for(int i=1; i<=numderiv; ++i){
-      // assert(_data[i] == _data[i]);
-      // assert(o._data[i] == o._data[i]);
-      _data[i] *= *o._data;
-      _data[i] += *_data * o._data[i];
-    }
-    *_data *= *o._data;
+    double v = *_data * *o._data;
+    simd::mul_rule<_n>(_data, o._data);
+    *_data = v;
     return *this;
   }
   ddouble_ operator*(const ddouble_& o) const {
@@ -270,9 +410,7 @@ public:
     return ret;
   }
   ddouble_& operator*=(const double& o) {
-    for(int i=0; i<=numderiv; ++i){
-      _data[i] *= o;
-    }
+    simd::scale<_n>(_data, o);
     return *this;
   }
   ddouble_ operator*(const int& o) const { itested();
@@ -294,12 +432,9 @@ public:
 
   ddouble_& operator/=(ddouble_ const& o) {
     if(*o._data){
-      for(int i=1; i<=numderiv; ++i){
-	_data[i] *= o.value();
-	_data[i] -= value() * o._data[i];
-	_data[i] /= o.value() * o.value();
-      }
-      *_data /= *o._data;
+      double v = *_data / *o._data;
+      simd::div_rule<_n>(_data, o._data);
+      *_data = v;
     }else{ itested();
       *this /= (o + 1e-20);
     }
@@ -313,9 +448,7 @@ public:
   ddouble_& operator/=(double const& o) {
     assert(_data);
     assert(o);
-    for(int i=0; i<=numderiv; ++i){
-      _data[i] /= o;
-    }
+    simd::rscale<_n>(_data, o);
     return *this;
   }
   //	ddouble_ operator/(double const& o) { untested();
@@ -354,9 +487,9 @@ public:
   }
 
   ddouble_& chain(double const& d) {
-    for(int i=1; i<=numderiv; ++i){
-      _data[i] *= d;
-    }
+    double v = *_data;
+    simd::scale<_n>(_data, d);
+    *_data = v;
     return *this;
   } /*chain*/
   ddouble_& set_value(double const& v){
@@ -364,7 +497,7 @@ public:
     return *this;
   }
   void clear() {
-    std::fill_n(_data, numderiv+1, 0.);
+    std::fill_n(_data, int(_n), 0.);
   } /*clear*/
 }; /*ddouble_*/
 /*--------------------------------------------------------------------------*/
@@ -506,7 +639,351 @@ inline bool operator==(PARAMETER<double> const& b, int const& a)
 // { untested();
 // 	return int(b) == a;
 // }
+/*--------------------------------------------------------------------------*/
+// position of derivative i within idx..., -1 if not there
+template<int... idx>
+struct sdd_slot {
+  static constexpr int find(int, int=0) { return -1; }
+};
+template<int h, int... t>
+struct sdd_slot<h, t...> {
+  static constexpr int find(int i, int k=0) {
+    return h==i ? k : sdd_slot<t...>::find(i, k+1);
+  }
+};
+/*--------------------------------------------------------------------------*/
+// ddouble_ restricted to the derivatives listed in idx.
+// the others are zero and not stored.
+template<int numderiv, int... idx>
+class sddouble_ {
+  typedef sdd_slot<idx...> slot;
+  enum { _k = sizeof...(idx) };
+  double _data[1+_k];
+public:
+  enum { num_deriv = numderiv };
+  sddouble_(sddouble_ const& o) {
+    notstd::copy_n(o._data, int(_k)+1, _data);
+  }
+  explicit sddouble_() { clear(); }
+  /*explicit*/ sddouble_(int const& d) { clear(); *_data = d; }
+  /*explicit*/ sddouble_(double const& d) { clear(); *_data = d; }
+  /*explicit*/ sddouble_(PARAMETER<double> const& d) { clear(); *_data = d; }
+  sddouble_(ddouble_<numderiv> const& o) { gather(o); }
+  template<int... jdx>
+  sddouble_(sddouble_<numderiv, jdx...> const& o) { gather(o); }
+
+  void set_all_deps() {
+    std::fill_n(_data+1, int(_k), 0.);
+  }
+  void set_no_deps() {
+    std::fill_n(_data+1, int(_k), std::numeric_limits<double>::quiet_NaN());
+  }
+public:
+  double const& value()const {return _data[0];}
+  double deriv(int i)const {
+    int s = slot::find(i);
+    return s<0 ? 0. : _data[s+1];
+  }
+  double operator[](int i)const {return deriv(i);}
+  double& operator[](int i){
+    int s = slot::find(i);
+    if(s<0){ untested();
+      // not in idx. the deps are incomplete, and the write would be lost.
+      unreachable();
+      std::abort();
+    }else{
+      return _data[s+1];
+    }
+  }
+  operator double()const { return *_data; }
+  void scatter(double* d)const {
+    int const x[] = {-1, idx...};
+    *d = *_data;
+    for(int k=1; k<=_k; ++k){
+      d[x[k]+1] = _data[k];
+    }
+  }
+private:
+  template<class T>
+  void gather(T const& o) {
+    int const x[] = {-1, idx...};
+    *_data = o.value();
+    for(int k=1; k<=_k; ++k){
+      _data[k] = o.deriv(x[k]);
+    }
+  }
+public:
+  sddouble_& operator=(sddouble_ const& o) {
+    assert(o == o);
+    notstd::copy_n(o._data, int(_k)+1, _data);
+    return *this;
+  }
+  sddouble_& operator=(ddouble_<numderiv> const& o) {
+    gather(o);
+    return *this;
+  }
+  template<int... jdx>
+  sddouble_& operator=(sddouble_<numderiv, jdx...> const& o) {
+    gather(o);
+    return *this;
+  }
+  sddouble_& operator=(PARAMETER<double> const& o) {
+    assert(o == o);
+    *_data = o;
+    set_all_deps();
+    return *this;
+  }
+  sddouble_& operator=(const double& o) {
+    assert(o == o);
+    *_data = o;
+    set_all_deps();
+    return *this;
+  }
 
+  sddouble_& operator+=(sddouble_ const& o) {
+    for(int i=0; i<=_k; ++i){
+      _data[i] += o._data[i];
+    }
+    return *this;
+  }
+  sddouble_& operator-=(sddouble_ const& o) {
+    for(int i=0; i<=_k; ++i){
+      _data[i] -= o._data[i];
+    }
+    return *this;
+  }
+  sddouble_& operator*=(sddouble_ const& o) {
+    assert(*o._data == *o._data);
+    assert(*_data == *_data);
+    for(int i=1; i<=_k; ++i){
+      _data[i] *= *o._data;
+      _data[i] += *_data * o._data[i];
+    }
+    *_data *= *o._data;
+    return *this;
+  }
+  sddouble_& operator/=(sddouble_ const& o) {
+    if(*o._data){
+      for(int i=1; i<=_k; ++i){
+	_data[i] *= *o._data;
+	_data[i] -= *_data * o._data[i];
+	_data[i] /= *o._data * *o._data;
+      }
+      *_data /= *o._data;
+    }else{ untested();
+      *this /= (o + 1e-20);
+    }
+    return *this;
+  }
+  sddouble_& operator+=(double const& o) {
+    *_data += o;
+    return *this;
+  }
+  sddouble_& operator-=(double const& o) {
+    *_data -= o;
+    return *this;
+  }
+  sddouble_& operator*=(double const& o) {
+    for(int i=0; i<=_k; ++i){
+      _data[i] *= o;
+    }
+    return *this;
+  }
+  sddouble_& operator/=(double const& o) {
+    assert(o);
+    for(int i=0; i<=_k; ++i){
+      _data[i] /= o;
+    }
+    return *this;
+  }
+  sddouble_ operator+()const {
+    return *this;
+  }
+  sddouble_ operator-()const {
+    sddouble_ ret;
+    for(int i=0; i<=_k; ++i){
+      ret._data[i] = - _data[i];
+    }
+    return ret;
+  }
+  bool operator!()const {
+    return *_data == 0.;
+  }
+
+  sddouble_& chain(double const& d) {
+    for(int i=1; i<=_k; ++i){
+      _data[i] *= d;
+    }
+    return *this;
+  } /*chain*/
+  sddouble_& set_value(double const& v){
+    *_data = v;
+    return *this;
+  }
+  void clear() {
+    std::fill_n(_data, int(_k)+1, 0.);
+  } /*clear*/
+}; /*sddouble_*/
+/*--------------------------------------------------------------------------*/
+// sparse op sparse, sparse op other, other op sparse. anything other than
+// a ddouble_ or sddouble_ enters as a constant.
+template<int N, int... I>
+sddouble_<N, I...> operator+(sddouble_<N, I...> a, sddouble_<N, I...> const& b)
+{
+  return a += b;
+}
+template<int N, int... I, class T>
+sddouble_<N, I...> operator+(sddouble_<N, I...> a, T const& b)
+{
+  return a += sddouble_<N, I...>(b);
+}
+template<int N, int... I, class T>
+sddouble_<N, I...> operator+(T const& a, sddouble_<N, I...> const& b)
+{
+  sddouble_<N, I...> c(a);
+  return c += b;
+}
+template<int N, int... I>
+sddouble_<N, I...> operator-(sddouble_<N, I...> a, sddouble_<N, I...> const& b)
+{
+  return a -= b;
+}
+template<int N, int... I, class T>
+sddouble_<N, I...> operator-(sddouble_<N, I...> a, T const& b)
+{
+  return a -= sddouble_<N, I...>(b);
+}
+template<int N, int... I, class T>
+sddouble_<N, I...> operator-(T const& a, sddouble_<N, I...> const& b)
+{
+  sddouble_<N, I...> c(a);
+  return c -= b;
+}
+template<int N, int... I>
+sddouble_<N, I...> operator*(sddouble_<N, I...> a, sddouble_<N, I...> const& b)
+{
+  return a *= b;
+}
+template<int N, int... I, class T>
+sddouble_<N, I...> operator*(sddouble_<N, I...> a, T const& b)
+{
+  return a *= sddouble_<N, I...>(b);
+}
+template<int N, int... I, class T>
+sddouble_<N, I...> operator*(T const& a, sddouble_<N, I...> const& b)
+{
+  sddouble_<N, I...> c(a);
+  return c *= b;
+}
+template<int N, int... I>
+sddouble_<N, I...> operator/(sddouble_<N, I...> a, sddouble_<N, I...> const& b)
+{
+  return a /= b;
+}
+template<int N, int... I, class T>
+sddouble_<N, I...> operator/(sddouble_<N, I...> a, T const& b)
+{
+  return a /= sddouble_<N, I...>(b);
+}
+template<int N, int... I, class T>
+sddouble_<N, I...> operator/(T const& a, sddouble_<N, I...> const& b)
+{
+  sddouble_<N, I...> c(a);
+  return c /= b;
+}
+/*--------------------------------------------------------------------------*/
+// comparison only looks at values.
+template<int N, int... I>
+bool operator==(sddouble_<N, I...> const& a, sddouble_<N, I...> const& b)
+{
+  return a.value() == b.value();
+}
+template<int N, int... I, class T>
+bool operator==(sddouble_<N, I...> const& a, T const& b)
+{
+  return a.value() == double(b);
+}
+template<int N, int... I, class T>
+bool operator==(T const& a, sddouble_<N, I...> const& b)
+{
+  return double(a) == b.value();
+}
+template<int N, int... I>
+bool operator!=(sddouble_<N, I...> const& a, sddouble_<N, I...> const& b)
+{
+  return a.value() != b.value();
+}
+template<int N, int... I, class T>
+bool operator!=(sddouble_<N, I...> const& a, T const& b)
+{
+  return a.value() != double(b);
+}
+template<int N, int... I, class T>
+bool operator!=(T const& a, sddouble_<N, I...> const& b)
+{
+  return double(a) != b.value();
+}
+template<int N, int... I>
+bool operator<(sddouble_<N, I...> const& a, sddouble_<N, I...> const& b)
+{
+  return a.value() < b.value();
+}
+template<int N, int... I, class T>
+bool operator<(sddouble_<N, I...> const& a, T const& b)
+{
+  return a.value() < double(b);
+}
+template<int N, int... I, class T>
+bool operator<(T const& a, sddouble_<N, I...> const& b)
+{
+  return double(a) < b.value();
+}
+template<int N, int... I>
+bool operator<=(sddouble_<N, I...> const& a, sddouble_<N, I...> const& b)
+{
+  return a.value() <= b.value();
+}
+template<int N, int... I, class T>
+bool operator<=(sddouble_<N, I...> const& a, T const& b)
+{
+  return a.value() <= double(b);
+}
+template<int N, int... I, class T>
+bool operator<=(T const& a, sddouble_<N, I...> const& b)
+{
+  return double(a) <= b.value();
+}
+template<int N, int... I>
+bool operator>(sddouble_<N, I...> const& a, sddouble_<N, I...> const& b)
+{
+  return a.value() > b.value();
+}
+template<int N, int... I, class T>
+bool operator>(sddouble_<N, I...> const& a, T const& b)
+{
+  return a.value() > double(b);
+}
+template<int N, int... I, class T>
+bool operator>(T const& a, sddouble_<N, I...> const& b)
+{
+  return double(a) > b.value();
+}
+template<int N, int... I>
+bool operator>=(sddouble_<N, I...> const& a, sddouble_<N, I...> const& b)
+{
+  return a.value() >= b.value();
+}
+template<int N, int... I, class T>
+bool operator>=(sddouble_<N, I...> const& a, T const& b)
+{
+  return a.value() >= double(b);
+}
+template<int N, int... I, class T>
+bool operator>=(T const& a, sddouble_<N, I...> const& b)
+{
+  return double(a) >= b.value();
+}
+/*--------------------------------------------------------------------------*/
 template<class T>
 T& set_value(T& t, double const& d)
 {
@@ -696,20 +1173,6 @@ typename ddouble_if<T, S>::type min(T d, S e)
   }
 }
 /*--------------------------------------------------------------------------*/
-template<class T, class S=T>
-T white_noise(T, S=0.)
-{ itested();
-  //incomplete();
-  return T(0.);
-}
-
-template<class T, class T2, class S=T>
-T flicker_noise(T, T2, S=0.)
-{ itested();
-  //incomplete();
-  return T(0.);
-}
-/*--------------------------------------------------------------------------*/
 class EVT{
 public:
   virtual void operator()() const = 0;
@@ -743,6 +1206,680 @@ inline double PORT_FLOW(int i, BASE_SUBCKT const* m)
   return I;
 }
 /*--------------------------------------------------------------------------*/
+// elements touching each port, with orientation. built once per expand,
+// then a port flow costs about as much as a branch flow.
+class PORT_FLOW_TABLE {
+  std::vector<ELEMENT const*> _e;
+  std::vector<double> _sign;
+  std::vector<size_t> _begin; // per port, one extra at the end
+  mutable std::vector<double> _last; // as returned by flow, optimize-bypass
+  mutable std::vector<bool> _read;
+public:
+  bool empty()const {return _begin.empty();}
+  void clear() {
+    _e.clear();
+    _sign.clear();
+    _begin.clear();
+    _last.clear();
+    _read.clear();
+  }
+  void build(BASE_SUBCKT const* m) {
+    clear();
+    assert(m->subckt());
+    for(int i=0; i<m->net_nodes(); ++i){
+      _begin.push_back(_e.size());
+      node_t n = m->n_(i);
+      for(CARD const* c : *m->subckt()){
+	auto e = dynamic_cast<ELEMENT const*>(c);
+	if(!e){ untested();
+	}else if(e->n_(1) == e->n_(0)){ untested();
+	}else if(e->n_(0) == n){
+	  _e.push_back(e);
+	  _sign.push_back(1.);
+	}else if(e->n_(1) == n){
+	  _e.push_back(e);
+	  _sign.push_back(-1.);
+	}else{ untested();
+	}
+      }
+    }
+    _begin.push_back(_e.size());
+    _last.assign(_begin.size() - 1, 0.);
+    _read.assign(_begin.size() - 1, false);
+  }
+  double flow(int i, BASE_SUBCKT const* m)const {
+    if(size_t(i) + 1 < _begin.size()){
+      double I = sum(size_t(i));
+      _last[size_t(i)] = I;
+      _read[size_t(i)] = true;
+      return I;
+    }else{ untested();
+      return PORT_FLOW(i, m);
+    }
+  }
+  // has any port flow read since the last build moved beyond tolerance?
+  bool moved()const {
+    if(empty()){
+      return true;
+    }else{
+      for(size_t i=0; i+1<_begin.size(); ++i){
+	if(!_read[i]){
+	}else if(!conchk(_last[i], sum(i))){
+	  return true;
+	}else{
+	}
+      }
+      return false;
+    }
+  }
+private:
+  double sum(size_t i)const {
+    double I(0.);
+    for(size_t k=_begin[i]; k<_begin[i+1]; ++k){
+      I += _sign[k] * _e[k]->tr_amps();
+    }
+    return I;
+  }
+};
+/*--------------------------------------------------------------------------*/
+// time spent per model type, gen-profile.
+enum PROF_ID {PROF_EVAL, PROF_PROBES, PROF_NEEDS_EVAL, PROF_REVIEW,
+              PROF_ACCEPT, PROF_PRECALC, PROF_N};
+/*--------------------------------------------------------------------------*/
+class PROF_ENTRY {
+  std::atomic<unsigned long long> _ns{0};
+  std::atomic<unsigned long long> _calls{0};
+public:
+  void add(unsigned long long ns) {
+    _ns.fetch_add(ns, std::memory_order_relaxed);
+    _calls.fetch_add(1, std::memory_order_relaxed);
+  }
+  double ns()const {return double(_ns.load(std::memory_order_relaxed));}
+  double calls()const {return double(_calls.load(std::memory_order_relaxed));}
+  void clear() {
+    _ns = 0;
+    _calls = 0;
+  }
+};
+/*--------------------------------------------------------------------------*/
+class PROFILE {
+  PROF_ENTRY _e[PROF_N];
+public:
+  PROF_ENTRY& operator[](int i) {assert(i < PROF_N); return _e[i];}
+  PROF_ENTRY const& operator[](int i)const {assert(i < PROF_N); return _e[i];}
+  void clear() {
+    for(auto& e : _e){
+      e.clear();
+    }
+  }
+};
+/*--------------------------------------------------------------------------*/
+// adds its lifetime to an entry.
+class PROF_SCOPE {
+  PROF_ENTRY& _e;
+  std::chrono::steady_clock::time_point _t0;
+public:
+  explicit PROF_SCOPE(PROF_ENTRY& e)
+    : _e(e), _t0(std::chrono::steady_clock::now()) {}
+  ~PROF_SCOPE() {
+    auto d = std::chrono::steady_clock::now() - _t0;
+    _e.add((unsigned long long)
+	std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+  }
+};
+/*--------------------------------------------------------------------------*/
+// tr_needs_eval outcomes per model type, optimize-bypass.
+class BYPASS_COUNT {
+  unsigned long long _hits{0};
+  unsigned long long _evals{0};
+public:
+  bool operator()(bool eval) {
+    if(eval){
+      ++_evals;
+    }else{
+      ++_hits;
+    }
+    return eval;
+  }
+  double hits()const {return double(_hits);}
+  double evals()const {return double(_evals);}
+  double rate()const {
+    return (_hits + _evals) ? double(_hits) / double(_hits + _evals) : 0.;
+  }
+  void clear() {
+    _hits = 0;
+    _evals = 0;
+  }
+};
+/*--------------------------------------------------------------------------*/
+// $table_model. the tables are kept per plugin, and go when it is
+// unloaded. the names below are local to the plugin for that.
+namespace {
+/*--------------------------------------------------------------------------*/
+// gridded data, one table per file, control string and number of inputs,
+// shared by all instances. the interpolant is a tensor product of one
+// basis per input, linear or cubic spline. spline slopes are computed at
+// load time, an evaluation reads the cell around the input.
+class TABLE_MODEL {
+public:
+  enum { MAX_DIM = 3 };
+  enum error_t {tm_ok = 0, tm_open, tm_control, tm_data, tm_range};
+private:
+  struct BASIS {
+    size_t i;        // lower node
+    double w[2][2];  // weights, [node][value, slope]
+    double dw[2][2]; // .. derivative by the input
+  };
+  std::string _file;
+  std::string _ctrl;
+  int _dim;
+  error_t _err{tm_ok};
+  int _deg[MAX_DIM];  // 0 closest point, 1 linear, 3 cubic
+  char _lo[MAX_DIM];  // extrapolation, C, L or E
+  char _hi[MAX_DIM];
+  std::vector<double> _x[MAX_DIM];
+  size_t _stride[MAX_DIM];
+  // values at mask 0, slopes along k at mask 1<<k, cross slopes.
+  std::vector<double> _f[1 << MAX_DIM];
+private:
+  explicit TABLE_MODEL(std::string const& file, std::string const& ctrl, int dim)
+    : _file(file), _ctrl(ctrl), _dim(dim) {
+    for(int k=0; k<MAX_DIM; ++k){
+      _deg[k] = 1;
+      _lo[k] = _hi[k] = 'L';
+      _stride[k] = 0;
+    }
+  }
+public:
+  // the table for file, ctrl and dim, loaded by the first caller.
+  static TABLE_MODEL const* find(std::string const& file,
+                                 std::string const& ctrl, int dim) {
+    static std::mutex lock;
+    static std::map<std::string, std::unique_ptr<TABLE_MODEL>> tables;
+    assert(0 < dim && dim <= MAX_DIM);
+    std::string key = file;
+    key += char(0);
+    key += ctrl;
+    key += char('0' + dim);
+    std::lock_guard<std::mutex> g(lock);
+    std::unique_ptr<TABLE_MODEL>& t = tables[key];
+    if(!t){
+      t.reset(new TABLE_MODEL(file, ctrl, dim));
+      t->load();
+    }else{
+    }
+    return t.get();
+  }
+  bool is(std::string const& file, std::string const& ctrl, int dim)const {
+    return dim == _dim && file == _file && ctrl == _ctrl;
+  }
+  error_t error()const {return _err;}
+  std::string const& file()const {return _file;}
+public:
+  // the interval around q in dimension k, starting from i.
+  size_t hunt(int k, double q, size_t i)const {
+    std::vector<double> const& x = _x[k];
+    size_t n = x.size();
+    if(n < 2){
+      return 0;
+    }else if(i > n - 2){
+      i = n - 2;
+    }else{
+    }
+    size_t lo;
+    size_t hi;
+    if(q < x[i]){
+      hi = i;
+      for(size_t step=1; ; step*=2){
+	if(hi <= step){
+	  lo = 0;
+	  break;
+	}else if(x[hi - step] <= q){
+	  lo = hi - step;
+	  break;
+	}else{
+	  hi -= step;
+	}
+      }
+    }else if(q < x[i + 1]){
+      return i;
+    }else{
+      lo = i + 1;
+      for(size_t step=1; ; step*=2){
+	if(lo + step >= n - 1){
+	  hi = n - 1;
+	  break;
+	}else if(q < x[lo + step]){
+	  hi = lo + step;
+	  break;
+	}else{
+	  lo += step;
+	}
+      }
+    }
+    size_t j = size_t(std::upper_bound(x.begin() + lo, x.begin() + hi, q) - x.begin());
+    if(j){
+      --j;
+    }else{
+    }
+    return std::min(j, n - 2);
+  }
+  // value at q, gradient in g. i holds one interval per input, as found
+  // by the last call. sets range if extrapolation is an error.
+  double eval(double const* q, size_t* i, double* g, bool* range)const {
+    assert(!_err);
+    BASIS b[MAX_DIM];
+    for(int k=0; k<_dim; ++k){
+      i[k] = hunt(k, q[k], i[k]);
+      basis(k, q[k], i[k], &b[k], range);
+      g[k] = 0.;
+    }
+    double v = 0.;
+    for(int c=0; c < (1 << (2 * _dim)); ++c){
+      size_t idx = 0;
+      int mask = 0;
+      double p = 1.;
+      double dp[MAX_DIM];
+      bool skip = false;
+      for(int k=0; k<_dim; ++k){
+	int node = (c >> (2 * k)) & 1;
+	int ord = (c >> (2 * k + 1)) & 1;
+	double w = b[k].w[node][ord];
+	double dw = b[k].dw[node][ord];
+	if(w == 0. && dw == 0.){
+	  skip = true;
+	  break;
+	}else{
+	}
+	idx += (b[k].i + size_t(node)) * _stride[k];
+	mask |= ord << k;
+	for(int j=0; j<k; ++j){
+	  dp[j] *= w;
+	}
+	dp[k] = p * dw;
+	p *= w;
+      }
+      if(skip){
+	continue;
+      }else{
+      }
+      assert(idx < _f[mask].size());
+      double f = _f[mask][idx];
+      v += p * f;
+      for(int k=0; k<_dim; ++k){
+	g[k] += dp[k] * f;
+      }
+    }
+    return v;
+  }
+private:
+  void basis(int k, double q, size_t i, BASIS* b, bool* range)const {
+    std::vector<double> const& x = _x[k];
+    size_t n = x.size();
+    std::fill_n(&b->w[0][0], 4, 0.);
+    std::fill_n(&b->dw[0][0], 4, 0.);
+    b->i = i;
+    if(n < 2){
+      b->w[0][0] = 1.;
+      return;
+    }else{
+    }
+    double h = x[i + 1] - x[i];
+    double t = (q - x[i]) / h;
+    bool out = q < x[0] || x[n - 1] < q;
+    int j = q < x[0] ? 0 : 1; // the node at the end, if out
+    char e = q < x[0] ? _lo[k] : _hi[k];
+    if(!out){
+    }else if(e == 'E'){
+      *range = true;
+    }else{
+    }
+
+    if(out && (e != 'L' || _deg[k] == 0)){
+      b->w[j][0] = 1.;
+    }else if(out && _deg[k] == 3){
+      // along the slope at the end
+      b->w[j][0] = 1.;
+      b->w[j][1] = q - x[j ? n - 1 : 0];
+      b->dw[j][1] = 1.;
+    }else if(_deg[k] == 0){
+      b->w[t < .5 ? 0 : 1][0] = 1.;
+    }else if(_deg[k] == 1){
+      b->w[0][0] = 1. - t;
+      b->w[1][0] = t;
+      b->dw[0][0] = -1. / h;
+      b->dw[1][0] = 1. / h;
+    }else{
+      // cubic hermite, from values and slopes at both nodes
+      double t2 = t * t;
+      double t3 = t2 * t;
+      b->w[0][0] = 2. * t3 - 3. * t2 + 1.;
+      b->w[0][1] = h * (t3 - 2. * t2 + t);
+      b->w[1][0] = -2. * t3 + 3. * t2;
+      b->w[1][1] = h * (t3 - t2);
+      b->dw[0][0] = (6. * t2 - 6. * t) / h;
+      b->dw[0][1] = 3. * t2 - 4. * t + 1.;
+      b->dw[1][0] = (-6. * t2 + 6. * t) / h;
+      b->dw[1][1] = 3. * t2 - 2. * t;
+    }
+  }
+  // comma separated, one entry per column of inputs: I (ignore), D
+  // (closest point), 1, 2 or 3 (degree), then one or two of C, L, E for
+  // the lower and upper end. optionally ; and the dependent column.
+  bool parse_control(std::vector<bool>* use, size_t* dep) {
+    std::string const& c = _ctrl;
+    use->clear();
+    *dep = 1;
+    if(c.empty()){
+      use->assign(size_t(_dim), true);
+      return true;
+    }else{
+    }
+    int k = 0;
+    size_t i = 0;
+    for(;;){
+      int deg = 1;
+      char lo = 'L';
+      char hi = 'L';
+      bool used = true;
+      int n = 0;
+      for(; i < c.size() && c[i] != ',' && c[i] != ';'; ++i){
+	char x = char(std::toupper((unsigned char)c[i]));
+	if(std::isspace((unsigned char)x)){
+	}else if(x == 'I'){
+	  used = false;
+	}else if(x == 'D'){
+	  deg = 0;
+	}else if(x == '1'){
+	  deg = 1;
+	}else if(x == '2' || x == '3'){
+	  // no separate quadratic spline
+	  deg = 3;
+	}else if(x != 'C' && x != 'L' && x != 'E'){
+	  return false;
+	}else if(n == 0){
+	  lo = hi = x;
+	  ++n;
+	}else if(n == 1){
+	  hi = x;
+	  ++n;
+	}else{
+	  return false;
+	}
+      }
+      use->push_back(used);
+      if(!used){
+      }else if(k < _dim){
+	_deg[k] = deg;
+	_lo[k] = lo;
+	_hi[k] = hi;
+	++k;
+      }else{
+	return false;
+      }
+      if(i == c.size()){
+	break;
+      }else if(c[i] == ','){
+	++i;
+      }else{
+	char* e;
+	long d = std::strtol(c.c_str() + i + 1, &e, 10);
+	while(std::isspace((unsigned char)*e)){
+	  ++e;
+	}
+	if(d < 1 || *e){
+	  return false;
+	}else{
+	  *dep = size_t(d);
+	  break;
+	}
+      }
+    }
+    return k == _dim;
+  }
+  void load() {
+    std::vector<bool> use;
+    size_t dep;
+    if(!parse_control(&use, &dep)){
+      _err = tm_control;
+      return;
+    }else{
+    }
+    std::ifstream in(_file.c_str());
+    if(!in){
+      _err = tm_open;
+      return;
+    }else{
+    }
+    size_t ncol = use.size() + dep;
+    std::vector<double> pts; // inputs and value, per point
+    std::vector<double> row;
+    std::string line;
+    while(std::getline(in, line)){
+      row.clear();
+      char const* p = line.c_str();
+      for(;;){
+	while(std::isspace((unsigned char)*p)){
+	  ++p;
+	}
+	if(!*p || *p == '#'){
+	  break;
+	}else{
+	}
+	char* e;
+	double v = std::strtod(p, &e);
+	if(e == p){
+	  _err = tm_data;
+	  return;
+	}else{
+	}
+	row.push_back(v);
+	p = e;
+      }
+      if(row.empty()){
+      }else if(row.size() < ncol){
+	_err = tm_data;
+	return;
+      }else{
+	for(size_t j=0; j<use.size(); ++j){
+	  if(use[j]){
+	    pts.push_back(row[j]);
+	  }else{
+	  }
+	}
+	pts.push_back(row[ncol - 1]);
+      }
+    }
+    if(!make_grid(pts)){
+      _err = tm_data;
+    }else{
+    }
+  }
+  // the points must fill a grid, one value per node.
+  bool make_grid(std::vector<double> const& pts) {
+    size_t w = size_t(_dim) + 1;
+    size_t np = pts.size() / w;
+    if(!np){
+      return false;
+    }else{
+    }
+    size_t N = 1;
+    for(int k=0; k<_dim; ++k){
+      std::vector<double>& x = _x[k];
+      for(size_t p=0; p<np; ++p){
+	x.push_back(pts[p * w + size_t(k)]);
+      }
+      std::sort(x.begin(), x.end());
+      x.erase(std::unique(x.begin(), x.end()), x.end());
+      _stride[k] = N;
+      N *= x.size();
+      if(x.size() < 2){
+	_deg[k] = 0;
+      }else if(x.size() < 3 && _deg[k] == 3){
+	_deg[k] = 1;
+      }else{
+      }
+    }
+    if(N != np){
+      return false;
+    }else{
+    }
+    std::vector<bool> seen(N, false);
+    _f[0].assign(N, 0.);
+    for(size_t p=0; p<np; ++p){
+      size_t idx = 0;
+      for(int k=0; k<_dim; ++k){
+	std::vector<double> const& x = _x[k];
+	size_t j = size_t(std::lower_bound(x.begin(), x.end(), pts[p * w + size_t(k)]) - x.begin());
+	idx += j * _stride[k];
+      }
+      if(seen[idx]){
+	return false;
+      }else{
+	seen[idx] = true;
+	_f[0][idx] = pts[p * w + size_t(_dim)];
+      }
+    }
+    for(int k=0; k<_dim; ++k){
+      if(_deg[k] == 3){
+	for(int m=0; m < (1 << k); ++m){
+	  if(!_f[m].empty()){
+	    make_slopes(k, m);
+	  }else{
+	  }
+	}
+      }else{
+      }
+    }
+    return true;
+  }
+  // slopes of _f[m] along k, natural cubic spline on each grid line.
+  void make_slopes(int k, int m) {
+    std::vector<double> const& x = _x[k];
+    size_t n = x.size();
+    size_t s = _stride[k];
+    std::vector<double> const& f = _f[m];
+    std::vector<double>& d = _f[m | (1 << k)];
+    d.assign(f.size(), 0.);
+    std::vector<double> y(n);
+    std::vector<double> M(n);
+    std::vector<double> u(n);
+    for(size_t b=0; b<f.size(); ++b){
+      if((b / s) % n){
+	continue;
+      }else{
+      }
+      for(size_t j=0; j<n; ++j){
+	y[j] = f[b + j * s];
+      }
+      M[0] = u[0] = 0.;
+      for(size_t j=1; j+1<n; ++j){
+	double sig = (x[j] - x[j-1]) / (x[j+1] - x[j-1]);
+	double p = sig * M[j-1] + 2.;
+	M[j] = (sig - 1.) / p;
+	u[j] = (y[j+1] - y[j]) / (x[j+1] - x[j]) - (y[j] - y[j-1]) / (x[j] - x[j-1]);
+	u[j] = (6. * u[j] / (x[j+1] - x[j-1]) - sig * u[j-1]) / p;
+      }
+      M[n-1] = 0.;
+      for(size_t j=n-1; j--; ){
+	M[j] = M[j] * M[j+1] + u[j];
+      }
+      for(size_t j=0; j+1<n; ++j){
+	double h = x[j+1] - x[j];
+	d[b + j * s] = (y[j+1] - y[j]) / h - h * (2. * M[j] + M[j+1]) / 6.;
+      }
+      double h = x[n-1] - x[n-2];
+      d[b + (n-1) * s] = (y[n-1] - y[n-2]) / h + h * (M[n-2] + 2. * M[n-1]) / 6.;
+    }
+  }
+};
+/*--------------------------------------------------------------------------*/
+// one per call and instance. keeps the last interval per input, a small
+// step between iterations finds its cell in constant time.
+class TABLE_CURSOR {
+  TABLE_MODEL const* _t{NULL};
+  size_t _i[TABLE_MODEL::MAX_DIM]{};
+  TABLE_MODEL::error_t _err{TABLE_MODEL::tm_ok};
+public:
+  TABLE_MODEL::error_t error()const {return _err;}
+  std::string file()const {return _t ? _t->file() : std::string();}
+  double eval(std::string const& file, std::string const& ctrl, int dim,
+              double const* q, double* g) {
+    if(!_t || !_t->is(file, ctrl, dim)){
+      _t = TABLE_MODEL::find(file, ctrl, dim);
+      std::fill_n(_i, int(TABLE_MODEL::MAX_DIM), size_t(0));
+    }else{
+    }
+    _err = _t->error();
+    if(_err){
+      std::fill_n(g, dim, 0.);
+      return 0.;
+    }else{
+      bool range = false;
+      double v = _t->eval(q, _i, g, &range);
+      if(range){
+	_err = TABLE_MODEL::tm_range;
+      }else{
+      }
+      return v;
+    }
+  }
+};
+/*--------------------------------------------------------------------------*/
+} // namespace
+/*--------------------------------------------------------------------------*/
+template<class A>
+A table_model(TABLE_CURSOR& c, A a, std::string const& file,
+              std::string const& ctrl=std::string())
+{
+  double q[1] = {double(a)};
+  double g[1];
+  double v = c.eval(file, ctrl, 1, q, g);
+  ::chain(a, g[0]);
+  ::set_value(a, v);
+  return a;
+}
+/*--------------------------------------------------------------------------*/
+template<class A, class B>
+typename ddouble_if<A, B>::type table_model(TABLE_CURSOR& c, A a, B b,
+    std::string const& file, std::string const& ctrl=std::string())
+{
+  typedef typename ddouble_if<A, B>::type ret_t;
+  double q[2] = {double(a), double(b)};
+  double g[2];
+  double v = c.eval(file, ctrl, 2, q, g);
+  ::chain(a, g[0]);
+  ::chain(b, g[1]);
+  ::set_value(a, v);
+  ::set_value(b, 0.);
+  ret_t ret(a);
+  ret += ret_t(b);
+  return ret;
+}
+/*--------------------------------------------------------------------------*/
+template<class A, class B, class C>
+typename ddouble_if<A, typename ddouble_if<B, C>::type>::type
+table_model(TABLE_CURSOR& c, A a, B b, C d,
+    std::string const& file, std::string const& ctrl=std::string())
+{
+  typedef typename ddouble_if<B, C>::type bc_t;
+  typedef typename ddouble_if<A, bc_t>::type ret_t;
+  double q[3] = {double(a), double(b), double(d)};
+  double g[3];
+  double v = c.eval(file, ctrl, 3, q, g);
+  ::chain(a, g[0]);
+  ::chain(b, g[1]);
+  ::chain(d, g[2]);
+  ::set_value(a, v);
+  ::set_value(b, 0.);
+  ::set_value(d, 0.);
+  bc_t bc(b);
+  bc += bc_t(d);
+  ret_t ret(a);
+  ret += ret_t(bc);
+  return ret;
+}
+/*--------------------------------------------------------------------------*/
 }
 /*--------------------------------------------------------------------------*/
 /*--------------------------------------------------------------------------*/
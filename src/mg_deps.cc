@@ -141,15 +141,48 @@ void TData::clear()
   assert(!_ddeps.size());
 }
 /*--------------------------------------------------------------------------*/
+// scan short lists, index long ones. expressions with many probes, and
+// blocks with many statements, merge into long lists.
+static const size_t ddeps_index_size = 16;
+/*--------------------------------------------------------------------------*/
+void DDeps::index(size_t i)
+{
+  assert(i < _s.size());
+  assert(*_s[i]);
+  _index.emplace(_s[i]->branch(), i);
+}
+/*--------------------------------------------------------------------------*/
 std::pair<DDeps::const_iterator, bool> DDeps::insert(Dep const& x)
 {
-  for(auto s = begin(); s!=end(); ++s){
-    if (s->same_data(x)){
-      return std::make_pair(s, false);
+  if(_s.size() < ddeps_index_size){
+    for(auto s = begin(); s!=end(); ++s){
+      if (s->same_data(x)){
+	return std::make_pair(s, false);
+      }else{
+      }
+    }
+  }else{
+    if(_index.empty()){
+      for(size_t i = 0; i < _s.size(); ++i){
+	index(i);
+      }
     }else{
     }
+    assert(_index.size() == _s.size());
+    assert(*x);
+    auto r = _index.equal_range(x->branch());
+    for(auto i = r.first; i != r.second; ++i){
+      if (_s[i->second].same_data(x)){
+	return std::make_pair(begin() + int(i->second), false);
+      }else{
+      }
+    }
   }
   _s.push_back(x);
+  if(_index.empty()){
+  }else{
+    index(_s.size() - 1);
+  }
   return std::make_pair(begin()+(int(size())-1), true);
 }
 /*--------------------------------------------------------------------------*/
@@ -25,6 +25,7 @@
 #define MG_DEPS_H
 #include <m_base.h>
 #include "mg_lib.h"
+#include <unordered_map>
 /*--------------------------------------------------------------------------*/
 class RDeps;
 class Probe;
@@ -92,12 +93,24 @@ public:
   }
 };
 /*--------------------------------------------------------------------------*/
+class Branch;
 class DDeps {
   typedef std::vector<Dep> D;
   D _s;
+  // positions in _s by branch, for insert. built once _s is long enough,
+  // not copied.
+  std::unordered_multimap<Branch const*, size_t> _index;
 public:
   typedef D::const_iterator const_iterator;
 
+  explicit DDeps() {}
+  DDeps(DDeps const& o) : _s(o._s) {}
+  DDeps& operator=(DDeps const& o) {
+    _s = o._s;
+    _index.clear();
+    return *this;
+  }
+
   const_iterator begin() const;
   const_iterator end() const;
   size_t size() const{
@@ -114,6 +127,7 @@ public:
   }
   void clear(){
     _s.clear();
+    _index.clear();
   }
   void set_any() {
     for(auto& d: _s) {
@@ -121,6 +135,8 @@ public:
     }
   }
   std::pair<DDeps::const_iterator, bool> insert(Dep const&);
+private:
+  void index(size_t i);
 }; // DDeps
 /*--------------------------------------------------------------------------*/
 // use ValueRange from mg_.h?
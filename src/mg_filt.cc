@@ -80,6 +80,16 @@ protected:
   std::string code_name()const override{
     return "/*XDT*/ d->" + _code_name;
   }
+  // the output element is evaluated along with the module.
+  std::string needs_eval_cond()const override{
+    if(_output || !has_refs()){
+      return "";
+    }else{
+      assert(_br);
+      std::string cn = _br->code_name();
+      return "(" + cn + " && !conchk(_potential" + cn + ", " + cn + "->tr_amps()))";
+    }
+  }
 public:
   Token* new_token(Module& m, size_t na)const override {
     assert(na != size_t(-1));
@@ -100,6 +100,16 @@ protected:
   std::string code_name()const override{
     return "/*LAP*/ d->" + _code_name;
   }
+  // the output element is evaluated along with the module.
+  std::string needs_eval_cond()const override{
+    if(_output){
+      return "";
+    }else{
+      assert(_br);
+      std::string cn = _br->code_name();
+      return "(" + cn + " && !conchk(_potential" + cn + ", " + cn + "->tr_amps()))";
+    }
+  }
 public:
   void set_n_to_gnd()const {
     assert(_m);
@@ -62,6 +62,15 @@ public: // characteristics
   virtual bool has_tr_advance()const{return false;}
   virtual bool has_tr_regress()const{return has_tr_advance();}
   virtual bool has_set_event()const {return false;}
+  // tr_eval code touches instance data only, may run concurrently.
+  // opt in, after checking the emitted code.
+  virtual bool is_reentrant()const  {return false;}
+  // the result depends on the arguments only, no side effects
+  virtual bool is_pure()const       {return false;}
+  // the result does not change after precalc_last, given the arguments
+  virtual bool is_fixed()const      {return is_pure();}
+  // .. and is computed by the instance, see make_cc_dev
+  virtual bool is_fixed_dev()const  {return false;}
 
   virtual bool static_code()const {return false;}
   virtual bool is_common()const {return false;}
@@ -75,6 +84,10 @@ public: // code generation
   virtual void make_cc_tr_advance(std::ostream&)const {}
   virtual void make_cc_tr_review(std::ostream&)const {}
   virtual void make_cc_tr_accept(std::ostream&)const {}
+  virtual void make_cc_expand(std::ostream&)const {}
+  // tr_needs_eval, optimize-bypass. true if the value read during the last
+  // evaluation may have changed. empty: nothing to check
+  virtual std::string needs_eval_cond()const {return "";}
 
   virtual Token* new_token(Module&, size_t)const { untested();unreachable(); return NULL;}
   virtual std::string code_name()const { itested();
@@ -130,7 +143,12 @@ public:
 	  return "filt";
   }
   bool has_precalc()const override { return true;}
+  bool is_reentrant()const override { return false;}
   bool is_standalone()const { return _output; }
+  // the output element is updated once per step, in tr_advance.
+  std::string needs_eval_cond()const override {
+    return "_sim->is_first_iteration()";
+  }
 private:
   virtual Branch* branch() const {return NULL;}
   void setup(Module*)override;
@@ -147,6 +165,7 @@ class MGVAMS_TASK : public FUNCTION_ {
   }
 public:
   ~MGVAMS_TASK() {}
+  bool is_reentrant()const override { return false;}
   virtual MGVAMS_TASK* clone()const { untested();
 	  unreachable();
 	  return NULL;
@@ -70,13 +70,24 @@ private:
     return "d->PORT_FLOW";
   }
   void make_cc_dev(std::ostream& o)const override {
+    o__ "va::PORT_FLOW_TABLE _port_flow;\n";
     o__ "double PORT_FLOW(int i){\n";
-	 o____ "return va::PORT_FLOW(i, this);\n";
+	 o____ "if(_port_flow.empty()){\n";
+	 o______ "_port_flow.build(this);\n";
+	 o____ "}else{\n";
+	 o____ "}\n";
+	 o____ "return _port_flow.flow(i, this);\n";
 	 o__ "}\n";
     o__ "double PORT_FLOW__precalc(int)const {\n";
 	 o____ "return 0.;\n";
 	 o__ "}\n";
   }
+  void make_cc_expand(std::ostream& o)const override {
+    o__ "_port_flow.clear();\n";
+  }
+  std::string needs_eval_cond()const override {
+    return "_port_flow.moved()";
+  }
 #if 0
   void make_cc_common(std::ostream& o)const override { untested();
 //    o__ "double " << code_name() << "(int i, BASE_SUBCKT const* c)const {\n";
@@ -38,6 +38,7 @@ public:
   }
   ~PORT_CONNECTED(){ }
 private:
+  bool is_reentrant()const override {return true;}
   bool static_code()const override {return false;}
   Token* new_token(Module& m, size_t)const override {
     m.install(this);
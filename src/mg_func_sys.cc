@@ -43,6 +43,7 @@ public:
     return "_f_analysis";
   }
   bool static_code()const override {return false;}
+  bool is_reentrant()const override {return true;}
   Token* new_token(Module& m, size_t)const override {
     m.set_analysis();
     m.install(this);
@@ -75,6 +76,7 @@ public:
     set_label("mfactor");
   }
 private:
+  bool is_reentrant()const override {return true;}
   std::string eval(CS&, const CARD_LIST*)const override{ untested();
     unreachable(); // SFCALL won't eval
     return "$$mfactor";
@@ -87,6 +89,8 @@ private:
   std::string code_name()const override{
     return "d->_f_mfactor";
   }
+  bool is_fixed()const override {return true;}
+  bool is_fixed_dev()const override {return true;}
   void make_cc_impl(std::ostream&)const override {
     assert(_m);
     // o << "double " << "PRECALC_" << _m->identifier() << "::_f_mfactor()const {\n";
@@ -111,7 +115,9 @@ public:
   }
   ~TEMPERATURE(){ }
 private:
+  bool is_reentrant()const override {return true;}
   bool static_code()const override {return true;}
+  // not fixed. an analysis may set another temperature without precalc.
   std::string eval(CS&, const CARD_LIST*)const override{ unreachable();
     return "$$temperature";
   }
@@ -139,6 +145,7 @@ public:
     }
   }
 private:
+  bool is_reentrant()const override {return true;}
   std::string eval(CS&, const CARD_LIST*)const override{ untested();
     unreachable(); // SFCALL won't eval
     return "$$vt";
@@ -245,6 +252,7 @@ public:
   }
   ~PARAM_GIVEN(){ }
 private:
+  bool is_reentrant()const override {return true;}
   bool static_code()const override {return false;}
   Token* new_token(Module& m, size_t)const override {
     m.install(this);
@@ -267,6 +275,60 @@ private:
 } pg;
 DISPATCHER<FUNCTION>::INSTALL d_pg(&function_dispatcher, "$param_given", &pg);
 /*--------------------------------------------------------------------------*/
+static int n_tables;
+// $table_model(x1[, x2[, x3]], file[, control]). the table is shared, see
+// va::TABLE_MODEL. each call has a cursor in the instance.
+class TABLE_MODEL : public FUNCTION_ {
+  std::string _code_name;
+public:
+  explicit TABLE_MODEL() : FUNCTION_() {
+    set_label("$table_model");
+  }
+  ~TABLE_MODEL(){ }
+private:
+  bool static_code()const override {return false;}
+  std::string eval(CS&, const CARD_LIST*)const override{ untested();
+    unreachable();
+    return "$$table_model";
+  }
+  Token* new_token(Module& m, size_t na)const override {
+    if(na < 2 || na > 5){ untested();
+      throw Exception("syntax error, need 2 to 5 args");
+    }else{
+    }
+    TABLE_MODEL* cl = new TABLE_MODEL(*this);
+    cl->_code_name = "_table_model_" + std::to_string(n_tables++);
+    cl->set_num_args(na);
+    m.push_back(cl);
+    return new Token_CALL(label(), cl);
+  }
+  std::string code_name()const override{
+    return "d->_f" + _code_name;
+  }
+  void make_cc_dev(std::ostream& o)const override {
+    o__ "mutable va::TABLE_CURSOR " << _code_name << ";\n";
+    o__ "template<class... A>\n";
+    o__ "auto _f" << _code_name << "(A... a)const\n";
+    o____ "-> decltype(va::table_model(" << _code_name << ", a...)) {\n";
+    o____ "auto r = va::table_model(" << _code_name << ", a...);\n";
+    o____ "switch(" << _code_name << ".error()){\n";
+    o____ "case va::TABLE_MODEL::tm_ok:\n";
+    o______ "break;\n";
+    o____ "case va::TABLE_MODEL::tm_open:\n";
+    o______ "throw Exception(\"$table_model: cannot open \" + " << _code_name << ".file());\n";
+    o____ "case va::TABLE_MODEL::tm_control:\n";
+    o______ "throw Exception(\"$table_model: \" + " << _code_name << ".file() + \": invalid control string\");\n";
+    o____ "case va::TABLE_MODEL::tm_data:\n";
+    o______ "throw Exception(\"$table_model: \" + " << _code_name << ".file() + \": not a grid\");\n";
+    o____ "case va::TABLE_MODEL::tm_range:\n";
+    o______ "throw Exception(\"$table_model: \" + " << _code_name << ".file() + \": input out of range\");\n";
+    o____ "}\n";
+    o____ "return r;\n";
+    o__ "}\n";
+  }
+} table_model;
+DISPATCHER<FUNCTION>::INSTALL d_table_model(&function_dispatcher, "$table_model", &table_model);
+/*--------------------------------------------------------------------------*/
 /*--------------------------------------------------------------------------*/
 } // namespace
 /*--------------------------------------------------------------------------*/
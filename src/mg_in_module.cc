@@ -791,6 +791,14 @@ void List_Of_Branch_Identifiers::dump(std::ostream& o)const
 /*--------------------------------------------------------------------------*/
 static void dump_annotate(Module const& m, std::ostream& o)
 {
+  if(options().optimize_cse()){
+    make_cse_report(o, m);
+  }else{
+  }
+  if(options().optimize_hoist()){
+    make_hoist_report(o, m);
+  }else{
+  }
   return;
   for(auto x: m.var_refs()){ untested();
     o__ "// var_ref: " << x.first << "\n";
@@ -69,8 +69,25 @@ public:
   size_t merge(pSet const& s) {
      // _s.merge(s._s);// c++17
      size_t r = 0;
-     for(auto x : s._s){
-       r += _s.insert(x).second;
+     if(s._s.size() * 8 < _s.size()){
+       for(auto x : s._s){
+	 r += _s.insert(x).second;
+       }
+     }else{
+       // both sorted. walk along, insert before the hint in constant time.
+       typename set::key_compare less = _s.key_comp();
+       auto h = _s.begin();
+       for(auto x : s._s){
+	 while(h != _s.end() && less(*h, x)){
+	   ++h;
+	 }
+	 if(h != _s.end() && !less(x, *h)){
+	   // have it
+	 }else{
+	   _s.insert(h, x);
+	   ++r;
+	 }
+       }
      }
      return r;
   }
@@ -29,6 +29,20 @@
 #include <e_base.h>
 #include "mg_.h" // TODO
 #include "config.h"
+#include <sstream>
+#include <fstream>
+#include <map>
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <unistd.h>
+#if !defined(__WIN32__)
+#include <sys/wait.h>
+#include <sys/stat.h>
+#endif
+#if !defined(__WIN32__) && !defined(__APPLE__)
+#include <link.h>
+#endif
 /*global*/ int errorcount = 0;
 std::basic_ostream<char>* diag_out; // mg_error.cc
 /*--------------------------------------------------------------------------*/
@@ -87,6 +101,308 @@ public:
 OUTPUT output(std::cout);
 OUTPUT diag(std::cerr);
 /*--------------------------------------------------------------------------*/
+static std::string output_name;
+static std::string dep_file;   // -MF
+static std::string dep_target; // -MT
+static std::string cache_dir;  // --cache-dir
+static std::string cache_key;  // arguments that affect the output
+static std::vector<std::string> pp_defines;  // -D, for batch jobs
+static std::vector<std::string> pp_includes; // -I, for batch jobs
+static unsigned jobs = 0;      // -j, 0: one per processor
+/*--------------------------------------------------------------------------*/
+// make rule, "target: input includes...", and an empty rule for each include,
+// so make does not fail on removed headers.
+static void write_deps(Preprocessor const& p, std::string const& input)
+{
+  if(dep_file == ""){
+    return;
+  }else{
+  }
+  std::ofstream o(dep_file);
+  if(!o){ untested();
+    throw Exception_File_Open(dep_file + ": cannot write");
+  }else{
+  }
+
+  std::string target = dep_target;
+  if(target != ""){
+  }else if(output_name != ""){ untested();
+    target = output_name;
+  }else{ untested();
+    target = input.substr(0, input.find_last_of('.')) + ".cc";
+    target = target.substr(target.find_last_of('/') + 1);
+  }
+
+  o << target << ": " << input;
+  for(auto const& i : p.includes()){
+    o << " \\\n  " << i;
+  }
+  o << "\n";
+  for(auto const& i : p.includes()){
+    o << "\n" << i << ":\n";
+  }
+}
+/*--------------------------------------------------------------------------*/
+static uint64_t cache_hash(std::string const& s)
+{
+  uint64_t h = 14695981039346656037ull; // FNV-1a
+  for(char c : s){
+    h ^= uint64_t((unsigned char)c);
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+/*--------------------------------------------------------------------------*/
+#if !defined(__WIN32__) && !defined(__APPLE__)
+static int build_id_add(struct dl_phdr_info* info, size_t, void* data)
+{
+  std::string* id = static_cast<std::string*>(data);
+  std::string name = info->dlpi_name;
+  if(name == ""){
+    name = "/proc/self/exe";
+  }else{
+  }
+  struct stat st;
+  if(stat(name.c_str(), &st)){
+    // linux-vdso
+    *id += name + " ?\n";
+  }else{
+    *id += name + ' ' + std::to_string(st.st_size)
+      + ' ' + std::to_string(st.st_mtime) + '\n';
+  }
+  return 0;
+}
+#endif
+/*--------------------------------------------------------------------------*/
+// the generator binary and all loaded libraries and plugins, by name, size
+// and mtime, so that a rebuilt generator or plugin with the same PATCHLEVEL
+// does not reuse old entries. computed once, cleared when a plugin is
+// attached. falls back to the build time.
+static std::string build_id_memo;
+static std::string const& build_id()
+{
+  if(build_id_memo != ""){
+    return build_id_memo;
+  }else{
+  }
+#if !defined(__WIN32__) && !defined(__APPLE__)
+  std::string id;
+  dl_iterate_phdr(build_id_add, &id);
+  char h[17];
+  snprintf(h, sizeof(h), "%016llx", (unsigned long long)cache_hash(id));
+  build_id_memo = h;
+#else
+  build_id_memo = __DATE__ " " __TIME__;
+#endif
+  return build_id_memo;
+}
+/*--------------------------------------------------------------------------*/
+// look up the preprocessed input in the cache, generate on a miss.
+// output with errors is not stored, the diagnostics would be lost.
+static void make_cc_cached(std::ostream& out, File& f, Preprocessor& p,
+                           std::string const& input)
+{
+  std::string key = PATCHLEVEL "\n" + build_id() + '\n' + cache_key + input + '\n'
+    + p.fullstring();
+  char h[17];
+  snprintf(h, sizeof(h), "%016llx", (unsigned long long)cache_hash(key));
+  std::string name = cache_dir + "/" + h + ".cc";
+
+  std::ifstream in(name, std::ios::binary);
+  if(in){
+    out << in.rdbuf();
+  }else{
+    int errors = errorcount;
+    std::ostringstream o;
+    f.parse(p);
+    make_cc(o, f);
+    out << o.str();
+
+    if(errorcount != errors){ untested();
+    }else{
+      // concurrent runs may generate the same entry.
+      std::string tmp = name + "." + std::to_string(getpid());
+      std::ofstream c(tmp, std::ios::binary);
+      c << o.str();
+      c.close();
+      if(!c || rename(tmp.c_str(), name.c_str())){ untested();
+	remove(tmp.c_str());
+      }else{
+      }
+    }
+  }
+}
+/*--------------------------------------------------------------------------*/
+// input file names, one per line. "-" reads stdin.
+// empty lines and lines starting with '#' are skipped.
+static std::vector<std::string> read_manifest(std::string const& name)
+{
+  std::ifstream file;
+  std::istream* in = &std::cin;
+  if(name != "-"){
+    file.open(name);
+    if(!file){ untested();
+      throw Exception_File_Open(name + ": No such file");
+    }else{
+    }
+    in = &file;
+  }else{ untested();
+  }
+
+  std::vector<std::string> files;
+  std::string line;
+  while(std::getline(*in, line)){
+    size_t b = line.find_first_not_of(" \t");
+    size_t e = line.find_last_not_of(" \t\r");
+    if(b == std::string::npos || line[b] == '#'){
+    }else{
+      files.push_back(line.substr(b, e-b+1));
+    }
+  }
+  return files;
+}
+/*--------------------------------------------------------------------------*/
+// x/y.va -> x/y.cc
+static std::string batch_output_name(std::string const& input)
+{
+  std::string::size_type dot = input.find_last_of('.');
+  std::string::size_type sep = input.find_last_of('/');
+  if(dot == std::string::npos || (sep != std::string::npos && dot < sep)){ untested();
+    return input + ".cc";
+  }else{
+    return input.substr(0, dot) + ".cc";
+  }
+}
+/*--------------------------------------------------------------------------*/
+static std::ostringstream* batch_diag;
+static void flush_batch_diag()
+{
+  if(batch_diag){
+    diag << batch_diag->str();
+    batch_diag->str("");
+  }else{ untested();
+  }
+}
+/*--------------------------------------------------------------------------*/
+// one --cc, with its own Preprocessor and File. output goes next to the
+// input. diagnostics are collected and written in one piece.
+// returns the number of errors.
+static int batch_job(std::string const& input)
+{
+  std::ostringstream job_diag;
+  std::basic_ostream<char>* old_diag = diag_out;
+  batch_diag = &job_diag;
+  diag_out = &job_diag; // mg_error.cc
+  int errors = errorcount;
+  try{
+    Preprocessor pp;
+    pp.set_diag(job_diag);
+    for(auto const& d : pp_defines){
+      pp.define(d);
+    }
+    for(auto const& i : pp_includes){
+      pp.add_include_path(i);
+    }
+    pp.read(input);
+
+    std::string name = batch_output_name(input);
+    std::ofstream out(name);
+    if(!out){ untested();
+      throw Exception_File_Open(name + ": cannot write");
+    }else{
+    }
+    File f;
+    if(cache_dir == ""){
+      f.parse(pp);
+      make_cc(out, f);
+    }else{
+      make_cc_cached(out, f, pp, input);
+    }
+  }catch (Exception const& e) {
+    job_diag << input << ": " << e.message() << '\n';
+    ++errorcount;
+  }
+  flush_batch_diag();
+  batch_diag = NULL;
+  diag_out = old_diag;
+  return errorcount - errors;
+}
+/*--------------------------------------------------------------------------*/
+// run batch_job for each file, up to "jobs" at a time. each job runs in a
+// child process forked after the plugins are loaded, so errorcount,
+// diag_out, options() and the per-plugin counters are private to the job,
+// and the output does not depend on the order.
+// returns the number of failed jobs.
+static int run_batch(std::vector<std::string> const& files)
+{
+  int failed = 0;
+#if defined(__WIN32__)
+  for(auto const& i : files){ untested();
+    if(batch_job(i)){ untested();
+      ++failed;
+    }else{ untested();
+    }
+  }
+#else
+  unsigned n = jobs;
+  if(!n){
+    long np = sysconf(_SC_NPROCESSORS_ONLN);
+    n = unsigned(std::max(np, 1l));
+  }else{
+  }
+  if(cache_dir != ""){
+    build_id(); // once, not per job
+  }else{
+  }
+
+  std::cout.flush();
+  std::cerr.flush();
+  ((std::basic_ostream<char>&)diag).flush();
+
+  std::map<pid_t, std::string> running;
+  auto wait_one = [&]{
+    int status;
+    pid_t pid = wait(&status);
+    if(pid < 0){ untested();
+      throw Exception("wait failed");
+    }else{
+    }
+    auto r = running.find(pid);
+    if(r == running.end()){ untested();
+    }else{
+      if(!WIFEXITED(status) || WEXITSTATUS(status)){
+	diag << r->second << ": failed\n";
+	++failed;
+      }else{
+      }
+      running.erase(r);
+    }
+  };
+
+  for(auto const& i : files){
+    while(running.size() >= n){
+      wait_one();
+    }
+    pid_t pid = fork();
+    if(pid < 0){ untested();
+      throw Exception("fork failed");
+    }else if(pid == 0){
+      // mg_error may exit on fatal errors.
+      atexit(flush_batch_diag);
+      int errors = batch_job(i);
+      ((std::basic_ostream<char>&)diag).flush();
+      _exit(errors ? 1 : 0);
+    }else{
+      running[pid] = i;
+    }
+  }
+  while(!running.empty()){
+    wait_one();
+  }
+#endif
+  return failed;
+}
+/*--------------------------------------------------------------------------*/
 static void prepare_env()
 {
   assert(strlen(GNUCAP_PLUGPATH));
@@ -116,6 +432,7 @@ int main(int argc, char** argv)
     trace2("main", argc, argv[0]);
     if (strcmp(argv[0],"-o")==0) { untested();
       output.set(argv[1]);
+      output_name = argv[1];
       --argc;
       ++argv;
     }else if (strcasecmp(argv[0], "-a") == 0) { untested();
@@ -123,6 +440,8 @@ int main(int argc, char** argv)
       ++argv;
       if (argc) { untested();
 	CMD::command(std::string("attach ") + argv[0], &CARD_LIST::card_list);
+	cache_key += std::string("-a ") + argv[0] + '\n';
+	build_id_memo = "";
       }else{untested();
       }
     }else if (strcmp(argv[0],"-d")==0
@@ -134,8 +453,13 @@ int main(int argc, char** argv)
       p.set_diag(diag);
       diag_out = &(std::basic_ostream<char>&)diag; // mg_error.cc
       p.read(argv[1]);
-      f.parse(p);
-      make_cc(output, f);
+      write_deps(p, argv[1]);
+      if(cache_dir == ""){
+	f.parse(p);
+	make_cc(output, f);
+      }else{
+	make_cc_cached(output, f, p, argv[1]);
+      }
       --argc;
       ++argv;
     }else if (strcmp(argv[0],"--pp")==0
@@ -143,22 +467,47 @@ int main(int argc, char** argv)
       p.set_diag(diag);
       diag_out = &(std::basic_ostream<char>&)diag; // mg_error.cc
       p.read(argv[1]);
+      write_deps(p, argv[1]);
       p.dump(output);
       --argc;
       ++argv;
+    }else if (strcmp(argv[0],"-MF")==0) {
+      dep_file = argv[1];
+      --argc;
+      ++argv;
+    }else if (strcmp(argv[0],"-MT")==0) {
+      dep_target = argv[1];
+      --argc;
+      ++argv;
+    }else if (strcmp(argv[0],"-j")==0) {
+      jobs = unsigned(std::max(atoi(argv[1]), 0));
+      --argc;
+      ++argv;
+    }else if (strcmp(argv[0],"--batch")==0) {
+      errorcount += run_batch(read_manifest(argv[1]));
+      --argc;
+      ++argv;
+    }else if (strcmp(argv[0],"--cache-dir")==0) {
+      cache_dir = argv[1];
+      --argc;
+      ++argv;
     }else if (argc > 1 && strncmp(argv[0],"-D", 2)==0) {
       if(argv[0][2]) {
 	p.define(argv[0]+2);
+	pp_defines.push_back(argv[0]+2);
       }else{
 	p.define(argv[1]);
+	pp_defines.push_back(argv[1]);
 	--argc;
 	++argv;
       }
     }else if (argc > 1 && strncmp(argv[0], "-I", 2)==0) {
       if(argv[0][2]) {
 	p.add_include_path(argv[0]+2);
+	pp_includes.push_back(argv[0]+2);
       }else{
 	p.add_include_path(argv[1]);
+	pp_includes.push_back(argv[1]);
 	--argc;
 	++argv;
       }
@@ -188,6 +537,7 @@ int main(int argc, char** argv)
     }else if (argc && strncmp(argv[0], "--", 2) == 0) {itested();
       CS cmd(CS::_STRING, argv[0]+2); // command line
       modelgen_opts().parse(cmd);
+      cache_key += std::string(argv[0]) + '\n';
     }else{untested();
       throw Exception("no input files");
     }
@@ -40,8 +40,17 @@ void Options::parse(CS& f)
       || Get(f, "optimize-deriv",  &_optimize_deriv)
       || Get(f, "optimize-deps",   &_optimize_deps)
       || Get(f, "optimize-unused", &_optimize_unused)
+      || Get(f, "optimize-sparse", &_optimize_sparse)
+      || Get(f, "optimize-batch",  &_optimize_batch)
+      || Get(f, "optimize-bypass", &_optimize_bypass)
+      || Get(f, "optimize-cse",    &_optimize_cse)
+      || Get(f, "optimize-hoist",  &_optimize_hoist)
+      || Get(f, "optimize-fuse",   &_optimize_fuse)
+      || Get(f, "optimize-intern", &_optimize_intern)
+      || Get(f, "optimize-simd",   &_optimize_simd)
       || Get(f, "gen-module",      &_gen_module)
       || Get(f, "gen-paramset",    &_gen_paramset)
+      || Get(f, "gen-profile",     &_gen_profile)
       || Get(f, "dump-module",     &_dump_module)
       || Get(f, "dump-paramset",   &_dump_paramset)
       || Get(f, "dump-unreachable",&_dump_unreachable)
@@ -29,6 +29,15 @@ class Options : public Base {
   bool _optimize_deps{true};   // consider dependency types
   bool _optimize_unused{true}; // dont emit unused sources
   bool _optimize_nodes{true};  // prune unused nodes
+  bool _optimize_sparse{false}; // per-expression sparse derivatives
+  bool _optimize_batch{false}; // evaluate instances per common
+  bool _optimize_bypass{false}; // skip evaluation if no input moved
+  bool _optimize_cse{false};   // compute repeated subexpressions once
+  bool _optimize_hoist{false}; // parameter expressions in precalc
+  bool _optimize_fuse{false};  // one element for all flow branches
+  bool _optimize_intern{false}; // share commons with equal parameters
+  bool _optimize_simd{false};  // ddouble_ padded for vector kernels
+  bool _gen_profile{false};    // time spent in generated methods
   bool _gen_module{true};
   bool _gen_paramset{true};
   bool _dump_module{true};
@@ -50,8 +59,17 @@ public:
   bool optimize_deps()    const{ untested(); return _optimize_deps; }
   bool optimize_unused()  const{ return _optimize_unused; }
   bool optimize_nodes()   const{ return _optimize_nodes; }
+  bool optimize_sparse()  const{ return _optimize_sparse; }
+  bool optimize_batch()   const{ return _optimize_batch; }
+  bool optimize_bypass()  const{ return _optimize_bypass; }
+  bool optimize_cse()     const{ return _optimize_cse; }
+  bool optimize_hoist()   const{ return _optimize_hoist; }
+  bool optimize_fuse()    const{ return _optimize_fuse; }
+  bool optimize_intern()  const{ return _optimize_intern; }
+  bool optimize_simd()    const{ return _optimize_simd; }
   bool gen_module()       const{ return _gen_module; }
   bool gen_paramset()     const{ return _gen_paramset; }
+  bool gen_profile()      const{ return _gen_profile; }
   bool dump_module()      const{ return _dump_module; }
   bool dump_paramset()    const{ return _dump_paramset; }
   bool store_unreachable()const{ untested(); untested(); return _store_unreachable; }
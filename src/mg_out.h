@@ -23,6 +23,8 @@
 #define MG_OUT_H
 /*--------------------------------------------------------------------------*/
 #include <fstream>
+#include <map>
+#include <set>
 #include "mg_base.h"
 //#include "mg_.h"
 /*--------------------------------------------------------------------------*/
@@ -83,13 +85,108 @@ void make_copy_construct_parameter_list(std::ostream&, const Parameter_List_Coll
 class Module;
 void make_cc_decl(std::ostream&, const Module&);
 /* mg_out_module.cc */
+class Branch;
 void make_cc_module(std::ostream&, const Module&);
+void make_prof_scope(std::ostream&, Module const&, char const*);
+bool is_fused(Branch const&);
 /* mg_out_analog.cc */
 void make_cc_analog(std::ostream&, const Module&);
 //void make_cc_func(std::ostream&, const Module&); // ?
 void make_cc_analog_functions(std::ostream&, const Module&);
+void make_cse_report(std::ostream&, const Module&);
+void make_hoist_table(const Module&);
+void make_hoist_report(std::ostream&, const Module&);
 /* mg_out_common.cc */
 void make_cc_common(std::ostream&, const Module&);
+void make_param_index(std::ostream&, std::string const&, std::vector<std::string const*> const&);
+/*--------------------------------------------------------------------------*/
+/* mg_out_expr.cc */
+class Token;
+// optimize-cse. value numbering over the expressions in one generated
+// function. Pass one counts subexpressions, pass two computes each
+// repeated one at most once per call, into a local cse<n>.
+class CSE_TABLE {
+  struct ENTRY {
+    std::string text;
+    size_t count{0};
+    size_t size{0}; // operations
+    int slot{-1};
+    std::set<std::string> vars;
+    std::string type; // of the temporaries, ddouble if they differ
+  };
+  std::vector<ENTRY> _e;
+  std::map<std::string, size_t> _index;
+  int _slots{0};
+  int _mute{0};
+  bool _counting{true};
+  static CSE_TABLE* _active;
+public:
+  explicit CSE_TABLE();
+  ~CSE_TABLE();
+  static CSE_TABLE* active() {return _active;}
+
+  bool is_counting()const {return _counting;}
+  void start_emit();
+  void make_decl(std::ostream&)const;
+  void make_invalidate(std::ostream&, std::string const& var)const;
+  void make_invalidate_vars(std::ostream&)const;
+  void make_report(std::ostream&)const;
+public: // OUT_EXPRESSION
+  bool key(Token const*, std::string*, std::set<std::string>*, size_t*)const;
+  bool count(Token const*, std::string const& type);
+  void mute(int i) {_mute += i;}
+  int slot(Token const*)const;
+  std::string const& type(int slot)const;
+};
+/*--------------------------------------------------------------------------*/
+// optimize-hoist. subexpressions of tr_eval_analog that read parameters,
+// constants and fixed functions only. computed in precalc into _hoist<n>,
+// a COMMON member, or an instance member if a function reads the instance.
+class HOIST_TABLE {
+  struct ENTRY {
+    std::string text;
+    Token const* t{NULL};
+    size_t count{0};
+    bool dev{false};
+  };
+  std::vector<ENTRY> _e;
+  std::map<std::string, size_t> _index;
+  int _guard{0};
+  bool _collecting{true};
+  bool _reading{false};
+  static HOIST_TABLE* _active;
+public:
+  explicit HOIST_TABLE();
+  ~HOIST_TABLE();
+  static HOIST_TABLE* active() {return _active;}
+
+  void start_emit() {_collecting = false;}
+  void set_reading(bool r) {_reading = r;}
+  void guard(int i) {_guard += i;}
+  void make_decl(std::ostream&, bool dev)const;
+  void make_precalc(std::ostream&, bool dev)const;
+  void make_report(std::ostream&)const;
+public: // OUT_EXPRESSION
+  bool key(Token const*, std::string*, bool* dev, size_t* reads)const;
+  std::string read(Token const*);
+};
+/*--------------------------------------------------------------------------*/
+// optimize-hoist. the code emitted in this scope may not run.
+class HOIST_GUARD {
+public:
+  explicit HOIST_GUARD() {
+    if(HOIST_TABLE* h = HOIST_TABLE::active()){
+      h->guard(1);
+    }else{
+    }
+  }
+  ~HOIST_GUARD() {
+    if(HOIST_TABLE* h = HOIST_TABLE::active()){
+      h->guard(-1);
+    }else{
+    }
+  }
+};
 /*--------------------------------------------------------------------------*/
 inline std::string baseclass(Module const&)
 {
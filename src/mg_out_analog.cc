@@ -23,6 +23,7 @@
 #include "mg_analog.h"
 #include "mg_options.h"
 #include <typeinfo>
+#include <sstream>
 /*--------------------------------------------------------------------------*/
 class OUT_ANALOG {
 public:
@@ -224,9 +225,10 @@ void OUT_ANALOG::make_assignment(std::ostream& o, Assignment const& a) const
     if(a.is_int()){
       o__ lhsname << " = int(t0); // (*)\n";
     }else if(within_af(&a)){
-      o__ lhsname << " = t0; // (1a)\n";
+      // t0 may be sparse, lhs may be anything
+      o__ lhsname << " = " << (options().optimize_sparse()?"ddouble(t0)":"t0") << "; // (1a)\n";
     }else if(!options().optimize_deriv()) { untested();
-      o__ lhsname << " = t0; // (*)\n";
+      o__ lhsname << " = " << (options().optimize_sparse()?"ddouble(t0)":"t0") << "; // (*)\n";
       for(auto v : a.data().ddeps()) { untested();
 	o__ "// " << a.lhs().code_name() << "[d" << v->code_name() << "] = " << "t0[d" << v->code_name() << "]; // (2a)\n";
 	o__ "assert(" << a.lhs().code_name() << "[d" << v->code_name() << "] == " << "t0[d" << v->code_name() << "]); // (2a2)\n";
@@ -275,6 +277,11 @@ void OUT_ANALOG::make_assignment(std::ostream& o, Assignment const& a) const
       }
     }
   }
+  if(CSE_TABLE const* cse = CSE_TABLE::active()){
+    indent x;
+    cse->make_invalidate(o, lhsname);
+  }else{
+  }
   o__ "}\n";
 }
 /*--------------------------------------------------------------------------*/
@@ -616,6 +623,7 @@ void OUT_ANALOG::make_evt(std::ostream& o, AnalogEvtCtlStmt const& s) const
     o__ "if (t0 /*?*/) {\n";
     {
       indent y;
+      HOIST_GUARD g;
       make_ctrl(o, s.code());
     }
     o__ "}else{\n";
@@ -633,6 +641,7 @@ void OUT_ANALOG::make_loop(std::ostream& o, AnalogWhileStmt const& s) const
     indent x;
     make_cc_expression(o, s.conditional());
     o__ "if (t0) {\n";
+    HOIST_GUARD g;
     if(s.has_body()) {
       indent y;
       if(auto bb = dynamic_cast<AnalogCtrlBlock const*>(&s.body())){
@@ -691,6 +700,7 @@ void OUT_ANALOG::make_cond(std::ostream& o, AnalogConditionalStmt const& s) cons
   }else{
     indent x;
     make_cc_expression(o, s.conditional());
+    HOIST_GUARD g;
     o__ "if (t0) {\n";
     if(s.true_part()) {
       indent y;
@@ -743,6 +753,7 @@ void OUT_ANALOG::make_switch(std::ostream& o, AnalogSwitchStmt const& s) const
     }
     o__ "}\n";
     std::string paren="";
+    HOIST_GUARD g;
 
     CaseGen const* def = NULL;
     for(auto c : s.cases()){
@@ -803,6 +814,15 @@ void OUT_ANALOG::make_seq_block(std::ostream& o, AnalogSeqBlock const& s) const
     o__ "{ // anonymous block\n";
   }
   make_load_block_variables(o, s.variables_());
+  if(CSE_TABLE const* cse = CSE_TABLE::active()){
+    Variable_List_Collection const& P = s.variables_();
+    for (auto q = P.begin(); q != P.end(); ++q) {
+      for (auto p = (*q)->begin(); p != (*q)->end(); ++p) {
+	cse->make_invalidate(o, (*p)->token().code_name());
+      }
+    }
+  }else{
+  }
 #if 0
   for(auto i : s.variables_()) { untested();
     assert(s.identifier() != "");
@@ -1290,18 +1310,77 @@ static void make_cc_common_tr_eval(std::ostream& o, const Module& m)
   o << "typedef MOD_" << m.identifier() << "::ddouble ddouble;\n";
   o << "inline void COMMON_" << m.identifier() <<
     "::tr_eval_analog(MOD_" << m.identifier() << "* d) const\n{\n";
+  make_prof_scope(o, m, "PROF_EVAL");
   o__ "trace1(\"" << m.identifier() <<"::tr_eval_analog\", d);\n";
   o__ "trace1(\"" << m.identifier() <<"::tr_eval_analog\", d->long_label());\n";
 
   OUT_ANALOG oo(OUT_ANALOG::modeDYNAMIC);
+  HOIST_TABLE* hoist = HOIST_TABLE::active();
+  if(hoist){
+    hoist->set_reading(true);
+  }else{
+  }
 
-  oo.make_load_variables(o, m);
-  oo.make_analog_list(o, m);
+  if(options().optimize_cse()){
+    CSE_TABLE cse;
+    {
+      std::ostringstream count;
+      oo.make_load_variables(count, m);
+      oo.make_analog_list(count, m);
+    }
+    cse.start_emit();
+    cse.make_decl(o);
+    oo.make_load_variables(o, m);
+    oo.make_analog_list(o, m);
+  }else{
+    oo.make_load_variables(o, m);
+    oo.make_analog_list(o, m);
+  }
+  if(hoist){
+    hoist->set_reading(false);
+  }else{
+  }
   o << "}\n"
     "/*--------------------------------------"
     "------------------------------------*/\n";
 }
 /*--------------------------------------------------------------------------*/
+// optimize-hoist. collect what tr_eval_analog will read from precalc, ahead
+// of the declarations.
+void make_hoist_table(const Module& m)
+{
+  assert(HOIST_TABLE::active());
+  if(m.has_analog_block()){
+    std::ostringstream collect;
+    make_cc_common_tr_eval(collect, m);
+  }else{
+  }
+}
+/*--------------------------------------------------------------------------*/
+// dump-annotate, optimize-hoist. what precalc would compute.
+void make_hoist_report(std::ostream& o, const Module& m)
+{
+  HOIST_TABLE hoist;
+  make_hoist_table(m);
+  hoist.make_report(o);
+}
+/*--------------------------------------------------------------------------*/
+// dump-annotate, optimize-cse. what tr_eval_analog would share.
+void make_cse_report(std::ostream& o, const Module& m)
+{
+  if(m.has_analog_block()){
+    OUT_ANALOG oo(OUT_ANALOG::modeDYNAMIC);
+    CSE_TABLE cse;
+    {
+      std::ostringstream count;
+      oo.make_load_variables(count, m);
+      oo.make_analog_list(count, m);
+    }
+    cse.make_report(o);
+  }else{
+  }
+}
+/*--------------------------------------------------------------------------*/
 static void make_cc_common_tr_review(std::ostream& o, const Module& m)
 {
   o << "typedef MOD_" << m.identifier() << "::ddouble ddouble;\n";
@@ -1343,6 +1422,10 @@ static void make_cc_common_precalc(std::ostream& o, const Module& m)
   OUT_ANALOG oo(OUT_ANALOG::modePRECALC);
   oo.make_load_variables(o, m);
   oo.make_analog_list(o, m);
+  if(HOIST_TABLE const* h = HOIST_TABLE::active()){
+    h->make_precalc(o, true);
+  }else{
+  }
   o << "}\n"
     "/*--------------------------------------"
     "------------------------------------*/\n";
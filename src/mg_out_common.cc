@@ -22,7 +22,10 @@
 #include "mg_out.h"
 #include "mg_circuit.h"
 #include "mg_.h" // TODO
+#include "mg_options.h"
+#include <algorithm>
 #include <numeric>
+#include <cstdint>
 /*--------------------------------------------------------------------------*/
 static void make_common_default_constructor(std::ostream& o, const Module& d)
 {
@@ -139,17 +142,231 @@ static void make_common_operator_equal(std::ostream& o, const Module& d)
     "/*--------------------------------------------------------------------------*/\n";
 }
 /*--------------------------------------------------------------------------*/
+// optimize-intern. hash reads the parameters compared in operator==.
+// intern returns the pooled common equal to this one in the same scope,
+// or pools this one. the parameters must be final, see precalc_params.
+static void make_common_intern(std::ostream& o, const Module& d)
+{
+  make_tag(o);
+  std::string cn = "COMMON_" + d.identifier().to_string();
+  o << "size_t " << cn << "::hash()const\n{\n";
+  o__ "size_t h = 0;\n";
+  for(auto q : d.parameters()){
+    if(!q->is_local()) {
+      for(auto p : *q){
+	o__ "h = va_hash(h, " << p->code_name() << ");\n";
+      }
+    }else{
+    }
+  }
+  o__ "return h;\n";
+  o << "}\n"
+    "/*--------------------------------------------------------------------------*/\n";
+  o << cn << "* " << cn << "::intern(const CARD_LIST* scope)\n{\n";
+  o__ "assert(!_pooled.is_pooled());\n";
+  o__ "size_t h = hash();\n";
+  o__ "auto c = static_cast<" << cn << "*>(pool().find(*this, scope, h));\n";
+  o__ "if(!c){\n";
+  o____ "pool().insert(this, &_pooled, scope, h);\n";
+  o____ "_precalc_pending = true;\n";
+  o____ "c = this;\n";
+  o__ "}else{\n";
+  o__ "}\n";
+  o__ "return c;\n";
+  o << "}\n"
+    "/*--------------------------------------------------------------------------*/\n";
+  // after precalc_last on a pooled common.
+  o << "void " << cn << "::reintern()\n{\n";
+  o__ "assert(_pooled.is_pooled());\n";
+  o__ "pool().rehash(&_pooled, hash());\n";
+  o << "}\n"
+    "/*--------------------------------------------------------------------------*/\n";
+}
+/*--------------------------------------------------------------------------*/
+static uint32_t param_hash(std::string const& s, uint32_t h)
+{
+  for(char c : s){
+    h = (h ^ uint32_t((unsigned char)(c))) * 16777619u;
+  }
+  return h;
+}
+/*--------------------------------------------------------------------------*/
+// spreads all bits of x over the result. same as in the generated code.
+static uint32_t param_mix(uint32_t x)
+{
+  x ^= x >> 16;
+  x *= 0x85ebca6bu;
+  x ^= x >> 13;
+  x *= 0xc2b2ae35u;
+  x ^= x >> 16;
+  return x;
+}
+/*--------------------------------------------------------------------------*/
+static uint32_t const param_disp_max = 1u << 16;
+/*--------------------------------------------------------------------------*/
+// hash and displace. each name goes to bucket mix(h) % nb, all names in a
+// bucket share the displacement d, and land in mix(h + d*phi) % m. buckets
+// are placed largest first, d is searched up to param_disp_max.
+static bool param_hash_slots(std::vector<int>* slot, std::vector<uint32_t>* disp,
+    std::vector<std::string const*> const& names, uint32_t seed, size_t nb,
+    size_t m)
+{
+  std::vector<uint32_t> h(names.size());
+  std::vector<std::vector<size_t>> bucket(nb);
+  for(size_t i=0; i<names.size(); ++i){
+    h[i] = param_hash(*names[i], seed);
+    bucket[param_mix(h[i]) % nb].push_back(i);
+  }
+  std::vector<size_t> order(nb);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b){
+      return bucket[a].size() > bucket[b].size();
+      });
+
+  slot->assign(m, -1);
+  disp->assign(nb, 0);
+  std::vector<size_t> pos;
+  for(size_t b : order){
+    if(bucket[b].empty()){
+      break;
+    }else{
+    }
+    uint32_t d = 0;
+    for(; d < param_disp_max; ++d){
+      pos.clear();
+      for(size_t i : bucket[b]){
+	size_t p = param_mix(h[i] + d * 2654435769u) % m;
+	if((*slot)[p] != -1 || std::find(pos.begin(), pos.end(), p) != pos.end()){
+	  break;
+	}else{
+	  pos.push_back(p);
+	}
+      }
+      if(pos.size() == bucket[b].size()){
+	break;
+      }else{
+      }
+    }
+    if(d == param_disp_max){ untested();
+      return false;
+    }else{
+    }
+    (*disp)[b] = d;
+    for(size_t k=0; k<pos.size(); ++k){
+      (*slot)[pos[k]] = int(bucket[b][k]);
+    }
+  }
+  return true;
+}
+/*--------------------------------------------------------------------------*/
+// perfect hash over names, found at generation time, see param_hash_slots.
+// the generated param_index returns the position in names, or -1.
+void make_param_index(std::ostream& o, std::string const& class_name,
+    std::vector<std::string const*> const& names)
+{
+  o << "int " << class_name << "::param_index(char const* Name, size_t len)\n{\n";
+  if(names.empty()){
+    o__ "(void)Name;\n";
+    o__ "(void)len;\n";
+    o__ "return -1;\n";
+    o << "}\n"
+      "/*--------------------------------------------------------------------------*/\n";
+    return;
+  }else{
+  }
+  for(size_t i=1; i<names.size(); ++i){
+    if(*names[i-1] == *names[i]){ untested();
+      throw Exception("duplicate parameter name " + *names[i]);
+    }else{
+    }
+  }
+
+  // about two names per bucket, a fifth of the slots left free. a few
+  // seeds, then more room. each try is bounded, so is the search.
+  size_t const n = names.size();
+  size_t const nb = (n + 1) / 2;
+  std::vector<int> slot;
+  std::vector<uint32_t> disp;
+  uint32_t const seed0 = 2166136261u;
+  uint32_t seed = seed0;
+  size_t m = n + n / 4 + 1;
+  for(int tries = 0; ; ++tries){
+    if(param_hash_slots(&slot, &disp, names, seed, nb, m)){
+      break;
+    }else if(tries == 64){ untested();
+      throw Exception("cannot index the parameters of " + class_name);
+    }else if(tries % 16 == 15){ untested();
+      m += m / 2;
+      seed = seed0;
+    }else{ untested();
+      ++seed;
+    }
+  }
+
+  std::string comma;
+  o__ "static char const* const names[] = {";
+  for(auto x : names){
+    o << comma << "\"" << *x << "\"";
+    comma = ", ";
+  }
+  o << "};\n";
+  comma = "";
+  o__ "static unsigned short const disp[" << nb << "] = {";
+  for(uint32_t d : disp){
+    o << comma << d;
+    comma = ", ";
+  }
+  o << "};\n";
+  comma = "";
+  o__ "static " << (n < 32768 ? "short" : "int")
+    << " const slot[" << slot.size() << "] = {";
+  for(int s : slot){
+    o << comma << s;
+    comma = ", ";
+  }
+  o << "};\n";
+  o__ "struct mix {\n";
+  o____ "static unsigned f(unsigned x) {\n";
+  o______ "x ^= x >> 16;\n";
+  o______ "x *= 0x85ebca6bu;\n";
+  o______ "x ^= x >> 13;\n";
+  o______ "x *= 0xc2b2ae35u;\n";
+  o______ "x ^= x >> 16;\n";
+  o______ "return x;\n";
+  o____ "}\n";
+  o__ "};\n";
+  o__ "unsigned h = " << seed << "u;\n";
+  o__ "for(size_t k=0; k<len; ++k){\n";
+  o____ "h = (h ^ (unsigned char)(Name[k])) * 16777619u;\n";
+  o__ "}\n";
+  o__ "unsigned d = disp[mix::f(h) % " << nb << "u];\n";
+  o__ "int i = slot[mix::f(h + d * 2654435769u) % " << slot.size() << "u];\n";
+  o__ "if(i < 0){\n";
+  o____ "return -1;\n";
+  o__ "}else if(std::strncmp(Name, names[i], len) || names[i][len]){\n";
+  o____ "return -1;\n";
+  o__ "}else{\n";
+  o____ "return i;\n";
+  o__ "}\n";
+  o << "}\n"
+    "/*--------------------------------------------------------------------------*/\n";
+}
+/*--------------------------------------------------------------------------*/
 void make_common_set_param_by_name(std::ostream& o, const Module& m)
 {
-  o << "aidx COMMON_" << m.identifier() << "::set_param_by_name("
+  std::string class_name = "COMMON_" + m.identifier().to_string();
+  o << "aidx " << class_name << "::set_param_by_name("
        "std::string Name, std::string Value)\n{\n";
   o__ "trace2(\"spbn " << m.identifier() << "\", Name, Value);\n";
+  o__ "int i = param_index(Name.c_str(), Name.size());\n";
+  o__ "if(i < 0){\n";
+  o____ "throw Exception_No_Match(Name);\n";
+  o__ "}else{\n";
+  o____ "return set_param_at(i, Name, Value);\n";
+  o__ "}\n";
+  o << "}\n"
+    "/*--------------------------------------------------------------------------*/\n";
 
-  o__ "{\n";
-
-
-  o__ "static std::string names[] = {";
-  int cnt = 0;
   std::vector<std::string const*> names;
   std::vector<std::string const*> hs;
   std::vector<int> alias;
@@ -192,33 +409,16 @@ void make_common_set_param_by_name(std::ostream& o, const Module& m)
       return *names[A] < *names[B];
       });
 
-
-  std::string comma;
+  std::vector<std::string const*> sorted;
   for(auto n : idx){
-      o << comma << "\"" << *names[n] << "\"";
-      comma = ", ";
+    sorted.push_back(names[n]);
   }
-  cnt = int(names.size());
-  o__ "};\n";
-  o__ "int lb = 0;\n";
-  o__ "int ub = " << cnt << ";\n";
-  o__ "while(lb < ub) {\n";
-  o____ "int mid = (lb+ub)/2;\n";
-  o____ "int c = std::strcmp(Name.c_str(), names[mid].c_str());\n";
-  o____ "if(c<0){\n";
-  o______ "ub = mid;\n";
-  o____ "}else if(c>0){\n";
-  o______ "lb = mid+1;\n";
-  o____ "}else{\n";
-  o______ "lb = mid;\n";
-  o______ "ub = " << cnt << ";\n";
-  o______ "assert(lb<ub);\n";
-  o______ "break;\n";
-  o____ "}\n";
-  o__ "}\n";
-  o__ "assert(lb<=ub);\n";
+  make_param_index(o, class_name, sorted);
 
-  o__ "switch(ub-lb){\n";
+  o << "aidx " << class_name << "::set_param_at(int i, std::string const& Name,"
+       " std::string const& Value)\n{\n";
+  o__ "switch(i){\n";
+  int cnt = 0;
   for(auto n : idx){
     std::string cn = "_p_" + *names[n];
     std::string pn;
@@ -245,14 +445,11 @@ void make_common_set_param_by_name(std::ostream& o, const Module& m)
       o << pn << " = Value;";
     }
     o____ "break; // " << alias[n] << "\n";
-    --cnt;
+    ++cnt;
   }
-  o____ "case 0: throw Exception_No_Match(Name);\n";
-
-  o__ "}\n";
-  o__ "return lb;\n";
+  o____ "default: throw Exception_No_Match(Name);\n";
   o__ "}\n";
-
+  o__ "return i;\n";
   o << "}\n"
     "/*--------------------------------------------------------------------------*/\n";
 }
@@ -624,13 +821,36 @@ static void make_common_expand(std::ostream& o , const Module& m)
   o  << "}\n"
     "/*--------------------------------------------------------------------------*/\n";
 
-  o << "void COMMON_" << m.identifier() << "::precalc_last(const CARD_LIST* par_scope)\n{\n";
+  if(options().optimize_intern()){
+    // precalc_params depends on the scope, precalc_derived only on the
+    // values. the latter runs once per interned common.
+    o << "void COMMON_" << m.identifier() << "::precalc_last(const CARD_LIST* par_scope)\n{\n";
+    o__ "precalc_params(par_scope);\n";
+    o__ "precalc_derived();\n";
+    o << "}\n"
+      "/*--------------------------------------------------------------------------*/\n";
+    o << "void COMMON_" << m.identifier() << "::precalc_params(const CARD_LIST* par_scope)\n{\n";
+  }else{
+    o << "void COMMON_" << m.identifier() << "::precalc_last(const CARD_LIST* par_scope)\n{\n";
+  }
   o__ "assert(par_scope);\n"
     "  COMMON_COMPONENT::precalc_last(par_scope);\n";
   o__ "COMMON_" << m.identifier() << " const* pc = this;\n";
   o__ "(void)pc;\n";
   make_final_adjust_eval_parameter_list(o , m.parameters());
   make_eval_netlist_parameters(o, m);
+  if(options().optimize_intern()){
+    o << "}\n"
+      "/*--------------------------------------------------------------------------*/\n";
+    o << "void COMMON_" << m.identifier() << "::precalc_derived()\n{\n";
+    o__ "COMMON_" << m.identifier() << " const* pc = this;\n";
+    o__ "(void)pc;\n";
+  }else{
+  }
+  if(HOIST_TABLE const* h = HOIST_TABLE::active()){
+    h->make_precalc(o, false);
+  }else{
+  }
     o << "}\n"
     "/*--------------------------------------------------------------------------*/\n";
 #if 0
@@ -680,6 +900,10 @@ void make_cc_common(std::ostream& o , const Module& m)
   make_common_copy_constructor(o, m);
   make_common_destructor(o, m);
   make_common_operator_equal(o, m);
+  if(options().optimize_intern()){
+    make_common_intern(o, m);
+  }else{
+  }
   make_common_set_param_by_index(o, m);
   make_common_set_param_by_name(o, m);
   make_common_param_is_printable(o, m);
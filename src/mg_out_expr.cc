@@ -26,6 +26,8 @@
 #include "mg_analog.h" // BUG. Probe
 #include <globals.h>
 #include <stack>
+#include <set>
+#include <sstream>
 //#include <iomanip>
 /*--------------------------------------------------------------------------*/
 const int POOLSIZE = 100;
@@ -236,6 +238,22 @@ static char* ftos_(double num, int fieldwidth, int len, int fmt)
   return str;
 }
 /*--------------------------------------------------------------------------*/
+// a ddouble that only carries the derivatives in d.
+static std::string sparse_ddouble(DDeps const& d)
+{
+  std::string ret = "sddouble_<ddouble::num_deriv";
+  std::set<std::pair<Branch const*, bool>> seen; // resolved branch, flow
+  for(auto i : d){
+    assert(i->branch());
+    if(i->branch()->is_short()){
+    }else if(seen.insert(std::make_pair(i->branch(), i->is_flow_probe())).second){
+      ret += ", d" + i->code_name();
+    }else{
+    }
+  }
+  return ret + ">";
+}
+/*--------------------------------------------------------------------------*/
 class RPN_VARS {
   typedef enum{
     t_flt,
@@ -259,8 +277,18 @@ class RPN_VARS {
   int _arr_idx{-1};
   int _arr_alloc{0};
   TData const* _deps;
+  std::string _ddouble{"ddouble"};
+  std::ostream* _decl{NULL}; // declare temporaries here, optimize-cse
 public:
-  explicit RPN_VARS(TData const* d) : _deps(d) {}
+  explicit RPN_VARS(TData const* d, std::ostream* decl=NULL)
+    : _deps(d), _decl(decl) {
+    if(!_deps){
+    }else if(!options().optimize_sparse()){
+    }else if(_deps->ddeps().empty()){
+    }else{
+      _ddouble = sparse_ddouble(_deps->ddeps());
+    }
+  }
   ~RPN_VARS(){
     assert(_flt_idx == -1);
     assert(_ddo_idx == -1);
@@ -316,7 +344,8 @@ public:
       ++_arr_alloc;
     }
   }
-  void new_ddouble(std::ostream& o){
+  void new_ddouble(std::ostream& out){
+    std::ostream& o = _decl ? *_decl : out;
     ++_ddo_idx;
     if(_ddo_idx < _ddo_alloc){
     }else{
@@ -324,7 +353,7 @@ public:
       ++_ddo_alloc;
       assert(_ddo_idx>=0);
       if(_deps){
-	o__ "ddouble t" << _ddo_idx << ";\n";
+	o__ _ddouble << " t" << _ddo_idx << ";\n";
       }else{
 	o__ "ddouble t" << _ddo_idx << ";\n"; // TODO? some deps?
       }
@@ -418,6 +447,22 @@ public:
       return "";
     }
   }
+  // sparse temporaries are passed on as ddouble, callees may deduce types.
+  std::string arg_name() const{
+    assert(_types.size());
+    if(is_sparse_top()){
+      return "ddouble(" + code_name() + ")";
+    }else{
+      return code_name();
+    }
+  }
+  bool is_sparse()const { return _ddouble != "ddouble"; }
+  std::string const& ddouble_type()const { return _ddouble; }
+  // the top is a temporary of the sparse type
+  bool is_sparse_top()const {
+    assert(_types.size());
+    return is_sparse() && _types.top() == t_ddo;
+  }
   bool has_deps()const { return _deps; }
   TData const& deps()const { untested(); assert(_deps); return *_deps; }
 }; // RPN_VARS
@@ -425,6 +470,7 @@ public:
 class OUT_EXPRESSION {
   RPN_VARS& s;
   std::string _ctx;
+  Token const* _cse_done{NULL};
 public:
   explicit OUT_EXPRESSION(RPN_VARS& r, std::string ctx)
     : s(r), _ctx(ctx) {}
@@ -437,6 +483,8 @@ private:
     make_cc_expression_(o, e);
     e.pop_back();
   }
+  bool make_cse(std::ostream& o, Token const* t);
+  bool make_hoist(Token const* t);
 };
 /*--------------------------------------------------------------------------*/
 /*--------------------------------------------------------------------------*/
@@ -499,7 +547,9 @@ void OUT_EXPRESSION::make_cc_expression_(std::ostream& o, Expression const& e)
   for (const_iterator i = e.begin(); i != e.end(); ++i) {
     trace3("mg_out_expr loop", (*i)->name(), (*i)->data(), s.size());
 
-    if (auto var = dynamic_cast<const Token_VAR_REF*>(*i)) {
+    if(make_hoist(*i)){
+    }else if(make_cse(o, *i)){
+    }else if (auto var = dynamic_cast<const Token_VAR_REF*>(*i)) {
       s.new_rhs(var); // if linear?
 //    }else if (auto t = dynamic_cast<const Token_OUT_VAR*>(*i)) { untested();
 //      s.new_rhs(t); // if linear?
@@ -547,7 +597,7 @@ void OUT_EXPRESSION::make_cc_expression_(std::ostream& o, Expression const& e)
 	assert(s.have_args());
 	argnames.resize(s.num_args());
 	for(auto n=argnames.begin(); n!=argnames.end(); ++n){
-	  *n = s.code_name();
+	  *n = s.arg_name();
 	  s.pop();
 	}
       }else{ untested();
@@ -591,10 +641,20 @@ void OUT_EXPRESSION::make_cc_expression_(std::ostream& o, Expression const& e)
       if(F->args()) {
 	assert(s.have_args());
 	argnames.resize(s.num_args());
-	for(auto n=argnames.begin(); n!=argnames.end(); ++n){
-	  *n = s.code_name();
+	// math functions are templates. if all arguments have the sparse
+	// type, they take it as is, and so does the result.
+	std::vector<std::string> sparse(argnames.size());
+	bool all_sparse = F->f() && F->f()->is_pure();
+	for(size_t n=0; n<argnames.size(); ++n){
+	  all_sparse &= s.is_sparse_top();
+	  argnames[n] = s.arg_name();
+	  sparse[n] = s.code_name();
 	  s.pop();
 	}
+	if(all_sparse){
+	  argnames = sparse;
+	}else{
+	}
       }else{
       }
 
@@ -636,6 +696,15 @@ void OUT_EXPRESSION::make_cc_expression_(std::ostream& o, Expression const& e)
 	o << ");\n";
 	s.args_pop();
       }
+
+      CSE_TABLE const* cse = CSE_TABLE::active();
+      if(!cse || !s.has_deps()){
+      }else if(F->f()->is_pure()){
+      }else if(dynamic_cast<MGVAMS_FILTER const*>(F->f())){
+      }else{
+	// analog function, may write to output arguments
+	cse->make_invalidate_vars(o);
+      }
     }else if (auto pl=dynamic_cast<const Token_PARLIST_*>(*i)) { untested();
       if(auto se = dynamic_cast<Expression const*>(pl->args())){ untested();
 	o__ "// start parlist\n";
@@ -659,8 +728,10 @@ void OUT_EXPRESSION::make_cc_expression_(std::ostream& o, Expression const& e)
 
       assert((*i)->name().size());
       std::string idy = s.code_name();
+      std::string idy_arg = s.arg_name();
       s.pop();
       std::string arg1 = s.code_name();
+      std::string arg1_arg = s.arg_name();
       s.pop();
       s.new_ddouble(o);
 
@@ -677,7 +748,7 @@ void OUT_EXPRESSION::make_cc_expression_(std::ostream& o, Expression const& e)
 	|| op == '!' ){
 	o__ s.code_name() << " = " << arg1 << " " << (*i)->name() << " " << idy << ";\n";
       }else if(op == '%'){itested();
-	o__ s.code_name() << " = va::fmod(" << arg1 << ", " << idy << ");\n";
+	o__ s.code_name() << " = va::fmod(" << arg1_arg << ", " << idy_arg << ");\n";
       }else{ untested();
 	unreachable();
 	assert(false);
@@ -710,7 +781,12 @@ void OUT_EXPRESSION::make_cc_expression_(std::ostream& o, Expression const& e)
       o__ "{\n";
       {
 	indent y;
-	o__ "ddouble& tt0 = t0;\n"; // BUG: float??
+	HOIST_GUARD g;
+	if(s.is_sparse()){
+	  o__ "auto& tt0 = t0;\n";
+	}else{
+	  o__ "ddouble& tt0 = t0;\n"; // BUG: float??
+	}
 	o__ "if(" << arg1 << "){\n";
 	{
 	  indent x;
@@ -742,16 +818,68 @@ void OUT_EXPRESSION::make_cc_expression_(std::ostream& o, Expression const& e)
   }
 }
 /*--------------------------------------------------------------------------*/
-void make_cc_expression(std::ostream& o, Expression const& e, bool dynamic,
-    std::string ctx)
+// optimize-cse. true if t has been taken care of.
+bool OUT_EXPRESSION::make_cse(std::ostream& o, Token const* t)
 {
-  TData const* deps = NULL;
-  if(!dynamic){
-  }else if(auto ex = dynamic_cast<Expression_ const*>(&e)){
-    deps = &ex->data();
-  }else{ untested();
+  CSE_TABLE* cse = CSE_TABLE::active();
+  int k = -1;
+  if(!cse || !s.has_deps()){
+    return false;
+  }else if(t == _cse_done){
+    _cse_done = NULL;
+    return false;
+  }else if(cse->is_counting()){
+    if(cse->count(t, s.ddouble_type())){
+      // computed before. operands do not count.
+      cse->mute(1);
+      _cse_done = t;
+      make_cc_expression_(o, t);
+      cse->mute(-1);
+      return true;
+    }else{
+      return false;
+    }
+  }else if((k = cse->slot(t)) < 0){
+    return false;
+  }else{
+    o__ "if(!cse" << k << "_ok){\n";
+    {
+      indent x;
+      _cse_done = t;
+      make_cc_expression_(o, t);
+      if(cse->type(k) == s.ddouble_type()){
+	// same sparse type everywhere, no conversion
+	o__ "cse" << k << " = " << s.code_name() << ";\n";
+      }else{
+	o__ "cse" << k << " = " << s.arg_name() << ";\n";
+      }
+      o__ "cse" << k << "_ok = true;\n";
+    }
+    o__ "}else{\n";
+    o____ s.code_name() << " = cse" << k << ";\n";
+    o__ "}\n";
+    return true;
   }
-  RPN_VARS s(deps);
+}
+/*--------------------------------------------------------------------------*/
+// optimize-hoist. true if t has been taken care of.
+bool OUT_EXPRESSION::make_hoist(Token const* t)
+{
+  HOIST_TABLE* h = HOIST_TABLE::active();
+  std::string n;
+  if(!h || !s.has_deps()){
+    return false;
+  }else if((n = h->read(t)).empty()){
+    return false;
+  }else{
+    s.new_ref(n);
+    return true;
+  }
+}
+/*--------------------------------------------------------------------------*/
+static void make_cc_expression(std::ostream& o, RPN_VARS& s, Expression const& e,
+    std::string ctx)
+{
   OUT_EXPRESSION ex(s, ctx);
   ex.make_cc_expression_(o, e);
 
@@ -764,6 +892,426 @@ void make_cc_expression(std::ostream& o, Expression const& e, bool dynamic,
   s.pop();
 }
 /*--------------------------------------------------------------------------*/
+void make_cc_expression(std::ostream& o, Expression const& e, bool dynamic,
+    std::string ctx)
+{
+  TData const* deps = NULL;
+  if(!dynamic){
+  }else if(auto ex = dynamic_cast<Expression_ const*>(&e)){
+    deps = &ex->data();
+  }else{ untested();
+  }
+
+  if(deps && CSE_TABLE::active()){
+    // temporaries may be first used in a conditional block.
+    std::ostringstream decl;
+    std::ostringstream body;
+    RPN_VARS s(deps, &decl);
+    make_cc_expression(body, s, e, ctx);
+    o << decl.str() << body.str();
+  }else{
+    RPN_VARS s(deps);
+    make_cc_expression(o, s, e, ctx);
+  }
+}
+/*--------------------------------------------------------------------------*/
+CSE_TABLE* CSE_TABLE::_active;
+/*--------------------------------------------------------------------------*/
+CSE_TABLE::CSE_TABLE()
+{
+  assert(!_active);
+  _active = this;
+}
+/*--------------------------------------------------------------------------*/
+CSE_TABLE::~CSE_TABLE()
+{
+  assert(_active == this);
+  _active = NULL;
+}
+/*--------------------------------------------------------------------------*/
+// identifies the value of t within one call. false if t may have side
+// effects, or is not worth it.
+bool CSE_TABLE::key(Token const* t, std::string* k, std::set<std::string>* vars,
+    size_t* size)const
+{
+  assert(t);
+  if(auto v = dynamic_cast<Token_VAR_REF const*>(t)){
+    // another block may have its own variable by that name.
+    std::stringstream tmp;
+    tmp << "V(" << v->code_name() << "@" << v->scope() << ")";
+    *k += tmp.str();
+    vars->insert(v->code_name());
+  }else if(auto p = dynamic_cast<Token_PAR_REF const*>(t)){
+    *k += "P(" + (*p)->code_name() + ")";
+  }else if(auto a = dynamic_cast<Token_ACCESS const*>(t)){
+    *k += "A(" + a->code_name_() + ")";
+  }else if(auto c = dynamic_cast<Token_CONSTANT const*>(t)){
+    if(auto f = dynamic_cast<Float const*>(c->data())){
+      *k += std::string("C(") + ftos_(f->value(), 0, 20, ftos_EXP) + ")";
+    }else{
+      return false;
+    }
+  }else if(auto b = dynamic_cast<Token_BINOP_ const*>(t)){
+    *k += "(";
+    if(!key(b->op1(), k, vars, size)){
+      return false;
+    }else{
+    }
+    *k += b->name();
+    if(!key(b->op2(), k, vars, size)){
+      return false;
+    }else{
+    }
+    *k += ")";
+    ++*size;
+  }else if(auto u = dynamic_cast<Token_UNARY_ const*>(t)){
+    *k += u->name() + "(";
+    if(!key(u->op1(), k, vars, size)){
+      return false;
+    }else{
+    }
+    *k += ")";
+    ++*size;
+  }else if(auto F = dynamic_cast<Token_CALL const*>(t)){
+    if(!F->f()){ untested();
+      return false;
+    }else if(!F->f()->is_pure() || F->returns_void() || F->has_modes()){
+      return false;
+    }else if(!F->args()){ untested();
+      return false;
+    }else{
+      *k += F->code_name() + "(";
+      for(Token const* a : *F->args()){
+	if(!key(a, k, vars, size)){
+	  return false;
+	}else{
+	}
+	*k += ",";
+      }
+      *k += ")";
+      ++*size;
+    }
+  }else{
+    return false;
+  }
+  return true;
+}
+/*--------------------------------------------------------------------------*/
+static bool is_cse_candidate(Token const* t)
+{
+  return dynamic_cast<Token_BINOP_ const*>(t)
+      || dynamic_cast<Token_CALL const*>(t);
+}
+/*--------------------------------------------------------------------------*/
+// pass one. true if t has been counted before.
+// type: the temporaries in the expression containing t.
+bool CSE_TABLE::count(Token const* t, std::string const& type)
+{
+  assert(_counting);
+  std::string k;
+  std::set<std::string> vars;
+  size_t size = 0;
+  if(_mute){
+    return false;
+  }else if(!is_cse_candidate(t)){
+    return false;
+  }else if(!key(t, &k, &vars, &size)){
+    return false;
+  }else{
+  }
+
+  auto i = _index.find(k);
+  if(i == _index.end()){
+    ENTRY e;
+    e.count = 1;
+    e.size = size;
+    e.vars = vars;
+    e.type = type;
+    {
+      std::stringstream tmp;
+      Expression_ x;
+      x.push_back(const_cast<Token*>(t));
+      x.dump(tmp);
+      x.pop_back();
+      e.text = tmp.str();
+    }
+    _index[k] = _e.size();
+    _e.push_back(e);
+    return false;
+  }else{
+    ENTRY& e = _e[i->second];
+    ++e.count;
+    if(e.type != type){
+      // sparse types differ, keep all derivatives.
+      e.type = "ddouble";
+    }else{
+    }
+    return true;
+  }
+}
+/*--------------------------------------------------------------------------*/
+// pass two. the local holding t, -1 if none.
+int CSE_TABLE::slot(Token const* t)const
+{
+  assert(!_counting);
+  std::string k;
+  std::set<std::string> vars;
+  size_t size = 0;
+  if(!is_cse_candidate(t)){
+    return -1;
+  }else if(!key(t, &k, &vars, &size)){
+    return -1;
+  }else{
+    auto i = _index.find(k);
+    if(i == _index.end()){ untested();
+      return -1;
+    }else{
+      return _e[i->second].slot;
+    }
+  }
+}
+/*--------------------------------------------------------------------------*/
+void CSE_TABLE::start_emit()
+{
+  assert(_counting);
+  _counting = false;
+  for(auto& e : _e){
+    if(e.count > 1){
+      e.slot = _slots++;
+    }else{
+    }
+  }
+}
+/*--------------------------------------------------------------------------*/
+std::string const& CSE_TABLE::type(int k)const
+{
+  for(auto const& e : _e){
+    if(e.slot == k){
+      return e.type;
+    }else{
+    }
+  }
+  unreachable();
+  return _e.front().type;
+}
+/*--------------------------------------------------------------------------*/
+void CSE_TABLE::make_decl(std::ostream& o)const
+{
+  for(auto const& e : _e){
+    if(e.slot < 0){
+    }else{
+      o__ e.type << " cse" << e.slot << ";\n";
+      o__ "bool cse" << e.slot << "_ok = false;\n";
+    }
+  }
+}
+/*--------------------------------------------------------------------------*/
+// var has been written to
+void CSE_TABLE::make_invalidate(std::ostream& o, std::string const& var)const
+{
+  for(auto const& e : _e){
+    if(e.slot < 0){
+    }else if(e.vars.count(var)){
+      o__ "cse" << e.slot << "_ok = false;\n";
+    }else{
+    }
+  }
+}
+/*--------------------------------------------------------------------------*/
+// any variable may have been written to
+void CSE_TABLE::make_invalidate_vars(std::ostream& o)const
+{
+  for(auto const& e : _e){
+    if(e.slot < 0){
+    }else if(e.vars.size()){
+      o__ "cse" << e.slot << "_ok = false;\n";
+    }else{
+    }
+  }
+}
+/*--------------------------------------------------------------------------*/
+void CSE_TABLE::make_report(std::ostream& o)const
+{
+  size_t n = 0;
+  size_t nodes = 0;
+  for(auto const& e : _e){
+    if(e.count > 1){
+      o__ "// cse: " << e.text << " x" << e.count << "\n";
+      ++n;
+      nodes += (e.count - 1) * e.size;
+    }else{
+    }
+  }
+  o__ "// cse: " << n << " subexpressions, " << nodes << " nodes eliminated\n";
+}
+/*--------------------------------------------------------------------------*/
+HOIST_TABLE* HOIST_TABLE::_active;
+/*--------------------------------------------------------------------------*/
+HOIST_TABLE::HOIST_TABLE()
+{
+  assert(!_active);
+  _active = this;
+}
+/*--------------------------------------------------------------------------*/
+HOIST_TABLE::~HOIST_TABLE()
+{
+  assert(_active == this);
+  _active = NULL;
+}
+/*--------------------------------------------------------------------------*/
+// identifies the value of t after precalc. false if it may change later.
+// reads counts parameters and calls.
+bool HOIST_TABLE::key(Token const* t, std::string* k, bool* dev, size_t* reads)const
+{
+  assert(t);
+  if(auto p = dynamic_cast<Token_PAR_REF const*>(t)){
+    *k += "P(" + (*p)->code_name() + ")";
+    ++*reads;
+  }else if(auto c = dynamic_cast<Token_CONSTANT const*>(t)){
+    if(auto f = dynamic_cast<Float const*>(c->data())){
+      *k += std::string("C(") + ftos_(f->value(), 0, 20, ftos_EXP) + ")";
+    }else{
+      return false;
+    }
+  }else if(auto b = dynamic_cast<Token_BINOP_ const*>(t)){
+    *k += "(";
+    if(!key(b->op1(), k, dev, reads)){
+      return false;
+    }else{
+    }
+    *k += b->name();
+    if(!key(b->op2(), k, dev, reads)){
+      return false;
+    }else{
+    }
+    *k += ")";
+  }else if(auto u = dynamic_cast<Token_UNARY_ const*>(t)){
+    *k += u->name() + "(";
+    if(!key(u->op1(), k, dev, reads)){
+      return false;
+    }else{
+    }
+    *k += ")";
+  }else if(auto F = dynamic_cast<Token_CALL const*>(t)){
+    if(!F->f()){ untested();
+      return false;
+    }else if(!F->f()->is_fixed() || F->returns_void() || F->has_modes()){
+      return false;
+    }else if(F->is_common()){ untested();
+      return false;
+    }else{
+      *dev |= F->f()->is_fixed_dev();
+      ++*reads;
+      *k += F->code_name() + "(";
+      if(F->args()){
+	for(Token const* a : *F->args()){
+	  if(!key(a, k, dev, reads)){
+	    return false;
+	  }else{
+	  }
+	  *k += ",";
+	}
+      }else{
+      }
+      *k += ")";
+    }
+  }else{
+    return false;
+  }
+  return true;
+}
+/*--------------------------------------------------------------------------*/
+// the cached value of t, as read in tr_eval_analog. empty if none.
+std::string HOIST_TABLE::read(Token const* t)
+{
+  std::string k;
+  bool dev = false;
+  size_t reads = 0;
+  if(!_reading || _guard){
+    return "";
+  }else if(!_collecting && _e.empty()){
+    return "";
+  }else if(!dynamic_cast<Token_BINOP_ const*>(t)
+        && !dynamic_cast<Token_CALL const*>(t)){
+    return "";
+  }else if(!key(t, &k, &dev, &reads)){
+    return "";
+  }else if(!reads){
+    // constant. up to the compiler.
+    return "";
+  }else{
+  }
+
+  size_t n;
+  auto i = _index.find(k);
+  if(i != _index.end()){
+    n = i->second;
+  }else if(_collecting){
+    ENTRY e;
+    e.t = t;
+    e.dev = dev;
+    {
+      std::stringstream tmp;
+      Expression_ x;
+      x.push_back(const_cast<Token*>(t));
+      x.dump(tmp);
+      x.pop_back();
+      e.text = tmp.str();
+    }
+    n = _e.size();
+    _index[k] = n;
+    _e.push_back(e);
+  }else{ untested();
+    return "";
+  }
+
+  if(_collecting){
+    ++_e[n].count;
+  }else{
+  }
+  return std::string(_e[n].dev ? "d->" : "") + "_hoist" + std::to_string(n);
+}
+/*--------------------------------------------------------------------------*/
+void HOIST_TABLE::make_decl(std::ostream& o, bool dev)const
+{
+  for(size_t n = 0; n < _e.size(); ++n){
+    if(_e[n].dev == dev){
+      o__ "double _hoist" << n << "{NOT_VALID}; // " << _e[n].text << "\n";
+    }else{
+    }
+  }
+}
+/*--------------------------------------------------------------------------*/
+void HOIST_TABLE::make_precalc(std::ostream& o, bool dev)const
+{
+  for(size_t n = 0; n < _e.size(); ++n){
+    if(_e[n].dev == dev){
+      o__ "{ // hoist: " << _e[n].text << "\n";
+      {
+	indent x;
+	Expression_ e;
+	e.push_back(const_cast<Token*>(_e[n].t));
+	make_cc_expression(o, e, false, "precalc");
+	e.pop_back();
+	o__ (dev ? "d->" : "") << "_hoist" << n << " = t0.value();\n";
+      }
+      o__ "}\n";
+    }else{
+    }
+  }
+}
+/*--------------------------------------------------------------------------*/
+void HOIST_TABLE::make_report(std::ostream& o)const
+{
+  size_t reads = 0;
+  for(auto const& e : _e){
+    o__ "// hoist: " << e.text << " x" << e.count
+      << (e.dev ? " (instance)" : " (common)") << "\n";
+    reads += e.count;
+  }
+  o__ "// hoist: " << _e.size() << " subexpressions, " << reads << " reads\n";
+}
+/*--------------------------------------------------------------------------*/
 /*--------------------------------------------------------------------------*/
 /*--------------------------------------------------------------------------*/
 // vim:ts=8:sw=2:noet
@@ -313,6 +313,8 @@ static void make_common(std::ostream& o, const Module& m)
   o__ "COMMON_COMPONENT* clone()const override {return new "<<class_name<<"(*this);}\n";
   o__ "void     set_param_by_index(int, std::string&, int)override;\n";
   o__ "aidx     set_param_by_name(std::string, std::string)override;\n";
+  o__ "static int param_index(char const*, size_t);\n";
+  o__ "aidx     set_param_at(int, std::string const&, std::string const&);\n";
   o__ "bool     is_valid()const;\n";
   o__ "bool     param_is_printable(int)const override;\n";
   o__ "std::string param_name(int)const override;\n";
@@ -326,6 +328,20 @@ static void make_common(std::ostream& o, const Module& m)
   o__ "void precalc_last(const CARD_LIST*)override;\n";
   // if has_analog?
   o__ "void tr_eval_analog(MOD_" << m.identifier() << "*)const;\n";
+  if(options().optimize_intern()){
+    o__ "void precalc_params(const CARD_LIST*);\n";
+    o__ "void precalc_derived();\n";
+    o__ "size_t   hash()const;\n";
+    o__ "COMMON_" << m.identifier() << "* intern(const CARD_LIST*);\n";
+    o__ "void     reintern();\n";
+    o__ "static VA_COMMON_POOL& pool() {\n";
+    o____ "static VA_COMMON_POOL p;\n";
+    o____ "return p;\n";
+    o__ "}\n";
+    o__ "VA_POOLED _pooled; // in pool()\n";
+    o__ "bool     _precalc_pending{false}; // precalc_last, once per pass\n";
+  }else{
+  }
   if(m.has_tr_review() && m.has_analog_block()){
     o__ "void tr_review_analog(MOD_" << m.identifier() << "*)const;\n";
   }else{
@@ -348,6 +364,10 @@ static void make_common(std::ostream& o, const Module& m)
   }else{
   }
   o__ "void precalc_analog(MOD_" << m.identifier() << "*)const;\n";
+  if(HOIST_TABLE const* h = HOIST_TABLE::active()){
+    h->make_decl(o, false);
+  }else{
+  }
   o__ "std::string name()const override {itested();return \"" << m.identifier() << "\";}\n";
 //    "  const SDP_CARD* sdp()const {return _sdp;}\n"
 //    "  bool     has_sdp()const {untested();return _sdp;}\n"
@@ -515,7 +535,12 @@ static void make_module(std::ostream& o, const Module& m)
   std::string base_name = baseclass(m);
   std::string common_name = "COMMON_" + m.identifier().to_string();
   std::string precalc_name = "PRECALC_" + m.identifier().to_string();
-  o << "class " << class_name << " : public " << base_name << " {\n";
+  o << "class " << class_name << " : public " << base_name;
+  if(options().gen_profile() || options().optimize_bypass()){
+    o << ", public VA_PROFILED";
+  }else{
+  }
+  o << " {\n";
   o << "private:\n";
   o__ "static int _count;\n";
  // o__ "bool _eval{false};\n";
@@ -525,6 +550,35 @@ static void make_module(std::ostream& o, const Module& m)
   }
   o << "public:\n";
   declare_ddouble(o, m);
+  if(options().gen_profile()){
+    o__ "static va::PROFILE _prof;\n";
+  }else{
+  }
+  if(options().optimize_bypass()){
+    o__ "static va::BYPASS_COUNT _bypass;\n";
+  }else{
+  }
+  if(options().optimize_batch() && m.has_analog_block()){
+    // per model, commons are usually per instance
+    o__ "static std::vector<" << class_name << "*> _batch; // queued in do_tr\n";
+    o__ "static decltype(_sim->iteration_tag()) _batch_tag; // of _batch\n";
+    o__ "static size_t _batch_size; // last batch evaluated\n";
+    o__ "static size_t _batch_pool; // of which run on the va_eval pool\n";
+  }else{
+  }
+  if(options().gen_profile() || options().optimize_bypass()){
+    o__ "void prof_clear()const override {\n";
+    if(options().gen_profile()){
+      o____ "_prof.clear();\n";
+    }else{
+    }
+    if(options().optimize_bypass()){
+      o____ "_bypass.clear();\n";
+    }else{
+    }
+    o__ "}\n";
+  }else{
+  }
   o << "private: // data\n";
   size_t total_nodes = m.circuit()->nodes().size();
   o__ "node_t _nodes[" << total_nodes << "];\n";
@@ -533,13 +587,32 @@ static void make_module(std::ostream& o, const Module& m)
     o__ "TIME_PAIR _time_by;\n";
   }else{
   }
+  if(options().optimize_bypass()){
+    o__ "mutable double _bypass_time{NOT_VALID}; // last evaluation\n";
+    o__ "bool bypass_(bool eval)const {\n";
+    o____ "if(eval){\n";
+    o______ "_bypass_time = _sim->_time0;\n";
+    o____ "}else{\n";
+    o____ "}\n";
+    o____ "return _bypass(eval);\n";
+    o__ "}\n";
+  }else{
+  }
+  if(HOIST_TABLE const* h = HOIST_TABLE::active()){
+    h->make_decl(o, true);
+  }else{
+  }
   o << "public: // netlist\n";
   if(m.circuit()->element_list().size()){
     make_cc_elements(o, m.circuit()->element_list());
   }else{
   }
+  bool fused = false;
   for (auto br : m.circuit()->branches()){
-    if(br->is_filter()){
+    if(is_fused(*br)){
+      o__ "// fused : " << br->code_name() << "\n";
+      fused = true;
+    }else if(br->is_filter()){
       if(!br->is_used() && options().optimize_unused()){
 	o__ "// ELEMENT* " << br->code_name() << "{NULL}; // unused filter\n";
       }else{
@@ -555,6 +628,10 @@ static void make_module(std::ostream& o, const Module& m)
       o__ "// ELEMENT* " << br->code_name() << "{NULL}; // no element (not used)\n";
     }
   }
+  if(fused){
+    o__ "ELEMENT* _fused{NULL}; // va_fused\n";
+  }else{
+  }
   o << "private: // func decl\n";
   make_func_dev(o, m.funcs());
   o << "private: // construct\n";
@@ -574,6 +651,8 @@ static void make_module(std::ostream& o, const Module& m)
 
   if(m.has_hsparam()){
     o__ "aidx     set_param_by_name(std::string, std::string)override;\n";
+    o__ "static int param_index(char const*, size_t);\n";
+    o__ "aidx     set_param_at(int, std::string const&, std::string const&);\n";
   }else{
   }
   o__ "bool is_valid()const override;\n";
@@ -641,6 +720,10 @@ static void make_module(std::ostream& o, const Module& m)
     o__ "void      tr_queue_eval()override {if(tr_needs_eval()){q_eval();}else{} }\n";
    //  o__ "void q_eval() { COMPONENT::q_eval(); }\n";
     o__ "bool      do_tr() override;\n";
+    if(options().optimize_batch()){
+      o__ "bool      do_tr_last() override;\n";
+    }else{
+    }
 //    o__ "void      ac_begin() override;\n";
 //    o__ " void    do_ac();\n";
   }
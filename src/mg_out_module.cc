@@ -22,8 +22,10 @@
 #include "mg_func.h"
 #include "mg_circuit.h"
 #include "mg_token.h"
+#include "mg_options.h"
 #include <stack>
 #include <numeric> // iota
+#include <algorithm>
 #include "mg_.h" // TODO
 /*--------------------------------------------------------------------------*/
 static String_Arg const& potential_abstol(Branch const& b)
@@ -88,9 +90,19 @@ static void make_cc_branch_output(std::ostream& o, Branch const* br)
 void make_cc_branch_ctrl(std::ostream& o, Branch const* br);
 void make_cc_current_ports(std::ostream& o, Branch const* br, Element_2 const&);
 /*--------------------------------------------------------------------------*/
+// gen-profile: time the rest of the enclosing block.
+void make_prof_scope(std::ostream& o, Module const& m, char const* what)
+{
+  if(options().gen_profile()){
+    o__ "va::PROF_SCOPE prof_(MOD_" << m.identifier() << "::_prof[va::" << what << "]);\n";
+  }else{
+  }
+}
+/*--------------------------------------------------------------------------*/
 static void make_tr_needs_eval(std::ostream& o, const Module& m)
 {
   o << "bool MOD_" << m.identifier() << "::tr_needs_eval()const\n{\n";
+  make_prof_scope(o, m, "PROF_NEEDS_EVAL");
   o__ "trace3(\"" << m.identifier() <<"::needs_eval?\", long_label(), _sim->_time0, has_probes());\n";
   o__ "node_t gnd(&ground_node);\n";
   o__ "if (is_q_for_eval()) {\n";
@@ -139,6 +151,73 @@ static void make_tr_needs_eval(std::ostream& o, const Module& m)
       "------------------------------------*/\n";
 }
 /*--------------------------------------------------------------------------*/
+// optimize-bypass. evaluate only if an input read during the last evaluation
+// moved beyond tolerance. Otherwise the previous stamp remains loaded.
+// Parameter changes go through precalc_last, which sets not converged.
+static void make_tr_needs_eval_bypass(std::ostream& o, const Module& m)
+{
+  o << "bool MOD_" << m.identifier() << "::tr_needs_eval()const\n{\n";
+  make_prof_scope(o, m, "PROF_NEEDS_EVAL");
+  o__ "trace3(\"" << m.identifier() <<"::needs_eval?\", long_label(), _sim->_time0, has_probes());\n";
+  o__ "node_t gnd(&ground_node);\n";
+  o__ "if (is_q_for_eval()) {\n";
+  o____ "return false;\n";
+  o__ "}else if (!converged()) {\n";
+  o____ "return bypass_(true);\n";
+  o__ "}else if (has_probes()) {\n";
+  o____ "return bypass_(true);\n";
+  o__ "}else";
+
+  for(auto br : m.circuit()->branches()) {
+    assert(br);
+    if(br->is_short()) {
+    }else if(br->is_filter()) {
+      // see needs_eval_cond
+    }else{
+      if(br->has_pot_probe()) {
+	o << " if( !conchk(_potential"<< br->code_name() << ", ";
+	make_node_ref(o, *br->p());
+	o << ".v0() - ";
+	make_node_ref(o, *br->n());
+	o << ".v0(), ";
+	o << potential_abstol(*br) << ")){\n";
+	o____ "return bypass_(true);\n" <<ind<<"}else";
+      }else{
+      }
+      if(br->has_flow_probe()) {
+	o << " if( " << br->code_name() << " && !conchk(_flow"<< br->code_name() << ", "
+	  <<  br->code_name() << "->tr_amps(), ";
+	o << flow_abstol(*br) << ")) {\n";
+	o____ "return bypass_(true);\n" <<ind<<"}else";
+      }else{
+      }
+    }
+  }
+
+  std::vector<std::string> conds;
+  if(m.has_events() || m.times()){
+    // event and step driven state
+    conds.push_back("_sim->_time0 != _bypass_time");
+  }else{
+  }
+  for(auto f : m.funcs()){
+    std::string c = f->needs_eval_cond();
+    if(c == ""){
+    }else if(std::find(conds.begin(), conds.end(), c) != conds.end()){
+    }else{
+      conds.push_back(c);
+      o << " if(" << c << "){\n";
+      o____ "return bypass_(true);\n" <<ind<<"}else";
+    }
+  }
+  o << "{\n";
+  o____ "return bypass_(false);\n";
+  o__ "}\n";
+  o << "};\n"
+      "/*--------------------------------------"
+      "------------------------------------*/\n";
+}
+/*--------------------------------------------------------------------------*/
 // DUP in code.cc
 static bool is_output_var(tag_t t)
 {
@@ -176,6 +255,44 @@ static void make_tr_probe_num(std::ostream& o, const Module& m)
   o__ "if(n == \"conv\") {\n";
   o____ "return converged();\n";
   o__ "}\n";
+  if(options().gen_profile()){
+    static char const* prof[][2] = {
+      {"eval", "PROF_EVAL"}, {"probes", "PROF_PROBES"},
+      {"needs_eval", "PROF_NEEDS_EVAL"}, {"review", "PROF_REVIEW"},
+      {"accept", "PROF_ACCEPT"}, {"precalc", "PROF_PRECALC"}};
+    for(auto const& p : prof){
+      o__ "if(n == \"prof." << p[0] << "_ns\") {\n";
+      o____ "return _prof[va::" << p[1] << "].ns();\n";
+      o__ "}else if(n == \"prof." << p[0] << "_calls\") {\n";
+      o____ "return _prof[va::" << p[1] << "].calls();\n";
+      o__ "}\n";
+    }
+  }else{
+  }
+  if(options().optimize_intern()){
+    o__ "if(n == \"intern.commons\") {\n";
+    o____ "return double(COMMON_" << m.identifier() << "::pool().size());\n";
+    o__ "}\n";
+  }else{
+  }
+  if(options().optimize_batch() && m.has_analog_block()){
+    o__ "if(n == \"batch.size\") {\n";
+    o____ "return double(_batch_size);\n";
+    o__ "}else if(n == \"batch.pool\") {\n";
+    o____ "return double(_batch_pool);\n";
+    o__ "}\n";
+  }else{
+  }
+  if(options().optimize_bypass()){
+    o__ "if(n == \"bypass.hits\") {\n";
+    o____ "return _bypass.hits();\n";
+    o__ "}else if(n == \"bypass.evals\") {\n";
+    o____ "return _bypass.evals();\n";
+    o__ "}else if(n == \"bypass.rate\") {\n";
+    o____ "return _bypass.rate();\n";
+    o__ "}\n";
+  }else{
+  }
   o__ "return " <<  baseclass(m) << "::tr_probe_num(n);\n";
   o << "}\n"
     "/*--------------------------------------"
@@ -390,8 +507,104 @@ void make_module_default_constructor(std::ostream& o, const Module& m)
     "------------------------------------*/\n";
 }
 /*--------------------------------------------------------------------------*/
+// tr_eval_analog writes to the instance only, and reads _sim.
+static bool is_reentrant(const Module& m)
+{
+  if(m.has_events()){
+    return false;
+  }else{
+  }
+  for(FUNCTION_ const* f : m.funcs()){
+    assert(f);
+    if(!f->is_reentrant()){
+      return false;
+    }else if(f->has_set_event()){ untested();
+      return false;
+    }else{
+    }
+  }
+  return true;
+}
+/*--------------------------------------------------------------------------*/
+// queue this instance with the others of its model type. the first one
+// queued evaluates all of them from the late evalq, one phase at a time.
+// a batch left over from an iteration that did not reach do_tr_last is
+// dropped.
+static void make_do_tr_batch(std::ostream& o, const Module& m)
+{
+  std::string mod = "MOD_" + m.identifier().to_string();
+  std::string common = "COMMON_" + m.identifier().to_string();
+  o << "bool " << mod << "::do_tr()\n{\n";
+  o__ "trace3(\"" << m.identifier() <<"::do_tr\", this, long_label(), _sim->iteration_number());\n";
+  o__ "if(_batch_tag != _sim->iteration_tag()){\n";
+  o____ "_batch.clear();\n";
+  o____ "_batch_tag = _sim->iteration_tag();\n";
+  o__ "}else{\n";
+  o__ "}\n";
+  o__ "if(_batch.empty()){\n";
+  o____ "_sim->_late_evalq.push_back(this);\n";
+  o__ "}else{\n";
+  o__ "}\n";
+  o__ "_batch.push_back(this);\n";
+  o__ "return true;\n";
+  o << "}\n"
+    "/*--------------------------------------"
+    "------------------------------------*/\n";
+  o << "bool " << mod << "::do_tr_last()\n{\n";
+  o__ "if(_batch.empty() || _batch.front() != this){ untested();\n";
+  o____ "// stale entry\n";
+  o____ "return converged();\n";
+  o__ "}else{\n";
+  o__ "}\n";
+  o__ "_batch_size = _batch.size();\n";
+  o__ "for(" << mod << "* d : _batch){\n";
+  o____ "d->clear_branch_contributions();\n";
+  o____ "d->read_probes();\n";
+  o____ "d->set_converged();\n";
+  o__ "}\n";
+  if(is_reentrant(m)){
+    o__ "// looked up per batch. va_eval may be attached later, or go.\n";
+    o__ "VA_EVAL_POOL* pool = dynamic_cast<VA_EVAL_POOL*>(command_dispatcher[\"va_eval\"]);\n";
+    o__ "if(pool && _batch.size() > 1){\n";
+    o____ "_batch_pool = _batch.size();\n";
+    o____ "struct task : VA_EVAL_POOL::TASK {\n";
+    o______ "void operator()(size_t i)const override {\n";
+    o________ mod << "* d = _batch[i];\n";
+    o________ "prechecked_cast<" << common << " const*>(d->common())->tr_eval_analog(d);\n";
+    o______ "}\n";
+    o____ "} t;\n";
+    o____ "pool->run(t, _batch.size());\n";
+    o__ "}else{\n";
+    o____ "_batch_pool = 0;\n";
+    o____ "for(" << mod << "* d : _batch){\n";
+    o______ "prechecked_cast<" << common << " const*>(d->common())->tr_eval_analog(d);\n";
+    o____ "}\n";
+    o__ "}\n";
+  }else{
+    o__ "for(" << mod << "* d : _batch){\n";
+    o____ "prechecked_cast<" << common << " const*>(d->common())->tr_eval_analog(d);\n";
+    o__ "}\n";
+  }
+  o__ "bool conv = true;\n";
+  o__ "for(" << mod << "* d : _batch){\n";
+  o____ "d->set_branch_contributions();\n";
+  o____ "assert(d->subckt());\n";
+  o____ "d->set_converged(d->subckt()->do_tr() && d->converged());\n";
+  o____ "conv = d->converged() && conv;\n";
+  o__ "}\n";
+  o__ "_batch.clear();\n";
+  o__ "return conv;\n";
+  o << "}\n"
+    "/*--------------------------------------"
+    "------------------------------------*/\n";
+}
+/*--------------------------------------------------------------------------*/
 static void make_do_tr(std::ostream& o, const Module& m)
 {
+  if(options().optimize_batch()){
+    return make_do_tr_batch(o, m);
+  }else{
+  }
   o << "bool MOD_" << m.identifier() << "::do_tr()\n{\n";
   o__ "trace3(\"" << m.identifier() <<"::do_tr\", this, long_label(), _sim->iteration_number());\n";
   o__ "clear_branch_contributions();\n";
@@ -547,6 +760,7 @@ static void make_tr_regress(std::ostream& o, const Module& m)
 static void make_tr_review(std::ostream& o, const Module& m)
 {
   o << "inline TIME_PAIR MOD_" << m.identifier() << "::tr_review()\n{\n";
+  make_prof_scope(o, m, "PROF_REVIEW");
 #if 0
   if(m.has_analysis()){ untested();
     o << "if(_sim->analysis_is_tran_static()){ untested();\n";
@@ -583,6 +797,7 @@ static void make_tr_review(std::ostream& o, const Module& m)
 static void make_tr_accept(std::ostream& o, const Module& m)
 {
   o << "inline void MOD_" << m.identifier() << "::tr_accept()\n{\n";
+  make_prof_scope(o, m, "PROF_ACCEPT");
   o__ "trace1(\"" << m.identifier() <<"::tr_accept\", _sim->_time0);\n";
 
   o__ "COMMON_" << m.identifier() << " const* c = "
@@ -636,6 +851,7 @@ static void make_tr_eval_branches(std::ostream& o, const Module& m)
 static void make_read_probes(std::ostream& o, const Module& m)
 {
   o << "inline void MOD_" << m.identifier() << "::read_probes()\n{\n";
+  make_prof_scope(o, m, "PROF_PROBES");
   o__ "trace0(\"" << m.identifier() <<"::read_probes\");\n";
   // o__ "node_t gnd;\n";
   // o__ "gnd.set_to_ground(this);\n";
@@ -718,7 +934,11 @@ static void make_module_class(std::ostream& o, Module const& m)
     "/*--------------------------------------"
     "------------------------------------*/\n";
   if(m.has_analog_block()){
-    make_tr_needs_eval(o, m);
+    if(options().optimize_bypass()){
+      make_tr_needs_eval_bypass(o, m);
+    }else{
+      make_tr_needs_eval(o, m);
+    }
     make_tr_eval_branches(o, m);
     make_do_tr(o, m);
     make_cc_analog(o, m);
@@ -928,6 +1148,85 @@ static void make_module_expand_one_branch(std::ostream& o, const Element_2& e, M
   o__ "}\n";
 }
 /*--------------------------------------------------------------------------*/
+// optimize-fuse. plain flow branches, stamped by a single va_fused.
+bool is_fused(Branch const& b)
+{
+  if(!options().optimize_fuse()){
+    return false;
+  }else if(!b.is_used() || !b.has_element()){
+    return false;
+  }else if(b.is_filter() || b.is_short() || !b.omit().empty()){
+    return false;
+  }else if(b.dev_type() != "va_flow" || b.output() != &b){
+    return false;
+  }else if(b.num_nodes() != 2 * (b.num_states() - 1)){
+    // current ports
+    return false;
+  }else{
+  }
+  for(auto i : b.ddeps()){
+    if(i->is_flow_probe()){
+      return false;
+    }else{
+    }
+  }
+  return true;
+}
+/*--------------------------------------------------------------------------*/
+static void make_module_expand_fused(std::ostream& o, Module const& m)
+{
+  bool any = false;
+  for(auto i: m.circuit()->branches()){
+    any |= is_fused(*i);
+  }
+  if(!any){
+    return;
+  }else{
+  }
+
+  make_tag(o);
+  o__ "// fused branches\n";
+  o__ "if (!_fused) {\n";
+  o____ "const CARD* p = device_dispatcher[\"va_fused\"];\n";
+  o____ "if(!p){\n";
+  o______ "throw Exception(\"Cannot find va_fused. Load module?\");\n";
+  o____ "}else{\n";
+  o____ "}\n";
+  o____ "_fused = dynamic_cast<ELEMENT*>(p->clone());\n";
+  o____ "if(!dynamic_cast<VA_FUSED*>(_fused)){\n";
+  o______ "throw Exception(\"Cannot use va_fused: wrong type\");\n";
+  o____ "}else{\n";
+  o____ "}\n";
+  o____ "_fused->set_label(\"_fused\");\n";
+  o____ "_fused->set_owner(this);\n";
+  o____ "subckt()->push_front(_fused);\n";
+  o__ "}else{\n";
+  o__ "}\n";
+  o__ "auto fused = dynamic_cast<VA_FUSED*>(_fused);\n";
+  o__ "assert(fused);\n";
+  o__ "fused->clear_branches();\n";
+}
+/*--------------------------------------------------------------------------*/
+static void make_module_fuse_one_branch(std::ostream& o, Branch const& b)
+{
+  make_tag(o);
+  assert(is_fused(b));
+  o__ "{\n";
+  o____ "node_t nodes[] = {";
+  make_cc_branch_output(o, &b);
+  make_cc_branch_ctrl(o, &b);
+  o << "}; // nodes\n";
+  o____ "fused->add_branch(";
+  if (b.discipline()) {
+    o << "&_C_V_" << b.discipline()->identifier();
+  }else{ untested();
+    o << "NULL";
+  }
+  o << ", /*states:*/" << b.num_states() << ", " << b.state();
+  o << ", " << b.num_nodes() << ", nodes);\n";
+  o__ "}\n";
+}
+/*--------------------------------------------------------------------------*/
 static void make_module_precalc_first(std::ostream& o, Module const& m)
 {
   make_tag(o);
@@ -938,7 +1237,18 @@ static void make_module_precalc_first(std::ostream& o, Module const& m)
 
   o__ "auto c = static_cast<COMMON_" << mid << "*>(mutable_common());\n";
   o__ "assert(c);\n";
-  o__ "auto cc = c->clone();\n";
+  if(options().optimize_intern()){
+    // a pooled common stays. it is shared within this scope, and its
+    // precalc_last runs once per pass.
+    o__ "COMMON_COMPONENT* cc = c;\n";
+    o__ "if(c->_pooled.is_pooled()){\n";
+    o____ "c->_precalc_pending = true;\n";
+    o__ "}else{\n";
+    o____ "cc = c->clone();\n";
+    o__ "}\n";
+  }else{
+    o__ "auto cc = c->clone();\n";
+  }
 
   if(m.has_analog_block()){
     // o__ "c->precalc_analog(this);\n";
@@ -950,8 +1260,16 @@ static void make_module_precalc_first(std::ostream& o, Module const& m)
     o__ "subckt()->attach_params(&(c->_netlist_params), scope());\n";
   }else{
   }
-  o____ "attach_common(NULL);\n";
-  o____ "attach_common(cc);\n";
+  if(options().optimize_intern()){
+    o____ "if(cc != c){\n";
+    o______ "attach_common(NULL);\n";
+    o______ "attach_common(cc);\n";
+    o____ "}else{\n";
+    o____ "}\n";
+  }else{
+    o____ "attach_common(NULL);\n";
+    o____ "attach_common(cc);\n";
+  }
   o____ "subckt()->precalc_first();\n";
   o__ "}else{\n";
   o__ "}\n";
@@ -968,14 +1286,46 @@ static void make_module_precalc_last(std::ostream& o, Module const& m)
   make_tag(o);
   String_Arg const& mid = m.identifier();
   o << "void MOD_" << mid << "::precalc_last()\n{\n";
+  make_prof_scope(o, m, "PROF_PRECALC");
 //    o__ baseclass(m) << "::precalc_last();\n";
   o__ "CARD::precalc_last();\n";
 
   o__ "try {\n";
-  o____ "mutable_common()->precalc_last(scope());\n"; // for now.
+  if(options().optimize_intern()){
+    // the parameters are final after precalc_params. intern then, and run
+    // the rest once per common and pass.
+    o____ "auto cp = static_cast<COMMON_" << mid << "*>(mutable_common());\n";
+    o____ "if(cp->_pooled.is_pooled()){\n";
+    o______ "if(cp->_precalc_pending){\n";
+    o________ "cp->_precalc_pending = false;\n";
+    o________ "cp->precalc_last(scope());\n";
+    o________ "cp->reintern();\n";
+    o______ "}else{\n";
+    o______ "}\n";
+    o____ "}else{\n";
+    o______ "cp->precalc_params(scope());\n";
+    o______ "auto cc = cp->intern(scope());\n";
+    o______ "if(cc != cp){\n";
+    o________ "attach_common(NULL);\n";
+    o________ "attach_common(cc);\n";
+    o______ "}else{\n";
+    o______ "}\n";
+    o______ "if(cc->_precalc_pending){\n";
+    o________ "cc->_precalc_pending = false;\n";
+    o________ "cc->precalc_derived();\n";
+    o______ "}else{\n";
+    o______ "}\n";
+    o____ "}\n";
+  }else{
+    o____ "mutable_common()->precalc_last(scope());\n"; // for now.
+  }
   o__ "}catch (Exception_Precalc& e) { untested();\n";
   o____ "error(bWARNING, long_label() + \": \" + e.message());\n";
   o__ "}\n;";
+  if(options().optimize_bypass()){
+    o__ "set_not_converged(); // parameters may have changed\n";
+  }else{
+  }
 
   if(m.circuit()->element_list().size()) {
     o__ "assert(subckt());\n";
@@ -1065,9 +1415,14 @@ static void make_module_expand(std::ostream& o, Module const& m)
 //    make_dev_allocate_local_nodes(out, **p);
 //  }
   o << "\n";
+  make_module_expand_fused(o, m);
   o__ "// clone branches\n";
   for(auto i: m.circuit()->branches()){
-    if(i->is_filter()) {
+    if(is_fused(*i)) {
+      o__ "// branch " << i->name() << ", fused\n";
+      indent x;
+      make_module_fuse_one_branch(o, *i);
+    }else if(i->is_filter()) {
       o__ "// filter " << i->name() << "\n";
       indent x;
       if(i->is_used()) {
@@ -1129,6 +1484,9 @@ static void make_module_expand(std::ostream& o, Module const& m)
   o__ "    *i = d;\n";
   o__ "  }\n";
   o__ "}\n";
+  for(auto f : m.funcs()){
+    f->make_cc_expand(o);
+  }
   o << "}\n"
     "/*--------------------------------------"
     "------------------------------------*/\n";
@@ -1164,24 +1522,26 @@ static void make_cc_func(std::ostream& o, const Module& m)
 /*--------------------------------------------------------------------------*/
 static void make_module_set_param_by_name(std::ostream& o, const Module& m)
 {
-  o << "aidx MOD_" << m.identifier() << "::set_param_by_name("
+  std::string class_name = "MOD_" + m.identifier().to_string();
+  o << "aidx " << class_name << "::set_param_by_name("
        "std::string Name, std::string Value)\n{\n";
   o__ "trace2(\"spbn " << m.identifier() << "\", Name, Value);\n";
+  o__ "int i = param_index(Name.c_str(), Name.size());\n";
+  o__ "if(i < 0){\n";
+  o____ "return COMPONENT::set_param_by_name(Name, Value);\n";
+  o__ "}else{\n";
+  o____ "return set_param_at(i, Name, Value);\n";
+  o__ "}\n";
+  o << "}\n"
+    "/*--------------------------------------------------------------------------*/\n";
 
-  o__ "{\n";
-
-
-  o__ "static std::string names[] = {";
-  int cnt = 0;
   std::vector<std::string const*> names;
   std::vector<std::string const*> hs;
-  std::vector<int> alias;
 
   for (auto n : m.aliasparam()){
     if(n->is_hs()){
       names.push_back(&n->name());
       hs.push_back(&n->param_name());
-      alias.push_back(-1);
     }else{
     }
   }
@@ -1193,52 +1553,24 @@ static void make_module_set_param_by_name(std::ostream& o, const Module& m)
       return *names[A] < *names[B];
       });
 
-
-  std::string comma;
+  std::vector<std::string const*> sorted;
   for(auto n : idx){
-      o << comma << "\"" << *names[n] << "\"";
-      comma = ", ";
-  }
-  cnt = int(names.size());
-  o__ "};\n";
-  o__ "int lb = 0;\n";
-  o__ "int ub = " << cnt << ";\n";
-  o__ "while(lb < ub) {\n";
-  o____ "int mid = (lb+ub)/2;\n";
-  o____ "int c = std::strcmp(Name.c_str(), names[mid].c_str());\n";
-  o____ "if(c<0){\n";
-  o______ "ub = mid;\n";
-  o____ "}else if(c>0){\n";
-  o______ "lb = mid+1;\n";
-  o____ "}else{\n";
-  o______ "lb = mid;\n";
-  o______ "ub = " << cnt << ";\n";
-  o______ "assert(lb<ub);\n";
-  o______ "break;\n";
-  o____ "}\n";
-  o__ "}\n";
-  o__ "assert(lb<=ub);\n";
+    sorted.push_back(names[n]);
+  }
+  make_param_index(o, class_name, sorted);
 
-  o__ "switch(ub-lb){\n";
+  o << "aidx " << class_name << "::set_param_at(int i, std::string const& Name,"
+       " std::string const& Value)\n{\n";
+  o__ "switch(i){\n";
+  int cnt = 0;
   for(auto n : idx){
-    std::string cn = "_p_" + *names[n];
-    std::string pn;
+    assert(hs[n]);
     o____ "case " << cnt << ":";
-    if(alias[n] == -1){
-      assert(hs[n]);
-      o__ "return COMPONENT::set_param_by_name(\"" << *hs[n] << "\", Value);\n";
-    }else{ untested();
-      unreachable();
-    }
-    o____ "break; // " << alias[n] << "\n";
-    --cnt;
+    o__ "return COMPONENT::set_param_by_name(\"" << *hs[n] << "\", Value);\n";
+    ++cnt;
   }
-  o____ "case 0: return COMPONENT::set_param_by_name(Name, Value);\n";
-
-  o__ "}\n";
-  o__ "return lb;\n";
+  o____ "default: throw Exception_No_Match(Name);\n";
   o__ "}\n";
-
   o << "}\n"
     "/*--------------------------------------------------------------------------*/\n";
 }
@@ -1246,6 +1578,12 @@ static void make_module_set_param_by_name(std::ostream& o, const Module& m)
 void make_cc_module(std::ostream& o, const Module& m)
 {
   make_tag(o);
+  HOIST_TABLE hoist;
+  if(options().optimize_hoist()){
+    make_hoist_table(m);
+  }else{
+  }
+  hoist.start_emit();
 
   make_cc_decl(o, m);
   make_cc_common(o, m);
@@ -1264,6 +1602,22 @@ void make_cc_module(std::ostream& o, const Module& m)
       "------------------------------------*/\n";
   make_module_class(o, m);
     o << "int MOD_" << m.identifier() << "::_count = -1;\n";
+  if(options().gen_profile()){
+    o << "va::PROFILE MOD_" << m.identifier() << "::_prof;\n";
+  }else{
+  }
+  if(options().optimize_bypass()){
+    o << "va::BYPASS_COUNT MOD_" << m.identifier() << "::_bypass;\n";
+  }else{
+  }
+  if(options().optimize_batch() && m.has_analog_block()){
+    std::string mod = "MOD_" + m.identifier().to_string();
+    o << "std::vector<" << mod << "*> " << mod << "::_batch;\n";
+    o << "decltype(" << mod << "::_batch_tag) " << mod << "::_batch_tag;\n";
+    o << "size_t " << mod << "::_batch_size;\n";
+    o << "size_t " << mod << "::_batch_pool;\n";
+  }else{
+  }
   make_module_dispatcher(o, m);
   make_module_clone(o, m);
 //  make_module_evals(o, m);
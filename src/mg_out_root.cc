@@ -43,6 +43,10 @@ static void make_header(std::ostream& o, const File& in,
     "#include <e_storag.h>\n"
     "// #include <e_paramlist.h>\n"
     "#include <u_nodemap.h>\n"; // if submodules are used anywhere
+  if(options().optimize_simd()){
+    o << "#define VA_SIMD\n";
+  }else{
+  }
 #ifdef DEPEND
   // nothing. just compute deps.
 #elif defined(RETEST)
@@ -57,6 +61,10 @@ static void make_header(std::ostream& o, const File& in,
 #include "e_va.raw"
      ;
 #endif
+  if(options().optimize_batch()){
+    o << "#include <c_comand.h>\n";
+  }else{
+  }
   o <<
     "#include <u_limit.h>\n"
     "/*--------------------------------------"
@@ -24,7 +24,20 @@
 #include "mg_pp.h"
 #include "mg_error.h"
 #include <stack>
+#include <algorithm>
+#include <iterator>
 #include <u_opt.h>
+#include <cstring>
+#include <cerrno>
+#if defined(__WIN32__)
+#include <fstream>
+#include <sstream>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 /*--------------------------------------------------------------------------*/
 class C_Comment : public Base {
 public:
@@ -57,12 +70,166 @@ public:
 //   return _define_list;
 // }
 /*--------------------------------------------------------------------------*/
+// a read only view of an input file, mapped if possible, read into _buf
+// otherwise. lines are copied to CS::_cmd verbatim, so a span of _cmd is
+// the same span of line(), and the output can reference it.
+class PP_File {
+  char const* _begin{NULL};
+  char const* _end{NULL};
+  char const* _pos{NULL};
+  char const* _line{NULL}; // the last line returned
+  void* _map{NULL};
+  size_t _map_size{0};
+  std::string _buf;
+public:
+  explicit PP_File(std::string const& name);
+  ~PP_File();
+  void get_lines(std::string* to);
+  char const* line()const { return _line; }
+};
+/*--------------------------------------------------------------------------*/
+thread_local Preprocessor* Preprocessor::_active;
+/*--------------------------------------------------------------------------*/
+// file reads from in, while in scope.
+class Preprocessor::ATTACH {
+  Preprocessor& _p;
+public:
+  explicit ATTACH(Preprocessor& p, PP_File& in, CS const& file) : _p(p) {
+    if(_p._attached.empty()){
+      _p._outer = _active;
+      _active = &_p;
+    }else{
+    }
+    _p._attached.push_back(std::make_pair(&file, &in));
+  }
+  ~ATTACH() {
+    _p._attached.pop_back();
+    if(_p._attached.empty()){
+      _active = _p._outer;
+      _p._outer = NULL;
+    }else{
+    }
+  }
+};
+/*--------------------------------------------------------------------------*/
+// the file that CS reads from. preprocessors reading in this thread,
+// innermost first.
+PP_File* Preprocessor::find_file(CS const& file)
+{
+  for(Preprocessor const* p = _active; p; p = p->_outer){
+    for(auto i = p->_attached.rbegin(); i != p->_attached.rend(); ++i){
+      if(i->first == &file){
+	return i->second;
+      }else{
+      }
+    }
+  }
+  return NULL;
+}
+/*--------------------------------------------------------------------------*/
+PP_File::PP_File(std::string const& name)
+{
+#if defined(__WIN32__)
+  std::ifstream f(name, std::ios::binary);
+  if(!f){ untested();
+    throw Exception_File_Open(name + ": " + strerror(errno));
+  }else{ untested();
+  }
+  std::ostringstream b;
+  b << f.rdbuf();
+  _buf = b.str();
+  _begin = _buf.data();
+  _map_size = _buf.size();
+#else
+  int fd = open(name.c_str(), O_RDONLY);
+  if(fd < 0){ untested();
+    throw Exception_File_Open(name + ": " + strerror(errno));
+  }else{
+  }
+
+  struct stat st;
+  if(fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0){
+    _map_size = size_t(st.st_size);
+    _map = mmap(NULL, _map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(_map == MAP_FAILED){ untested();
+      _map = NULL;
+    }else{
+      _begin = static_cast<char const*>(_map);
+    }
+  }else{
+  }
+
+  if(_map){
+  }else{
+    char buffer[BIGBUFLEN];
+    for(;;){
+      ssize_t got = ::read(fd, buffer, sizeof(buffer));
+      if(got > 0){
+	_buf.append(buffer, size_t(got));
+      }else{
+	break;
+      }
+    }
+    _begin = _buf.data();
+    _map_size = _buf.size();
+  }
+  close(fd);
+#endif
+
+  _end = _begin + _map_size;
+  _pos = _begin;
+  _line = _begin;
+}
+/*--------------------------------------------------------------------------*/
+PP_File::~PP_File()
+{
+#if !defined(__WIN32__)
+  if(_map){
+    munmap(_map, _map_size);
+  }else{
+  }
+#endif
+}
+/*--------------------------------------------------------------------------*/
+// as getlines, a line ending in backslash continues.
+void PP_File::get_lines(std::string* to)
+{
+  assert(to);
+  if(_pos == _end){
+    throw Exception_End_Of_Input("");
+  }else{
+  }
+
+  char const* p = _pos;
+  for(;;){
+    char const* nl = static_cast<char const*>(memchr(p, '\n', size_t(_end - p)));
+    if(!nl){
+      p = _end;
+      break;
+    }else if(nl != p && nl[-1] == '\\'){
+      p = nl + 1;
+    }else{
+      p = nl + 1;
+      break;
+    }
+  }
+  _line = _pos;
+  _pos = p;
+  to->assign(_line, size_t(p - _line)); // reuses the capacity of *to
+  trace1("get_lines", to->substr(0, 30));
+}
+/*--------------------------------------------------------------------------*/
 // copied in from a_construct.
 static std::string getlines(FILE *fileptr);
 CS& CS::get_line(const std::string& prompt)
 {
   ++_line_number;
-  if (is_file()) {
+  if (PP_File* in = Preprocessor::find_file(*this)) {
+    in->get_lines(&_cmd);
+    _cnt = 0;
+    _length = _cmd.length();
+    _ok = true;
+  }else if (is_file()) { untested();
     _cmd = getlines(_file);
     _cnt = 0;
     _length = _cmd.length();
@@ -176,6 +343,48 @@ static void append_to(CS& f, std::string& to, std::string until)
 
 }
 /*--------------------------------------------------------------------------*/
+// the characters [b, e) of the current line.
+static void append_span(PP_Chunk_List& to, CS& f, PP_File const* in,
+                        size_t b, size_t e)
+{
+  if(b == e){
+  }else if(in){
+    to.append(in->line() + b, e - b);
+  }else{ untested();
+    to.append(f.substr(b, e - b));
+  }
+}
+/*--------------------------------------------------------------------------*/
+// as above, without copying text from the file.
+static void append_to(CS& f, PP_Chunk_List& to, PP_File const* in,
+                      std::string const& until)
+{
+  if(!f.ns_more()) {
+    try{
+      f.get_line("");
+    }catch (Exception_End_Of_Input const&) {
+      assert(!f.ns_more());
+    }
+  }else{
+  }
+
+  while (f.ns_more()) {
+    size_t here = f.cursor();
+    while (f.ns_more() && !f.match1(until)) {
+      f.skip();
+    }
+    append_span(to, f, in, here, f.cursor());
+    if(f.match1(until)){
+      return;
+    }else{
+      try{
+	f.get_line("");
+      }catch( Exception_End_Of_Input const&){
+      }
+    }
+  }
+}
+/*--------------------------------------------------------------------------*/
 void C_Comment::parse(CS& file)
 {
 //  size_t here = file.cursor();
@@ -484,8 +693,7 @@ static std::string expand_macro(CS& file, Define_List const& d)
     if (x != d.end()) {
       assert(*x);
       auto values = eval_args(file, (*x)->num_args(), d);
-      std::string subst = (*x)->substitute(values, d);
-      stripped_file += subst; //  + "\n";
+      stripped_file += d.substitute(x, values); //  + "\n";
     }else{ untested();
       throw(Exception_CS("undefined macro", file));
     }
@@ -633,11 +841,167 @@ std::string Define::substitute(String_Arg_List const& values, Define_List const&
   return expand_macros(ff, d);
 }
 /*--------------------------------------------------------------------------*/
+void Define_List::parse(CS& f)
+{
+  const_iterator last = end();
+  if(is_empty()){
+  }else{
+    last = std::prev(end());
+  }
+
+  try{
+    Collection<Define>::parse(f);
+  }catch(Exception const&){
+    index_after(last);
+    throw;
+  }
+  index_after(last);
+}
+/*--------------------------------------------------------------------------*/
+// the first definition of a name wins, as in Collection::find.
+void Define_List::index_after(const_iterator last)
+{
+  const_iterator i = begin();
+  if(last == end()){
+  }else{
+    i = std::next(last);
+  }
+  for(; i != end(); ++i){
+    assert(*i);
+    _index.emplace((*i)->key().to_string(), i);
+  }
+  _memo.clear();
+}
+/*--------------------------------------------------------------------------*/
+Define_List::const_iterator Define_List::find(String_Arg const& s)const
+{
+  auto x = _index.find(s.to_string());
+  if(x == _index.end()){
+    return end();
+  }else{
+    return x->second;
+  }
+}
+/*--------------------------------------------------------------------------*/
+Define_List::const_iterator Define_List::find(CS& file)const
+{
+  size_t here = file.cursor();
+  String_Arg s;
+  s = file.ctos(":,.`()[];*/+-");
+  trace1("definefind", s);
+  const_iterator x = find(s);
+  if (x == end()) {
+    file.reset(here);
+  }else{
+  }
+  return x;
+}
+/*--------------------------------------------------------------------------*/
+void Define_List::erase(const_iterator x)
+{
+  assert(x != end());
+  std::string name = (*x)->key().to_string();
+  _index.erase(name);
+  Collection<Define>::erase(x);
+
+  // another definition of the same name?
+  for(const_iterator i = begin(); i != end(); ++i){
+    if((*i)->key().to_string() == name){ untested();
+      _index.emplace(name, i);
+      break;
+    }else{
+    }
+  }
+  _memo.clear();
+}
+/*--------------------------------------------------------------------------*/
+// the expansion depends on the arguments, after expansion, and on the
+// other macros. the latter only change in parse and erase.
+std::string const& Define_List::substitute(const_iterator x,
+    String_Arg_List const& values)const
+{
+  assert(x != end());
+  assert(*x);
+  std::string key = (*x)->key().to_string();
+  for(auto v : values){
+    key += '\0';
+    key += v->to_string();
+  }
+
+  auto m = _memo.find(key);
+  if(m != _memo.end()){
+    return m->second;
+  }else{
+    std::string subst = (*x)->substitute(values, *this);
+    return _memo.emplace(key, subst).first->second;
+  }
+}
+/*--------------------------------------------------------------------------*/
+void PP_Chunk_List::append(char const* data, size_t len)
+{
+  assert(data);
+  if(!_chunks.empty() && _chunks.back().data
+      && _chunks.back().data + _chunks.back().len == data){
+    // continues the last span
+    _chunks.back().len += len;
+  }else{
+    _chunks.push_back(CHUNK{data, 0, len});
+  }
+  _size += len;
+}
+/*--------------------------------------------------------------------------*/
+void PP_Chunk_List::append(std::string const& s)
+{
+  if(s.empty()){
+  }else if(!_chunks.empty() && !_chunks.back().data
+      && _chunks.back().pos + _chunks.back().len == _own.size()){
+    _chunks.back().len += s.size();
+  }else{
+    _chunks.push_back(CHUNK{NULL, _own.size(), s.size()});
+  }
+  _own += s;
+  _size += s.size();
+}
+/*--------------------------------------------------------------------------*/
+void PP_Chunk_List::append(char c)
+{
+  append(std::string(1, c));
+}
+/*--------------------------------------------------------------------------*/
+std::string PP_Chunk_List::str()const
+{
+  std::string ret;
+  ret.reserve(_size);
+  for(auto const& c : _chunks){
+    if(c.data){
+      ret.append(c.data, c.len);
+    }else{
+      ret.append(_own, c.pos, c.len);
+    }
+  }
+  assert(ret.size() == _size);
+  return ret;
+}
+/*--------------------------------------------------------------------------*/
 Preprocessor::Preprocessor() : CS(CS::_STRING, "")
 {
 }
 /*--------------------------------------------------------------------------*/
+Preprocessor::~Preprocessor()
+{
+  for(auto f : _files){
+    delete f;
+  }
+}
+/*--------------------------------------------------------------------------*/
+// the output is joined here, not per `include.
 void Preprocessor::read(std::string const& file_name)
+{
+  parse_file(file_name);
+  CS::operator=(_out.str());
+}
+/*--------------------------------------------------------------------------*/
+void Preprocessor::parse_file(std::string const& file_name)
 {
   if(OPT::case_insensitive == 0){
   }else{ untested();
@@ -654,6 +1018,11 @@ void Preprocessor::read(std::string const& file_name)
   CS file(CS::_INC_FILE, file_name);
   assert(file.fullstring()=="");
 
+  // _out may reference it until the end.
+  PP_File* in = new PP_File(file_name);
+  _files.push_back(in);
+
+  ATTACH a(*this, *in, file);
   parse(file);
 }
 /*--------------------------------------------------------------------------*/
@@ -673,13 +1042,14 @@ void PP_Quoted_String::dump(std::ostream& o)const
 /*--------------------------------------------------------------------------*/
 void Preprocessor::parse(CS& file)
 {
+  PP_File const* in = find_file(file);
   std::stack<int> _cond;
   size_t here = file.cursor();
   for (;;) {
-    append_to(file, _stripped_file, "\"/`");
+    append_to(file, _out, in, "\"/`");
     if (!file.ns_more()){
     }else if (file >> quoted_string) {
-      _stripped_file += quoted_string.val_string();
+      _out.append(quoted_string.val_string());
     }else if (file >> "/*") /* C comment */ {
       file >> dummy_c_comment; //BUG// line count may be wrong
     }else if (file >> "//") /* C++ comment */ {
@@ -764,14 +1134,16 @@ void Preprocessor::parse(CS& file)
       if (x != define_list().end()) {
 	assert(*x);
 	auto values = eval_args(file, (*x)->num_args(), define_list());
-	std::string subst = (*x)->substitute(values, define_list());
+	std::string const& subst = define_list().substitute(x, values);
 	trace1("match macro", subst);
-	_stripped_file += subst + " ";
+	_out.append(subst);
+	_out.append(' ');
       }else{
 	throw Exception_CS("undefined macro", file);
       }
-    }else if (file.skip1('/')) {
-      _stripped_file += "/";
+    }else if (file.match1('/')) {
+      append_span(_out, file, in, file.cursor(), file.cursor() + 1);
+      file.skip();
     }else{ untested();
       unreachable();
 //      _stripped_file += "\n";
@@ -795,7 +1167,6 @@ void Preprocessor::parse(CS& file)
     }else{
     }
   }
-  CS::operator=(_stripped_file);
   if (_cond.empty()){
   }else{
     file.warn(bDANGER, "unmatched `ifdef\n");
@@ -832,6 +1203,11 @@ void Preprocessor::include(std::string const& file_name)
   }else{
   }
 
+  if(std::find(_includes.begin(), _includes.end(), full_file_name) == _includes.end()){
+    _includes.push_back(full_file_name);
+  }else{
+  }
+
   std::string::size_type sepplace;
   sepplace = full_file_name.find_last_of("/");
 
@@ -840,7 +1216,7 @@ void Preprocessor::include(std::string const& file_name)
   std::string old_include_path = _include_path;
   std::string old_cwd = _cwd;
 
-  read(full_file_name);
+  parse_file(full_file_name);
 
   _include_path = old_include_path;
   _cwd = old_cwd;
@@ -22,6 +22,7 @@
 #ifndef GNUCAP_MG_PP_H
 #define GNUCAP_MG_PP_H
 #include "mg_base.h"
+#include <unordered_map>
 /*--------------------------------------------------------------------------*/
 class Define_List;
 class Define : public Base {
@@ -46,18 +47,58 @@ private:
   void stash(std::string const&, String_Arg_List const&);
 };
 /*--------------------------------------------------------------------------*/
+// lookup by name, and expansions by name and arguments. the expansions
+// are valid until the next `define or `undef.
 class Define_List : public Collection<Define>{
+  std::unordered_map<std::string, const_iterator> _index;
+  mutable std::unordered_map<std::string, std::string> _memo;
+public:
+  void parse(CS& f)override;
+  const_iterator find(String_Arg const& s)const;
+  const_iterator find(CS& f)const;
+  void erase(const_iterator x);
+  std::string const& substitute(const_iterator x, String_Arg_List const&)const;
+private:
+  void index_after(const_iterator last);
+};
+/*--------------------------------------------------------------------------*/
+// preprocessor output. spans of the input files that pass unchanged are
+// referenced in place, other text goes to _own. str() joins them once.
+class PP_Chunk_List {
+  struct CHUNK {
+    char const* data; // in an input file, NULL: in _own
+    size_t pos;       // in _own
+    size_t len;
+  };
+  std::vector<CHUNK> _chunks;
+  std::string _own;
+  size_t _size{0};
+public:
+  void append(char const* data, size_t len);
+  void append(std::string const& s);
+  void append(char c);
+  size_t size()const { return _size; }
+  size_t num_chunks()const { return _chunks.size(); }
+  std::string str()const;
 };
 /*--------------------------------------------------------------------------*/
+class PP_File;
 class Preprocessor : public CS {
   Define_List _define_list;
   std::string _cwd;
   std::string _include_path;
   std::basic_ostream<char>* _diag{NULL};
+  std::vector<std::string> _includes; // resolved `include files
 private:
-  std::string _stripped_file; // DUP?
+  PP_Chunk_List _out;
+  std::vector<PP_File*> _files; // referenced from _out
+  std::vector<std::pair<CS const*, PP_File*>> _attached; // being read
+  Preprocessor* _outer{NULL}; // reading before this one, in this thread
+  static thread_local Preprocessor* _active;
+  class ATTACH;
 public:
   explicit Preprocessor();
+  ~Preprocessor();
   void read(std::string const& file_name);
   void define(std::string const&);
   void dump(std::ostream&)const;
@@ -65,8 +106,11 @@ public:
   void set_diag(std::basic_ostream<char>& o){
     _diag = &o;
   }
+  std::vector<std::string> const& includes()const {return _includes;}
+  static PP_File* find_file(CS const&);
 private:
   void parse(CS& file);
+  void parse_file(std::string const& file_name);
   void include(const std::string& file_name); // `include?
   std::basic_ostream<char>& diag() { untested();
     if(_diag){ untested();
@@ -110,6 +110,9 @@ class LIMIT : public MGVAMS_TASK {
   LIMIT* clone()const override{
     return new LIMIT(*this);
   }
+  // _old is a member of the instance, and an instance is evaluated by
+  // one thread at a time. pnj_limit is pure, _sim is only read.
+  bool is_reentrant()const override { return true;}
   Token* new_token(Module& m, size_t na)const override{
     LIMIT* cl = clone();
     cl->set_label("t_limit_" + std::to_string(cnt++));
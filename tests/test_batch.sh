@@ -0,0 +1,12 @@
+
+d=`mktemp -d`
+cp ${srcdir}/../vams/resistor.vams ${srcdir}/../vams/capacitor.vams $d
+printf '# models\n%s\n\n%s\n' $d/resistor.vams $d/capacitor.vams > $d/list
+$1 -I ${srcdir}/../vams -j 2 --batch $d/list
+echo batch $?
+ls $d | grep -c '\.cc$'
+$1 -I ${srcdir}/../vams --cc $d/resistor.vams > $d/r.cc
+$1 -I ${srcdir}/../vams --cc $d/capacitor.vams > $d/c.cc
+cmp $d/resistor.cc $d/r.cc && echo resistor same
+cmp $d/capacitor.cc $d/c.cc && echo capacitor same
+rm -rf $d
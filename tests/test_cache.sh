@@ -0,0 +1,9 @@
+
+d=`mktemp -d`
+$1 -I .. --cache-dir $d --cc ${srcdir}/../vams/resistor.vams > $d/1.out
+$1 -I .. --cache-dir $d --cc ${srcdir}/../vams/resistor.vams > $d/2.out
+$1 -I .. --cache-dir $d --optimize-batch --cc ${srcdir}/../vams/resistor.vams > $d/3.out
+cmp $d/1.out $d/2.out && echo same
+cmp -s $d/1.out $d/3.out || echo options differ
+ls $d | grep -c '\.cc$'
+rm -rf $d
@@ -0,0 +1,3 @@
+
+$1 -MT test.cc -MF /dev/stdout -o /dev/null --pp sub/test
+$1 -I .. -MT conductor.cc -MF /dev/stdout -o /dev/null --pp ${srcdir}/dump_conductor.0.vams | sed 's,[^ ]*/,,g'